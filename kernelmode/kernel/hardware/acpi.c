@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <hardware/acpi.h>
+#include <memory/physmem.h>
+#include <util/util.h>
+
+/**
+ * \defgroup ACPI Advanced Configuration and Power Interface
+ * \addtogroup ACPI
+ *  @{
+ *  The firmware describes the processors and interrupt controllers of the
+ *  system in the Multiple APIC Description Table (MADT), which is found by
+ *  following the Root System Description Pointer (RSDP) to the Root System
+ *  Description Table (RSDT). The tables are parsed once at boot time while
+ *  paging is still disabled, afterwards only the collected values are used.
+ *
+ *  For more information take a look at http://wiki.osdev.org/MADT
+ */
+
+uint32_t acpiLocalApicAddress = 0;
+uint32_t acpiCpuCount = 0;
+uint8_t acpiCpuApicID[ACPI_MAX_CPUS];
+uint32_t acpiIOApicCount = 0;
+struct acpiIOApic acpiIOApics[ACPI_MAX_IOAPICS];
+struct acpiIRQRoute acpiIRQRoutes[ACPI_ISA_IRQ_COUNT];
+
+uint32_t __getCR0();
+asm(".text\n.align 4\n"
+"__getCR0:\n"
+"	movl %cr0, %eax\n"
+"	ret\n"
+);
+
+/* Verifies that all bytes of a table sum up to zero */
+static bool __acpiChecksum(const void *addr, uint32_t length)
+{
+	const uint8_t *data = addr;
+	uint8_t sum = 0;
+
+	while (length--)
+		sum += *data++;
+
+	return (sum == 0);
+}
+
+/* Searches for the RSDP on 16 byte boundaries of a physical memory region */
+static struct acpiRSDP *__acpiSearchRSDP(uint32_t addr, uint32_t length)
+{
+	struct acpiRSDP *rsdp;
+	uint32_t end = addr + length;
+
+	for (addr = (addr + 15) & ~15; addr + sizeof(*rsdp) <= end; addr += 16)
+	{
+		rsdp = (struct acpiRSDP *)addr;
+		if (rsdp->signature[0] != ACPI_SIGNATURE_RSDP_LOW || rsdp->signature[1] != ACPI_SIGNATURE_RSDP_HIGH)
+			continue;
+
+		if (__acpiChecksum(rsdp, sizeof(*rsdp)))
+			return rsdp;
+	}
+
+	return NULL;
+}
+
+/* Collects the enabled processors, the IO APICs and the routing of the ISA IRQs */
+static void __acpiParseMADT(struct acpiMADT *madt)
+{
+	uint32_t offset = sizeof(*madt);
+
+	acpiLocalApicAddress = madt->localApicAddress;
+
+	while (offset + sizeof(struct acpiMADTEntry) <= madt->header.length)
+	{
+		struct acpiMADTEntry *entry = (struct acpiMADTEntry *)((uint8_t *)madt + offset);
+		if (entry->length < sizeof(*entry) || offset + entry->length > madt->header.length)
+			break;
+
+		if (entry->type == ACPI_MADT_LOCAL_APIC)
+		{
+			struct acpiMADTLocalApic *localApic = (struct acpiMADTLocalApic *)entry;
+			if ((localApic->flags & ACPI_MADT_LOCAL_APIC_ENABLED) && acpiCpuCount < ACPI_MAX_CPUS)
+				acpiCpuApicID[acpiCpuCount++] = localApic->apicID;
+		}
+		else if (entry->type == ACPI_MADT_IO_APIC)
+		{
+			struct acpiMADTIOApic *ioApic = (struct acpiMADTIOApic *)entry;
+			if (acpiIOApicCount < ACPI_MAX_IOAPICS)
+			{
+				acpiIOApics[acpiIOApicCount].address = ioApic->address;
+				acpiIOApics[acpiIOApicCount].gsiBase = ioApic->gsiBase;
+				acpiIOApicCount++;
+			}
+		}
+		else if (entry->type == ACPI_MADT_INTERRUPT_OVERRIDE)
+		{
+			struct acpiMADTInterruptOverride *override = (struct acpiMADTInterruptOverride *)entry;
+			if (override->bus == 0 && override->source < ACPI_ISA_IRQ_COUNT)
+			{
+				acpiIRQRoutes[override->source].gsi		= override->gsi;
+				acpiIRQRoutes[override->source].flags	= override->flags;
+			}
+		}
+
+		offset += entry->length;
+	}
+}
+
+/**
+ * @brief Parses the ACPI tables provided by the firmware
+ * @details Searches the RSDP in the first kilobyte of the extended BIOS data
+ *			area and in the BIOS ROM, and afterwards walks through the RSDT to
+ *			find the MADT. This function accesses physical memory directly and
+ *			therefore has to be called after physMemInit() but before pagingInit().
+ *			The pages of the local APIC and the IO APICs are added to the boot map,
+ *			such that they are accessible at the same address after paging was
+ *			enabled. ISA IRQs without an interrupt source override are identity
+ *			mapped to global system interrupts.
+ *
+ * @return True if a valid MADT was found, otherwise false
+ */
+bool acpiInit()
+{
+	struct acpiRSDP *rsdp;
+	struct acpiHeader *rsdt;
+	uint32_t ebda, i, count;
+	uint16_t segment;
+
+	assert(!(__getCR0() & 0x80000000));
+
+	for (i = 0; i < ACPI_ISA_IRQ_COUNT; i++)
+	{
+		acpiIRQRoutes[i].gsi	= i;
+		acpiIRQRoutes[i].flags	= 0;
+	}
+
+	/* the segment of the EBDA is stored in the BIOS data area */
+	memcpy(&segment, (void *)0x40E, sizeof(segment));
+	ebda = (uint32_t)segment << 4;
+	rsdp = ebda ? __acpiSearchRSDP(ebda, 1024) : NULL;
+	if (!rsdp) rsdp = __acpiSearchRSDP(0xE0000, 0x20000);
+	if (!rsdp) return false;
+
+	rsdt = (struct acpiHeader *)rsdp->rsdtAddress;
+	if (!rsdt || rsdt->length < sizeof(*rsdt) || !__acpiChecksum(rsdt, rsdt->length))
+		return false;
+
+	count = (rsdt->length - sizeof(*rsdt)) / sizeof(uint32_t);
+	for (i = 0; i < count; i++)
+	{
+		struct acpiHeader *table = (struct acpiHeader *)((uint32_t *)(rsdt + 1))[i];
+		if (!table || table->signature != ACPI_SIGNATURE_MADT)
+			continue;
+
+		if (table->length < sizeof(struct acpiMADT) || !__acpiChecksum(table, table->length))
+			continue;
+
+		__acpiParseMADT((struct acpiMADT *)table);
+		break;
+	}
+
+	if (!acpiLocalApicAddress)
+		return false;
+
+	physMemProtectBootEntry(acpiLocalApicAddress, PAGE_SIZE);
+	for (i = 0; i < acpiIOApicCount; i++)
+		physMemProtectBootEntry(acpiIOApics[i].address, PAGE_SIZE);
+
+	return true;
+}
+
+/**
+ * @}
+ */
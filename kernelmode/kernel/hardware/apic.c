@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <hardware/apic.h>
+#include <hardware/acpi.h>
+#include <hardware/tsc.h>
+#include <interrupt/interrupt.h>
+#include <util/util.h>
+
+/**
+ * \defgroup APIC Advanced Programmable Interrupt Controller
+ * \addtogroup APIC
+ *  @{
+ *  Each processor contains a local APIC, which is used to send interrupts
+ *  to other processors (interprocessor interrupts) and provides a timer.
+ *  Hardware interrupts are delivered by one or more IO APICs, which replace
+ *  the legacy \ref PIC when they are listed in the \ref ACPI tables. The
+ *  registers of both are memory mapped at the addresses reported by the MADT.
+ *
+ *  The timer of the local APIC has a 32 bit counter and can be used in
+ *  one-shot or periodic mode. Each processor has its own timer, so all
+ *  timer functions only affect the current processor.
+ *
+ *  For more information take a look at http://wiki.osdev.org/APIC
+ */
+
+static volatile uint8_t *apicBase = NULL;
+
+/* base of the IRQ vectors if the IO APIC is used, otherwise 0 */
+static uint32_t ioApicIRQBase = 0;
+
+/* frequency of the APIC timer in Hz (or 0) and the callback executed on expiry */
+static uint64_t apicTimerFrequency = 0;
+static irq_callback apicTimerCallback = NULL;
+
+static inline uint32_t __apicRead(uint32_t reg)
+{
+	return *(volatile uint32_t *)(apicBase + reg);
+}
+
+static inline void __apicWrite(uint32_t reg, uint32_t value)
+{
+	*(volatile uint32_t *)(apicBase + reg) = value;
+}
+
+static inline uint32_t __ioApicRead(uint32_t address, uint32_t reg)
+{
+	*(volatile uint32_t *)(address + IOAPIC_REG_SELECT) = reg;
+	return *(volatile uint32_t *)(address + IOAPIC_REG_WINDOW);
+}
+
+static inline void __ioApicWrite(uint32_t address, uint32_t reg, uint32_t value)
+{
+	*(volatile uint32_t *)(address + IOAPIC_REG_SELECT) = reg;
+	*(volatile uint32_t *)(address + IOAPIC_REG_WINDOW) = value;
+}
+
+/* Checks if the CPU reports an onchip APIC */
+static bool __cpuHasApic()
+{
+	uint32_t eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+	return (edx & (1 << 9)) != 0;
+}
+
+/* Looks up the IO APIC and the redirection entry of a global system interrupt */
+static struct acpiIOApic *__ioApicFind(uint32_t gsi, uint32_t *index)
+{
+	uint32_t i, count;
+
+	for (i = 0; i < acpiIOApicCount; i++)
+	{
+		struct acpiIOApic *ioApic = &acpiIOApics[i];
+		if (gsi < ioApic->gsiBase) continue;
+
+		count = ((__ioApicRead(ioApic->address, IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+		if (gsi - ioApic->gsiBase >= count) continue;
+
+		*index = gsi - ioApic->gsiBase;
+		return ioApic;
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Handles spurious interrupts of the local APIC
+ * @details Spurious interrupts don't set the in-service bit, so no EOI is sent.
+ *
+ * @param interrupt Always #APIC_SPURIOUS_VECTOR
+ * @param error Does not apply to this interrupt
+ * @param t Not used
+ * @return Always #INTERRUPT_CONTINUE_EXECUTION
+ */
+static uint32_t interrupt_spurious(UNUSED uint32_t interrupt, UNUSED uint32_t error, UNUSED struct thread *t)
+{
+	return INTERRUPT_CONTINUE_EXECUTION;
+}
+
+/**
+ * @brief Handles the interrupt of the APIC timer
+ * @details Executes the callback registered with apicTimerReserve() and
+ *			acknowledges the interrupt afterwards.
+ *
+ * @param interrupt Always #APIC_TIMER_VECTOR
+ * @param error Does not apply to this interrupt
+ * @param t Not used
+ * @return The return value of the callback
+ */
+static uint32_t interrupt_apicTimer(UNUSED uint32_t interrupt, UNUSED uint32_t error, UNUSED struct thread *t)
+{
+	uint32_t status = INTERRUPT_CONTINUE_EXECUTION;
+
+	if (apicTimerCallback)
+		status = apicTimerCallback(0);
+
+	apicEOI();
+	return status;
+}
+
+/**
+ * @brief Initializes the local APIC of the bootstrap processor
+ * @details The registers are accessed through the identity mapping which was
+ *			set up by acpiInit(). The local APIC is software enabled, but the
+ *			local interrupt pins are left as configured by the BIOS, so the
+ *			\ref PIC can still deliver interrupts until apicInitIRQ() is called.
+ *
+ * @return True if a local APIC is available, otherwise false
+ */
+bool apicInit()
+{
+	assert(!apicBase);
+
+	if (!acpiLocalApicAddress || !__cpuHasApic())
+		return false;
+
+	apicBase = (volatile uint8_t *)acpiLocalApicAddress;
+
+	assert(interruptReserve(APIC_SPURIOUS_VECTOR, interrupt_spurious));
+	__apicWrite(APIC_REG_TPR, 0);
+	__apicWrite(APIC_REG_SVR, APIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+	return true;
+}
+
+/**
+ * @brief Initializes the local APIC of an application processor
+ * @details Enables the local APIC like apicInit() and prepares the APIC timer.
+ *			The frequency measured by apicTimerInit() on the bootstrap processor
+ *			is used for all processors.
+ */
+void apicInitCPU()
+{
+	assert(apicBase);
+
+	__apicWrite(APIC_REG_TPR, 0);
+	__apicWrite(APIC_REG_SVR, APIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+
+	if (apicTimerFrequency)
+	{
+		__apicWrite(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+		__apicWrite(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+	}
+}
+
+/**
+ * @brief Checks if apicInit() successfully initialized the local APIC
+ *
+ * @return True if the local APIC can be used, otherwise false
+ */
+bool apicAvailable()
+{
+	return (apicBase != NULL);
+}
+
+/**
+ * @brief Returns the ID of the local APIC of the current processor
+ *
+ * @return Local APIC ID
+ */
+uint32_t apicGetID()
+{
+	assert(apicBase);
+	return __apicRead(APIC_REG_ID) >> 24;
+}
+
+/**
+ * @brief Sends an interprocessor interrupt
+ * @details Writes the destination and the command into the interrupt command
+ *			register and waits until the local APIC has delivered the message.
+ *
+ * @param apicID Local APIC ID of the destination processor
+ * @param command Combination of APIC_ICR_* flags and the vector
+ */
+void apicSendIPI(uint32_t apicID, uint32_t command)
+{
+	assert(apicBase);
+
+	__apicWrite(APIC_REG_ICR_HIGH, apicID << 24);
+	__apicWrite(APIC_REG_ICR_LOW, command);
+
+	while (__apicRead(APIC_REG_ICR_LOW) & APIC_ICR_PENDING)
+		asm volatile("pause");
+}
+
+/**
+ * @brief Signals the end of an interrupt to the local APIC
+ */
+void apicEOI()
+{
+	assert(apicBase);
+	__apicWrite(APIC_REG_EOI, 0);
+}
+
+/**
+ * @brief Routes the ISA IRQs through the IO APIC
+ * @details Each IRQ is mapped to the global system interrupt given by the
+ *			interrupt source overrides of the MADT and delivered to the
+ *			bootstrap processor. All redirection entries start masked, they are
+ *			unmasked with apicSetIRQMask() when a driver reserves the IRQ. The
+ *			caller is responsible for masking the IRQs on the legacy PIC.
+ *
+ * @param interruptOffset The first interrupt which should handle the IRQs
+ * @return True if all IRQs could be routed, false if the \ref PIC has to be used
+ */
+bool apicInitIRQ(uint32_t interruptOffset)
+{
+	struct acpiIOApic *ioApic;
+	uint32_t irq, index, value;
+
+	if (!apicBase || !acpiIOApicCount)
+		return false;
+
+	/* ensure that all IRQs can be routed before touching the hardware */
+	for (irq = 0; irq < ACPI_ISA_IRQ_COUNT; irq++)
+	{
+		if (irq != IRQ_SLAVE && !__ioApicFind(acpiIRQRoutes[irq].gsi, &index))
+			return false;
+	}
+
+	for (irq = 0; irq < ACPI_ISA_IRQ_COUNT; irq++)
+	{
+		if (irq == IRQ_SLAVE) continue;
+		ioApic = __ioApicFind(acpiIRQRoutes[irq].gsi, &index);
+
+		value = IOAPIC_MASKED | (interruptOffset + irq);
+		if ((acpiIRQRoutes[irq].flags & ACPI_IRQ_POLARITY_MASK) == ACPI_IRQ_POLARITY_LOW)
+			value |= IOAPIC_ACTIVE_LOW;
+		if ((acpiIRQRoutes[irq].flags & ACPI_IRQ_TRIGGER_MASK) == ACPI_IRQ_TRIGGER_LEVEL)
+			value |= IOAPIC_LEVEL;
+
+		__ioApicWrite(ioApic->address, IOAPIC_REDIRECTION(index) + 1, apicGetID() << 24);
+		__ioApicWrite(ioApic->address, IOAPIC_REDIRECTION(index), value);
+	}
+
+	ioApicIRQBase = interruptOffset;
+	return true;
+}
+
+/**
+ * @brief Masks or unmasks an ISA IRQ on the IO APIC
+ *
+ * @param irq The IRQ which should be changed
+ * @param masked True to disable the IRQ, false to enable it
+ */
+void apicSetIRQMask(uint32_t irq, bool masked)
+{
+	struct acpiIOApic *ioApic;
+	uint32_t index, value;
+
+	assert(ioApicIRQBase);
+	assert(irq < ACPI_ISA_IRQ_COUNT);
+
+	ioApic = __ioApicFind(acpiIRQRoutes[irq].gsi, &index);
+	assert(ioApic);
+
+	value = __ioApicRead(ioApic->address, IOAPIC_REDIRECTION(index));
+	value = masked ? (value | IOAPIC_MASKED) : (value & ~IOAPIC_MASKED);
+	__ioApicWrite(ioApic->address, IOAPIC_REDIRECTION(index), value);
+}
+
+/**
+ * @brief Measures the frequency of the APIC timer
+ * @details The timer is started with the maximum count and compared against
+ *			the \ref TSC for #APIC_TIMER_CALIBRATION nanoseconds, so tscInit()
+ *			has to be called before. Afterwards the timer is stopped again.
+ *
+ * @return True if the APIC timer can be used, otherwise false
+ */
+bool apicTimerInit()
+{
+	uint64_t start, end;
+	uint32_t count;
+
+	assert(!apicTimerFrequency);
+
+	if (!apicBase)
+		return false;
+
+	__apicWrite(APIC_REG_TIMER_DIVIDE, APIC_TIMER_DIVIDE_16);
+	__apicWrite(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+
+	start = tscGetNanoseconds();
+	__apicWrite(APIC_REG_TIMER_INITIAL, 0xFFFFFFFF);
+	do
+	{
+		end = tscGetNanoseconds();
+	}
+	while (end - start < APIC_TIMER_CALIBRATION);
+	count = 0xFFFFFFFF - __apicRead(APIC_REG_TIMER_CURRENT);
+	__apicWrite(APIC_REG_TIMER_INITIAL, 0);
+
+	apicTimerFrequency = (uint64_t)count * 1000000000ULL / (end - start);
+	return (apicTimerFrequency != 0);
+}
+
+/**
+ * @brief Checks if apicTimerInit() successfully calibrated the APIC timer
+ *
+ * @return True if the APIC timer can be used, otherwise false
+ */
+bool apicTimerAvailable()
+{
+	return (apicTimerFrequency != 0);
+}
+
+/**
+ * @brief Assigns a callback function to the APIC timer
+ * @details The return value of the callback is used as the result of the interrupt.
+ *
+ * @param callback The function which should be called when the timer expires
+ * @return True if no callback was registered yet, false otherwise
+ */
+bool apicTimerReserve(irq_callback callback)
+{
+	assert(apicTimerFrequency);
+
+	if (apicTimerCallback)
+		return false;
+
+	apicTimerCallback = callback;
+	return interruptReserve(APIC_TIMER_VECTOR, interrupt_apicTimer);
+}
+
+/**
+ * @brief Starts the APIC timer of the current processor
+ * @details A running timer is restarted. Delays which don't fit into the 32 bit
+ *			counter are shortened to the maximum possible value.
+ *
+ * @param ns Delay until the timer expires (in ns)
+ * @param periodic If true the timer is automatically restarted with the same delay
+ */
+void apicTimerStart(uint64_t ns, bool periodic)
+{
+	uint64_t count;
+
+	assert(apicTimerFrequency);
+
+	/* compare first to avoid an overflow of the multiplication */
+	if (ns >= 0xFFFFFFFFULL * 1000000000ULL / apicTimerFrequency)
+		count = 0xFFFFFFFF;
+	else
+	{
+		count = (ns * apicTimerFrequency + 999999999) / 1000000000;
+		if (count < 1) count = 1;
+	}
+
+	__apicWrite(APIC_REG_LVT_TIMER, (periodic ? APIC_LVT_TIMER_PERIODIC : 0) | APIC_TIMER_VECTOR);
+	__apicWrite(APIC_REG_TIMER_INITIAL, count);
+}
+
+/**
+ * @brief Stops the APIC timer of the current processor
+ */
+void apicTimerStop()
+{
+	assert(apicTimerFrequency);
+
+	__apicWrite(APIC_REG_TIMER_INITIAL, 0);
+	__apicWrite(APIC_REG_LVT_TIMER, APIC_LVT_MASKED | APIC_TIMER_VECTOR);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <hardware/fpu.h>
+#include <util/util.h>
+
+/**
+ * \defgroup FPU Floating Point Unit
+ * \addtogroup FPU
+ *  @{
+ *  The FPU and SSE registers are not saved on each thread switch. Instead the
+ *  TS bit is set whenever a thread is entered which doesn't own the FPU, and the
+ *  registers are swapped as soon as the thread tries to use the FPU. If the CPU
+ *  supports the fxsave / fxrstor instructions, the SSE registers are saved as
+ *  well, otherwise the kernel falls back to fnsave / frstor.
+ */
+
+#define CR0_MP			(1 << 1)
+#define CR0_EM			(1 << 2)
+#define CR0_TS			(1 << 3)
+#define CR0_NE			(1 << 5)
+
+#define CR4_OSFXSR		(1 << 9)
+#define CR4_OSXMMEXCPT	(1 << 10)
+
+#define CPUID_FXSR		(1 << 24)
+#define CPUID_SSE		(1 << 25)
+
+static bool fxsrSupported;
+static bool sseSupported;
+
+/* state loaded for threads using the FPU for the first time */
+static struct fpuContext fpuInitialContext;
+
+static inline uint32_t __getCR0()
+{
+	uint32_t value;
+	asm volatile("mov %%cr0, %0" : "=r" (value));
+	return value;
+}
+
+static inline void __setCR0(uint32_t value)
+{
+	asm volatile("mov %0, %%cr0" : : "r" (value));
+}
+
+static inline uint32_t __getCR4()
+{
+	uint32_t value;
+	asm volatile("mov %%cr4, %0" : "=r" (value));
+	return value;
+}
+
+static inline void __setCR4(uint32_t value)
+{
+	asm volatile("mov %0, %%cr4" : : "r" (value));
+}
+
+/* Sets the FPU related bits in the CR0 and CR4 register of the current processor, TS is cleared */
+static uint32_t __fpuSetupCPU()
+{
+	uint32_t cr0 = __getCR0();
+
+	cr0 &= ~CR0_EM; /* disable EMuleration */
+	cr0 &= ~CR0_TS;
+	cr0 |=  CR0_NE; /* enable Native Exception */
+	cr0 |=  CR0_MP; /* enable MP */
+	__setCR0(cr0);
+
+	if (fxsrSupported)
+		__setCR4(__getCR4() | CR4_OSFXSR | (sseSupported ? CR4_OSXMMEXCPT : 0));
+
+	return cr0;
+}
+
+/**
+ * @brief Initializes the FPU related bits in the CR0 and CR4 register
+ * @details If the CPU supports SSE, it is enabled for usermode programs.
+ *			Afterwards the TS bit is set, since the kernel shouldn't use the FPU.
+ */
+void fpuInit()
+{
+	uint32_t eax, ebx, ecx, edx;
+	uint32_t cr0;
+
+	asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+	fxsrSupported	= (edx & CPUID_FXSR) != 0;
+	sseSupported	= fxsrSupported && (edx & CPUID_SSE);
+
+	cr0 = __fpuSetupCPU();
+
+	/* create a clean state for new threads, which doesn't leak any register content */
+	asm volatile("fninit");
+	if (fxsrSupported)
+	{
+		asm volatile("fxsave %0" : "=m" (fpuInitialContext));
+		memset(fpuInitialContext.registerArea, 0, sizeof(fpuInitialContext.registerArea));
+		memset(fpuInitialContext.xmmRegisters, 0, sizeof(fpuInitialContext.xmmRegisters));
+		if (sseSupported)
+			fpuInitialContext.mxcsr = FPU_MXCSR_DEFAULT & fpuInitialContext.mxcsrMask;
+	}
+
+	__setCR0(cr0 | CR0_TS); /* enable TS bit (kernel shouldn't use FPU) */
+}
+
+/**
+ * @brief Initializes the FPU related bits on an application processor
+ * @details Uses the features detected by fpuInit() on the bootstrap processor.
+ */
+void fpuInitCPU()
+{
+	uint32_t cr0 = __fpuSetupCPU();
+
+	asm volatile("fninit");
+	__setCR0(cr0 | CR0_TS);
+}
+
+/**
+ * @brief Saves the current FPU state
+ * @details The TS bit has to be cleared before calling this function. If the
+ *			legacy fnsave instruction is used the FPU is reinitialized afterwards,
+ *			so the caller must not assume that the state is still loaded.
+ *
+ * @param fpu Pointer to the 16 byte aligned save area
+ */
+void fpuSave(struct fpuContext *fpu)
+{
+	assert(((uint32_t)fpu & 15) == 0);
+
+	if (fxsrSupported)
+		asm volatile("fxsave %0" : "=m" (*fpu));
+	else
+		asm volatile("fnsave %0; fwait" : "=m" (fpu->legacy));
+}
+
+/**
+ * @brief Restores a FPU state previously saved with fpuSave()
+ * @details Pending exceptions are cleared, otherwise the next FPU instruction
+ *			would immediately raise the exception again.
+ *
+ * @param fpu Pointer to the 16 byte aligned save area
+ */
+void fpuRestore(struct fpuContext *fpu)
+{
+	assert(((uint32_t)fpu & 15) == 0);
+
+	if (fxsrSupported)
+	{
+		fpu->statusWord &= fpu->controlWord | 0xff80;
+		asm volatile("fxrstor %0" : : "m" (*fpu));
+	}
+	else
+	{
+		fpu->legacy.statusWord &= fpu->legacy.controlWord | 0xff80;
+		asm volatile("frstor %0" : : "m" (fpu->legacy));
+	}
+}
+
+/**
+ * @brief Loads the initial FPU state for a thread using the FPU for the first time
+ */
+void fpuReset()
+{
+	if (fxsrSupported)
+		asm volatile("fxrstor %0" : : "m" (fpuInitialContext));
+	else
+		asm volatile("fninit");
+}
+
+/**
+ * @brief Returns the FPU status word of a saved FPU state
+ *
+ * @param fpu Pointer to the save area
+ * @return Value of the status word
+ */
+uint16_t fpuStatusWord(struct fpuContext *fpu)
+{
+	return fxsrSupported ? fpu->statusWord : fpu->legacy.statusWord;
+}
+
+/**
+ * @}
+ */
@@ -26,6 +26,8 @@
  */
 
 #include <hardware/gdt.h>
+#include <hardware/acpi.h>
+#include <hardware/smp.h>
 #include <memory/paging.h>
 #include <memory/physmem.h>
 #include <console/console.h>
@@ -38,8 +40,9 @@
  * @{
  */
 
-/* kernelstack */
+/* kernelstack, one page per processor */
 void *kernelStack;
+uint32_t kernelStackCount;
 
 /* gdt */
 static struct GDTTable gdtTable;
@@ -53,11 +56,21 @@ static struct IDTEntry *idtTableEntries;
 void *intJmpTable_kernel;
 void *intJmpTable_user;
 
+/* vsyscall */
+void *vsyscallPage;
+
 /* task */
 static struct taskContext *taskTable;
 
 static struct taskContext *TSS_kernel;
-static struct taskContext *TSS_user;
+
+/* context switch, the kernel esp is saved at the bottom of the entry stack */
+static void (__attribute__((cdecl)) *__switchToUsermode)(uint32_t cr3, struct interruptFrame *frame);
+static void (__attribute__((cdecl)) *__switchToUsermodeFast)(uint32_t cr3, struct interruptFrame *frame);
+
+/* sysenter */
+static bool sysenterEnabled;
+static uint32_t sysenterEntry;
 
 /* code and data segments */
 struct GDTEntry *codeRing0;
@@ -65,9 +78,8 @@ struct GDTEntry *dataRing0;
 struct GDTEntry *codeRing3;
 struct GDTEntry *dataRing3;
 
-/* task segments */
+/* task segments, consecutive entries for each processor */
 struct GDTEntry *kernelTask;
-struct GDTEntry *usermodeTask;
 
 #define INTJMP_ENTRY_SIZE 8
 #define INTJMP_ENTRY_MASK 7
@@ -131,15 +143,33 @@ asm(".text\n.align 4\n"
 "	ret\n"
 );
 
-uint32_t __attribute__((cdecl)) __runUserModeTask(uint16_t task);
-asm(".text\n.align 4\n"
-"__runUserModeTask:\n"
-"	pushw 4(%esp)\n"
-"	pushl $0\n"
-"	ljmp *(%esp)\n"
-"	add $6, %esp\n"
-"	ret\n"
-);
+static inline void __writeMSR(uint32_t msr, uint64_t value)
+{
+	asm volatile("wrmsr" : : "c" (msr), "A" (value));
+}
+
+/* Loads the sysenter entry point and the entry stack of a processor */
+static void __loadSysenter(uint32_t index)
+{
+	__writeMSR(MSR_SYSENTER_CS, gdtGetEntryOffset(codeRing0, GDT_CPL_RING0));
+	__writeMSR(MSR_SYSENTER_ESP, USERMODE_KERNELSTACK_LIMIT_CPU(index));
+	__writeMSR(MSR_SYSENTER_EIP, sysenterEntry);
+}
+
+/**
+ * @brief Checks if the CPU supports the SYSENTER / SYSEXIT instructions
+ * @details Some Pentium Pro processors report the SEP feature flag, but don't
+ *			implement the instructions, so we have to check the model number too.
+ *
+ * @return True if the instructions are supported, otherwise false
+ */
+static bool __cpuHasSysenter()
+{
+	uint32_t eax, ebx, ecx, edx;
+	asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+	if (!(edx & (1 << 11))) return false;
+	return !(((eax >> 8) & 0xF) == 6 && (eax & 0xFF) < 0x33);
+}
 
 void __attribute__((cdecl)) __setIDT(const struct IDTTable *table);
 asm(".text\n.align 4\n"
@@ -161,7 +191,13 @@ asm(".text\n.align 4\n"
  */
 static __attribute__((cdecl)) void __dispatchKernelInterrupt(uint32_t interrupt, uint32_t error, struct taskContext *context)
 {
-	uint32_t status = dispatchInterrupt(interrupt, error, NULL);
+	bool idle = (context->eip >= KERNEL_IDLE_BEGIN && context->eip < KERNEL_IDLE_END);
+	uint32_t status;
+
+	/* the kernel lock was released before the processor went idle */
+	if (idle) smpLock();
+
+	status = dispatchInterrupt(interrupt, error, NULL);
 
 	/* unable to process kernel interrupt - show bluescreen */
 	if (status != INTERRUPT_CONTINUE_EXECUTION && status != INTERRUPT_YIELD)
@@ -172,8 +208,8 @@ static __attribute__((cdecl)) void __dispatchKernelInterrupt(uint32_t interrupt,
 		consoleSystemFailure(error_unhandledKernelInterrupt, sizeof(args)/sizeof(args[0]), args, context);
 	}
 
-	/* kernel was idling */
-	if (context->eip >= KERNEL_IDLE_BEGIN && context->eip < KERNEL_IDLE_END)
+	/* kernel was idling, tssKernelIdle() returns with the kernel lock held */
+	if (idle)
 	{
 		context->eflags &= ~(1 << 9); /* disable interrupts again */
 		context->eip	 = KERNEL_IDLE_END;
@@ -247,55 +283,48 @@ static void __initBasicGDT()
 }
 
 /**
- * @brief Initializes the task registers
- * @details This function initializes the task registers. Since this is just a
- *			single processor operating system two tasks are sufficient: one for
- *			the kernel, and one for the current usermode process.
+ * @brief Initializes the task segments
+ * @details This function initializes one task segment for each processor. Threads
+ *			are switched in software, so the only purpose of the task segment is to
+ *			tell the CPU which entry stack should be used when an interrupt occurs
+ *			in usermode. The GDT entries are consecutive, so that the task register
+ *			can be used to identify the current processor.
  */
 static void __initBasicTask()
 {
 	struct taskContext *task = taskTable;
+	struct GDTEntry *entry;
+	uint32_t i;
 	assert(taskTable);
 
-	kernelTask = gdtGetFreeEntry();
-	gdtEntrySetAddress(kernelTask, (uint32_t)task);
-	gdtEntrySetLimit(kernelTask, sizeof(*task));
-	kernelTask->accessBits.accessed  = 1;
-	kernelTask->accessBits.readWrite = 0; /* busy flag for tasks */
-	kernelTask->accessBits.dc		 = 0;
-	kernelTask->accessBits.execute   = 1;
-	kernelTask->accessBits.isSystem  = 0;
-	kernelTask->accessBits.privlevel = GDT_CPL_RING0;
-	kernelTask->accessBits.present   = 1;
-	kernelTask->user     = 0;
-	kernelTask->reserved = 0;
-	kernelTask->is32bit  = 0; /* not used for tasks */
-
 	TSS_kernel = task;
-	memset(task, 0, sizeof(*task));
-	task->ldt		= 0;
-	task->iomap		= sizeof(*task);
-	task++;
-
-	usermodeTask = gdtGetFreeEntry();
-	gdtEntrySetAddress(usermodeTask, (uint32_t)task);
-	gdtEntrySetLimit(usermodeTask, sizeof(*task));
-	usermodeTask->accessBits.accessed  = 1;
-	usermodeTask->accessBits.readWrite = 0; /* busy flag for tasks */
-	usermodeTask->accessBits.dc		   = 0;
-	usermodeTask->accessBits.execute   = 1;
-	usermodeTask->accessBits.isSystem  = 0;
-	usermodeTask->accessBits.privlevel = GDT_CPL_RING0;
-	usermodeTask->accessBits.present   = 1;
-	usermodeTask->user     = 0;
-	usermodeTask->reserved = 0;
-	usermodeTask->is32bit  = 0; /* not used for tasks */
-
-	TSS_user = task;
-	memset(task, 0, sizeof(*task));
-	task->ldt		= 0;
-	task->iomap		= sizeof(*task);
-	task++;
+
+	for (i = 0; i < kernelStackCount; i++)
+	{
+		entry = gdtGetFreeEntry();
+		if (i == 0) kernelTask = entry;
+		assert(entry == kernelTask + i);
+
+		gdtEntrySetAddress(entry, (uint32_t)task);
+		gdtEntrySetLimit(entry, sizeof(*task));
+		entry->accessBits.accessed  = 1;
+		entry->accessBits.readWrite = 0; /* busy flag for tasks */
+		entry->accessBits.dc		= 0;
+		entry->accessBits.execute   = 1;
+		entry->accessBits.isSystem  = 0;
+		entry->accessBits.privlevel = GDT_CPL_RING0;
+		entry->accessBits.present   = 1;
+		entry->user     = 0;
+		entry->reserved = 0;
+		entry->is32bit  = 0; /* not used for tasks */
+
+		memset(task, 0, sizeof(*task));
+		task->esp0		= USERMODE_KERNELSTACK_LIMIT_CPU(i);
+		task->ss0		= gdtGetEntryOffset(dataRing0, GDT_CPL_RING0);
+		task->ldt		= 0;
+		task->iomap		= sizeof(*task);
+		task++;
+	}
 
 	/* ensure that all pointers are within the single task page */
 	assert((uint32_t)task - (uint32_t)taskTable <= PAGE_SIZE);
@@ -310,11 +339,12 @@ static void __initBasicTask()
  */
 static void __generateIntJmpTables()
 {
-	uint32_t i;
-	uint8_t *cur, *dispatcher;
+	uint32_t i, cr3;
+	uint8_t *cur, *dispatcher, *switcher, *switcherFast, *sysenter;
 
 	assert(intJmpTable_kernel && intJmpTable_user);
 	assert(INTJMP_ENTRY_SIZE * IDT_MAX_COUNT <= PAGE_SIZE);
+	assert(KERNELSTACK_SIZE == PAGE_SIZE);
 	assert(kernelTask);
 
 	/*
@@ -381,6 +411,8 @@ static void __generateIntJmpTables()
 	*cur++ = 0x2D;												/* sub eax, <offset> */
 	*(uint32_t *)cur = (USERMODE_INTJMP_ADDRESS + 8); cur += 4;
 	*cur++ = 0xC1; *cur++ = 0xE8; *cur++ = 0x03;				/* shr eax, 0x3 */
+	*cur++ = 0x6A; *cur++ = 0x02;								/* push 0x2 */
+	*cur++ = 0x9D;												/* popf (clear DF, TF, NT and AC) */
 	*cur++ = 0x54;												/* push esp (context) */
 	*cur++ = 0xFF; *cur++ = 0x74; *cur++ = 0x24; *cur++ = 0x6C; /* push DWORD PTR [esp+0x6c] (error code) */
 	*cur++ = 0x50;												/* push eax (interrupt nr) */
@@ -405,25 +437,181 @@ static void __generateIntJmpTables()
 	*cur++ = 0xCF;												/* iret */
 	assert(cur <= (uint8_t *)intJmpTable_kernel + PAGE_SIZE);
 
+	/*
+	 * Context switch code
+	 *
+	 * The following code is executed while switching the page directory and
+	 * therefore has to be available at the same address in the kernel and
+	 * in the usermode interrupt table.
+	 */
+
+	asm volatile("mov %%cr3, %0" : "=r" (cr3));
+
+	dispatcher	= (uint8_t *)intJmpTable_kernel + (USERMODE_INTJMP_SWITCH - USERMODE_INTJMP_ADDRESS);
+	assert(dispatcher >= cur);
+
+	/* STACK LAYOUT (see struct interruptFrame):
+	 *
+	 *  esp + 0x00: gs, fs, es, ds
+	 *  esp + 0x10: edi, esi, ebp, esp, ebx, edx, ecx, eax
+	 *  esp + 0x30: local call (used to determine interrupt number)
+	 *  esp + 0x34: errorcode or eax
+	 *  esp + 0x38: eip
+	 *  esp + 0x3C: cs
+	 *  esp + 0x40: eflags
+	 *  esp + 0x44: esp
+	 *  esp + 0x48: ss
+	 *
+	 */
+
+	cur = dispatcher;											/* <dispatcher>: */
+	*cur++ = 0x60;												/* pusha */
+	*cur++ = 0x1E;												/* push ds */
+	*cur++ = 0x06;												/* push es */
+	*cur++ = 0x0F; *cur++ = 0xA0;								/* push fs */
+	*cur++ = 0x0F; *cur++ = 0xA8;								/* push gs */
+	*cur++ = 0x6A; *cur++ = 0x02;								/* push 0x2 */
+	*cur++ = 0x9D;												/* popf (clear DF, TF, NT and AC) */
+	*cur++ = 0x66; *cur++ = 0xB8;								/* mov ax, <dataRing0> */
+	*(uint16_t *)cur = gdtGetEntryOffset(dataRing0, GDT_CPL_RING0); cur += 2;
+	*cur++ = 0x8E; *cur++ = 0xD8;								/* mov ds, ax */
+	*cur++ = 0x8E; *cur++ = 0xC0;								/* mov es, ax */
+	*cur++ = 0x8E; *cur++ = 0xE0;								/* mov fs, ax */
+	*cur++ = 0x8E; *cur++ = 0xE8;								/* mov gs, ax */
+	*cur++ = 0xB8;												/* mov eax, <kernel cr3> */
+	*(uint32_t *)cur = cr3; cur += 4;
+	*cur++ = 0x0F; *cur++ = 0x22; *cur++ = 0xD8;				/* mov cr3, eax */
+	*cur++ = 0x89; *cur++ = 0xE0;								/* mov eax, esp */
+	*cur++ = 0x25;												/* and eax, ~PAGE_MASK */
+	*(uint32_t *)cur = ~PAGE_MASK; cur += 4;
+	*cur++ = 0x8B; *cur++ = 0x20;								/* mov esp, DWORD PTR [eax] (saved kernel esp) */
+	*cur++ = 0x5D;												/* pop ebp */
+	*cur++ = 0x5F;												/* pop edi */
+	*cur++ = 0x5E;												/* pop esi */
+	*cur++ = 0x5B;												/* pop ebx */
+	*cur++ = 0xC3;												/* ret */
+
+	switcher = cur;												/* <switcher>: */
+	*cur++ = 0x53;												/* push ebx */
+	*cur++ = 0x56;												/* push esi */
+	*cur++ = 0x57;												/* push edi */
+	*cur++ = 0x55;												/* push ebp */
+	*cur++ = 0x8B; *cur++ = 0x44; *cur++ = 0x24; *cur++ = 0x14; /* mov eax, DWORD PTR [esp+0x14] (cr3) */
+	*cur++ = 0x8B; *cur++ = 0x4C; *cur++ = 0x24; *cur++ = 0x18; /* mov ecx, DWORD PTR [esp+0x18] (frame) */
+	*cur++ = 0x89; *cur++ = 0xCA;								/* mov edx, ecx */
+	*cur++ = 0x81; *cur++ = 0xE2;								/* and edx, ~PAGE_MASK */
+	*(uint32_t *)cur = ~PAGE_MASK; cur += 4;
+	*cur++ = 0x89; *cur++ = 0x22;								/* mov DWORD PTR [edx], esp */
+	*cur++ = 0x89; *cur++ = 0xCC;								/* mov esp, ecx */
+	*cur++ = 0x0F; *cur++ = 0x22; *cur++ = 0xD8;				/* mov cr3, eax */
+	*cur++ = 0x0F; *cur++ = 0xA9;								/* pop gs */
+	*cur++ = 0x0F; *cur++ = 0xA1;								/* pop fs */
+	*cur++ = 0x07;												/* pop es */
+	*cur++ = 0x1F;												/* pop ds */
+	*cur++ = 0x61;												/* popa */
+	*cur++ = 0x83; *cur++ = 0xC4; *cur++ = 0x08;				/* add esp, 0x8 */
+	*cur++ = 0xCF;												/* iret */
+
+	/* Same as <switcher>, but returns to the vsyscall page using sysexit,
+	 * which doesn't restore ecx and edx. The saved eflags are loaded with
+	 * interrupts still disabled, the sti shadow covers the sysexit. */
+	switcherFast = cur;											/* <switcherFast>: */
+	*cur++ = 0x53;												/* push ebx */
+	*cur++ = 0x56;												/* push esi */
+	*cur++ = 0x57;												/* push edi */
+	*cur++ = 0x55;												/* push ebp */
+	*cur++ = 0x8B; *cur++ = 0x44; *cur++ = 0x24; *cur++ = 0x14; /* mov eax, DWORD PTR [esp+0x14] (cr3) */
+	*cur++ = 0x8B; *cur++ = 0x4C; *cur++ = 0x24; *cur++ = 0x18; /* mov ecx, DWORD PTR [esp+0x18] (frame) */
+	*cur++ = 0x89; *cur++ = 0xCA;								/* mov edx, ecx */
+	*cur++ = 0x81; *cur++ = 0xE2;								/* and edx, ~PAGE_MASK */
+	*(uint32_t *)cur = ~PAGE_MASK; cur += 4;
+	*cur++ = 0x89; *cur++ = 0x22;								/* mov DWORD PTR [edx], esp */
+	*cur++ = 0x89; *cur++ = 0xCC;								/* mov esp, ecx */
+	*cur++ = 0x0F; *cur++ = 0x22; *cur++ = 0xD8;				/* mov cr3, eax */
+	*cur++ = 0x0F; *cur++ = 0xA9;								/* pop gs */
+	*cur++ = 0x0F; *cur++ = 0xA1;								/* pop fs */
+	*cur++ = 0x07;												/* pop es */
+	*cur++ = 0x1F;												/* pop ds */
+	*cur++ = 0x61;												/* popa */
+	*cur++ = 0x8B; *cur++ = 0x54; *cur++ = 0x24; *cur++ = 0x08; /* mov edx, DWORD PTR [esp+0x08] (eip) */
+	*cur++ = 0x8B; *cur++ = 0x4C; *cur++ = 0x24; *cur++ = 0x14; /* mov ecx, DWORD PTR [esp+0x14] (esp) */
+	*cur++ = 0x81; *cur++ = 0x64; *cur++ = 0x24; *cur++ = 0x10; /* and DWORD PTR [esp+0x10], ~0x200 (eflags) */
+	*(uint32_t *)cur = ~(1 << 9); cur += 4;
+	*cur++ = 0xFF; *cur++ = 0x74; *cur++ = 0x24; *cur++ = 0x10; /* push DWORD PTR [esp+0x10] */
+	*cur++ = 0x9D;												/* popf */
+	*cur++ = 0xFB;												/* sti */
+	*cur++ = 0x0F; *cur++ = 0x35;								/* sysexit */
+
+	/* The sysenter instruction doesn't save any state, so we have to build the
+	 * same interrupt frame as the usermode interrupt table would do for int 0x80.
+	 * The return address is a fixed location inside of the vsyscall page, the
+	 * usermode stack pointer is passed in ebp. SYSENTER only clears IF, VM and
+	 * RF, so the user flags are saved before the kernel flags are reset. */
+	sysenter = cur;												/* <sysenter>: */
+	*cur++ = 0x68;												/* push <dataRing3> (ss) */
+	*(uint32_t *)cur = gdtGetEntryOffset(dataRing3, GDT_CPL_RING3); cur += 4;
+	*cur++ = 0x55;												/* push ebp (esp) */
+	*cur++ = 0x9C;												/* pushf */
+	*cur++ = 0x6A; *cur++ = 0x02;								/* push 0x2 */
+	*cur++ = 0x9D;												/* popf (clear DF, TF, NT and AC) */
+	*cur++ = 0x81; *cur++ = 0x0C; *cur++ = 0x24;				/* or DWORD PTR [esp], 0x200 (enable interrupts) */
+	*(uint32_t *)cur = (1 << 9); cur += 4;
+	*cur++ = 0x68;												/* push <codeRing3> (cs) */
+	*(uint32_t *)cur = gdtGetEntryOffset(codeRing3, GDT_CPL_RING3); cur += 4;
+	*cur++ = 0x68;												/* push <vsyscall> (eip) */
+	*(uint32_t *)cur = USERMODE_VSYSCALL_SYSEXIT; cur += 4;
+	*cur++ = 0x50;												/* push eax */
+	*cur++ = 0x68;												/* push <intjmp 0x80> */
+	*(uint32_t *)cur = USERMODE_INTJMP_ADDRESS + INTJMP_ENTRY_SIZE * 0x80 + 6; cur += 4;
+	*cur++ = 0xE9;												/* jmp <dispatcher> */
+	*(uint32_t *)cur = dispatcher - (cur + 4); cur += 4;
+	assert(cur <= (uint8_t *)intJmpTable_kernel + PAGE_SIZE);
+
+	memcpy((uint8_t *)intJmpTable_user + (dispatcher - (uint8_t *)intJmpTable_kernel), dispatcher, cur - dispatcher);
+	__switchToUsermode		= (void *)(USERMODE_INTJMP_SWITCH + (switcher - dispatcher));
+	__switchToUsermodeFast	= (void *)(USERMODE_INTJMP_SWITCH + (switcherFast - dispatcher));
+
+	/* enable sysenter if supported - the selectors for sysexit are
+	 * derived from the kernel code selector, so the order matters. */
+	if (__cpuHasSysenter())
+	{
+		assert(gdtGetEntryOffset(dataRing0, GDT_CPL_RING0) == gdtGetEntryOffset(codeRing0, GDT_CPL_RING0) + 8);
+		assert(gdtGetEntryOffset(codeRing3, GDT_CPL_RING0) == gdtGetEntryOffset(codeRing0, GDT_CPL_RING0) + 16);
+		assert(gdtGetEntryOffset(dataRing3, GDT_CPL_RING0) == gdtGetEntryOffset(codeRing0, GDT_CPL_RING0) + 24);
+
+		sysenterEntry = USERMODE_INTJMP_SWITCH + (sysenter - dispatcher);
+		__loadSysenter(0);
+		sysenterEnabled = true;
+	}
+
+	/*
+	 * Vsyscall page
+	 */
+
+	cur = (uint8_t *)vsyscallPage + (USERMODE_VSYSCALL_SYSEXIT - USERMODE_VSYSCALL_ADDRESS);
+	*cur++ = 0x5D;												/* pop ebp */
+	*cur++ = 0xC3;												/* ret */
+
 	/*
 	 * Usermode interrupt table
 	 */
 
+	dispatcher = (uint8_t *)intJmpTable_user + (USERMODE_INTJMP_SWITCH - USERMODE_INTJMP_ADDRESS);
+
 	for (i = 0; i < IDT_MAX_COUNT; i++)
 	{
 		cur = (uint8_t *)intJmpTable_user + INTJMP_ENTRY_SIZE * i;
 
-		*cur++ = 0xEA; *(uint32_t *)cur = 0; cur += 4;			/* jmp seg:addr */
-		*(uint16_t *)cur = gdtGetEntryOffset(kernelTask, GDT_CPL_RING0); cur += 2;
+		if (!__isErrorCodeInterrupt(i))
+			*cur++ = 0x50;										/* push eax */
+		else
+			*cur++ = 0x90;										/* nop */
+
+		*cur++ = 0xE8;											/* call <dispatcher> */
+		*(uint32_t *)cur = dispatcher - (cur + 4); cur += 4;
+		*cur++ = 0xCC;											/* int 3 */
 		*cur++ = 0xCC;											/* int 3 */
 	}
-
-	dispatcher = (uint8_t *)intJmpTable_user + (USERMODE_INTJMP_ENABLE_FPU - USERMODE_INTJMP_ADDRESS);
-
-	cur = dispatcher;											/* <enable_fpu>: */
-	*cur++ = 0x0F; *cur++ = 0x06;								/* clts */
-	*cur++ = 0xCF;												/* iret */
-	assert(cur <= (uint8_t *)intJmpTable_user + PAGE_SIZE);
 }
 
 /**
@@ -437,14 +625,23 @@ void gdtInit()
 	assert(!idtTableEntries);
 	assert(!taskTable);
 	assert(!intJmpTable_kernel && !intJmpTable_user);
+	assert(!vsyscallPage);
 
 	assert(GDT_MAX_COUNT * sizeof(struct GDTEntry) == GDT_MAX_SIZE);
 	assert(GDT_MAX_PAGES * PAGE_SIZE == GDT_MAX_SIZE);
 	assert(IDT_MAX_COUNT * sizeof(struct IDTEntry) <= PAGE_SIZE);
-	assert(2 * sizeof(struct taskContext) <= PAGE_SIZE);
+	assert(sizeof(struct taskContext) <= PAGE_SIZE);
+	assert(sizeof(struct interruptFrame) == 0x4C);
+
+	/* one entry stack and task segment for each processor */
+	kernelStackCount = acpiCpuCount;
+	if (kernelStackCount < 1) kernelStackCount = 1;
+	if (kernelStackCount > SMP_MAX_CPUS) kernelStackCount = SMP_MAX_CPUS;
+	assert(kernelStackCount * sizeof(struct taskContext) <= PAGE_SIZE);
 
-	kernelStack	= pagingAllocatePhysMemUnpageable(NULL, 1, true, false);
-	memset(kernelStack, 0, PAGE_SIZE);
+	/* the kernel has to access the interrupt frame at the same address as the usermode */
+	kernelStack	= pagingAllocatePhysMemFixedUnpageable(NULL, (void *)USERMODE_KERNELSTACK_CPU(kernelStackCount - 1), kernelStackCount, true, false);
+	memset(kernelStack, 0, kernelStackCount * KERNELSTACK_SIZE);
 
 	gdtTableEntries = (struct GDTEntry *)pagingAllocatePhysMemFixedUnpageable(NULL, (void *)USERMODE_GDT_ADDRESS, GDT_MAX_PAGES, true, false);
 	memset(gdtTableEntries, 0, sizeof(struct GDTEntry) * GDT_MAX_COUNT);
@@ -461,6 +658,9 @@ void gdtInit()
 	intJmpTable_user = pagingAllocatePhysMemUnpageable(NULL, 1, true, false);
 	memset(intJmpTable_user, 0, PAGE_SIZE);
 
+	vsyscallPage = pagingAllocatePhysMemUnpageable(NULL, 1, true, false);
+	memset(vsyscallPage, 0xCC, PAGE_SIZE);
+
 	/* gdt */
 	__initBasicGDT();
 	gdtTable.limit   = GDT_MAX_SIZE - 1;
@@ -470,7 +670,6 @@ void gdtInit()
 
 	/* task */
 	__initBasicTask();
-	debugCaptureCpuContext(TSS_kernel);
 	__loadTSS(gdtGetEntryOffset(kernelTask, GDT_CPL_RING0));
 
 	/* idt */
@@ -496,6 +695,42 @@ void gdtInit()
 	__setIDT(&idtTable);
 }
 
+/**
+ * @brief Loads the Global and Interrupt Descriptor Table on an application processor
+ * @details The tables are shared by all processors and have to be initialized
+ *			by gdtInit() first. Each processor loads its own task segment, which
+ *			points to a separate entry stack, and sets up sysenter accordingly.
+ *
+ * @param index Index of the processor in the cpuTable
+ */
+void gdtInitCPU(uint32_t index)
+{
+	assert(gdtTableEntries);
+	assert(idtTableEntries);
+	assert(index < kernelStackCount);
+
+	__setGDT(&gdtTable);
+	__setSegments(gdtGetEntryOffset(codeRing0, GDT_CPL_RING0), gdtGetEntryOffset(dataRing0, GDT_CPL_RING0));
+	__loadTSS(gdtGetEntryOffset(kernelTask + index, GDT_CPL_RING0));
+	__setIDT(&idtTable);
+
+	if (sysenterEnabled)
+		__loadSysenter(index);
+}
+
+/**
+ * @brief Returns the index of the current processor
+ * @details Determined from the task register loaded by gdtInit() or gdtInitCPU().
+ *
+ * @return Index of the processor in the cpuTable
+ */
+uint32_t gdtGetCPUIndex()
+{
+	uint16_t selector;
+	asm volatile("str %0" : "=r" (selector));
+	return (selector - gdtGetEntryOffset(kernelTask, GDT_CPL_RING0)) / sizeof(struct GDTEntry);
+}
+
 /**
  * @brief Get a free entry in the GDT
  * @return Pointer to the free GDT entry
@@ -619,84 +854,137 @@ void gdtReleaseEntry(struct GDTEntry* entry)
 
 /**
  * @brief Run a thread
- * @details This function loads the saved thread context inside a hardware task and starts it.
+ * @details This function loads the saved thread context into the interrupt frame on the
+ *			usermode entry stack and returns to usermode using an iret. As soon as the next
+ *			interrupt occurs, the general purpose and segment registers are pushed onto the
+ *			same stack, and the kernel page directory is restored. Only this minimal state
+ *			is saved, all other fields of the thread context are left untouched.
+ *			The kernel lock is released while the thread runs, if another processor
+ *			terminated the thread in the meantime only IRQs are handled afterwards.
  *
- * @param[in] t A pointer to a thread structure containing the tss context
+ * @param[in] t A pointer to a thread structure containing the saved context
  *
  * @return Reason why the execution was interrupted, usually one of the \ref InterruptReturnValue "Interrupt return values"
  */
 uint32_t tssRunUsermodeThread(struct thread *t)
 {
-	uint32_t interrupt, error = 0;
-	uint32_t *args;
+	struct cpu *cpu = smpGetCPU();
+	struct interruptFrame *frame = (struct interruptFrame *)(USERMODE_KERNELSTACK_LIMIT_CPU(cpu->index) - sizeof(struct interruptFrame));
+	struct processSharedData *shared;
+	uint32_t interrupt, cr0, status;
+	uint64_t start, exit;
 
 	assert(t);
+	assert((t->task.cs & GDT_CPL_MASK) == GDT_CPL_RING3);
+	assert((t->task.ss & GDT_CPL_MASK) == GDT_CPL_RING3);
 
-	/* initialize user context with provided context */
-	*TSS_user = t->task;
+	/* publish the identifiers of the running thread in the shared data page */
+	shared = t->process->sharedData;
+	if (shared->threadID != (uint32_t)t)
+	{
+		shared->threadID			= (uint32_t)t;
+		shared->threadLocalBase		= t->user_threadLocalBase;
+		shared->threadLocalLength	= t->user_threadLocalLength << PAGE_BITS;
+	}
 
-	/* if FPU is enabled, we have to return in ring0, then clear the TS bit,
-	 * and afterwards switch back to the original ring3 code. */
-	if (t == lastFPUthread)
+	/* initialize interrupt frame with provided context */
+	frame->gs		= t->task.gs;
+	frame->fs		= t->task.fs;
+	frame->es		= t->task.es;
+	frame->ds		= t->task.ds;
+	frame->edi		= t->task.edi;
+	frame->esi		= t->task.esi;
+	frame->ebp		= t->task.ebp;
+	frame->ebx		= t->task.ebx;
+	frame->edx		= t->task.edx;
+	frame->ecx		= t->task.ecx;
+	frame->eax		= t->task.eax;
+	frame->eip		= t->task.eip;
+	frame->cs		= t->task.cs;
+	frame->eflags	= t->task.eflags;
+	frame->esp		= t->task.esp;
+	frame->ss		= t->task.ss;
+
+	/* the CPU doesn't set the TS bit for us anymore, so we have to ensure
+	 * that only the thread owning the FPU registers can use the FPU. */
+	if (t == cpu->lastFPUthread)
+		asm volatile("clts");
+	else
 	{
-		args = (uint32_t *)((uint32_t)kernelStack + PAGE_SIZE - 5 * sizeof(uint32_t));
-		args[0] = TSS_user->eip;
-		args[1] = TSS_user->cs;
-		args[2] = TSS_user->eflags;
-		args[3] = TSS_user->esp;
-		args[4] = TSS_user->ss;
-
-		TSS_user->eip		= USERMODE_INTJMP_ENABLE_FPU;
-		TSS_user->cs		= gdtGetEntryOffset(codeRing0, GDT_CPL_RING0);
-		TSS_user->eflags	= 0; /* real eflags will be restored later, it is important that interrupts are still disabled */
-		TSS_user->esp		= USERMODE_KERNELSTACK_LIMIT - 5 * sizeof(uint32_t);
-		TSS_user->ss		= gdtGetEntryOffset(dataRing0, GDT_CPL_RING0);
+		asm volatile("mov %%cr0, %0" : "=r" (cr0));
+		if (!(cr0 & (1 << 3)))
+			asm volatile("mov %0, %%cr0" : : "r" (cr0 | (1 << 3)));
 	}
 
-	__runUserModeTask(gdtGetEntryOffset(usermodeTask, GDT_CPL_RING0));
-	t->task = *TSS_user;
+	/* other processors have to interrupt us before they modify the process */
+	cpu->userProcess = t->process;
+	smpUnlock();
+
+	start = rdtsc();
 
-	assert(TSS_user->ss == t->task.ss0);
+	/* threads which entered the kernel using sysenter can be resumed with sysexit,
+	 * the vsyscall stub doesn't depend on the value of ecx, edx and eflags */
+	if (sysenterEnabled && t->task.eip == USERMODE_VSYSCALL_SYSEXIT &&
+		t->task.cs == gdtGetEntryOffset(codeRing3, GDT_CPL_RING3) &&
+		t->task.ss == gdtGetEntryOffset(dataRing3, GDT_CPL_RING3) &&
+		(t->task.eflags & ((1 << 9) | (1 << 8))) == (1 << 9))
+		__switchToUsermodeFast(t->task.cr3, frame);
+	else
+		__switchToUsermode(t->task.cr3, frame);
+
+	exit = rdtsc();
+	cpu->userProcess = NULL;
+
+	smpLock();
+	t->userTime += exit - start;
+
+	/* save the modified context */
+	t->task.gs		= frame->gs;
+	t->task.fs		= frame->fs;
+	t->task.es		= frame->es;
+	t->task.ds		= frame->ds;
+	t->task.edi		= frame->edi;
+	t->task.esi		= frame->esi;
+	t->task.ebp		= frame->ebp;
+	t->task.ebx		= frame->ebx;
+	t->task.edx		= frame->edx;
+	t->task.ecx		= frame->ecx;
+	t->task.eax		= frame->eax;
+	t->task.eip		= frame->eip;
+	t->task.cs		= frame->cs;
+	t->task.eflags	= frame->eflags;
+	t->task.esp		= frame->esp;
+	t->task.ss		= frame->ss;
 
 	/* determine which interrupt it was */
-	interrupt = (t->task.eip - (USERMODE_INTJMP_ADDRESS + 7));
+	interrupt = (frame->intjmp - (USERMODE_INTJMP_ADDRESS + 6));
 	assert((interrupt & INTJMP_ENTRY_MASK) == 0);
 	interrupt >>= INTJMP_ENTRY_BITS;
 	assert((interrupt & ~255) == 0);
 
-	/* read args from kernel stack in the user process */
-	args = (uint32_t *)((uint32_t)kernelStack + TSS_user->esp - USERMODE_KERNELSTACK_ADDRESS);
-	if (TSS_user->esp == USERMODE_KERNELSTACK_LIMIT - 6 * sizeof(uint32_t) /* && __isErrorCodeInterrupt(interrupt) */)
-	{
-		error			= args[0];
-		t->task.eip		= args[1];
-		t->task.cs		= args[2];
-		t->task.eflags	= args[3];
-		t->task.esp		= args[4];
-		t->task.ss		= args[5];
-	}
-	else if (TSS_user->esp == USERMODE_KERNELSTACK_LIMIT - 5 * sizeof(uint32_t))
-	{
-		t->task.eip		= args[0];
-		t->task.cs		= args[1];
-		t->task.eflags	= args[2];
-		t->task.esp		= args[3];
-		t->task.ss		= args[4];
-	}
-	else
+	/* we should now be again in usermode */
+	if ((t->task.cs & GDT_CPL_MASK) != GDT_CPL_RING3 || (t->task.ss & GDT_CPL_MASK) != GDT_CPL_RING3)
 		consoleSystemFailure(error_usermodeInterruptInvalid, 0, NULL, &t->task);
 
-	/* we should now be again in usermode */
-	assert((t->task.cs & GDT_CPL_MASK) == GDT_CPL_RING3);
-	assert((t->task.ss & GDT_CPL_MASK) == GDT_CPL_RING3);
+	/* thread was terminated by another processor, syscalls and exceptions are dropped */
+	if (!t->process)
+	{
+		if (interrupt >= 0x20 && interrupt != 0x80)
+			dispatchInterrupt(interrupt, 0, NULL);
+		return INTERRUPT_YIELD;
+	}
 
-	return dispatchInterrupt(interrupt, error, t);
+	status = dispatchInterrupt(interrupt, __isErrorCodeInterrupt(interrupt) ? frame->error : 0, t);
+	t->kernelTime += rdtsc() - exit;
+	return status;
 }
 
 /**
  * @brief Puts the processor into idle state
  * @details This function puts the processor into idle state and waits for the next IRQ. As soon
  *			as the next interrupt was handled this function returns and IRQs are disabled again.
+ *			The kernel lock has to be released before, it is acquired again by the interrupt
+ *			dispatcher and still held when this function returns.
  */
 void __attribute__((cdecl)) tssKernelIdle();
 asm(".text\n.align 4\n"
@@ -26,6 +26,7 @@
  */
 
 #include <hardware/pic.h>
+#include <hardware/apic.h>
 #include <interrupt/interrupt.h>
 #include <console/console.h>
 #include <util/util.h>
@@ -40,12 +41,19 @@
  *  interrupts / IRQs. A device driver can set an IRQ handler through picReserveIRQ()
  *  and free it again with picFreeIRQ().
  *
+ *  If the system has an IO APIC, the legacy PIC is completely masked and the
+ *  IRQs are routed through the \ref APIC instead. The interface for device
+ *  drivers stays the same.
+ *
  *  For more information about IRQs and Interrupts take a look at http://wiki.osdev.org/IRQ
  */
 uint32_t irqBase = 0;
 
 irq_callback irqTable[IRQ_COUNT];
 
+/* IRQs are delivered by the IO APIC instead of the legacy PIC */
+static bool irqUseApic = false;
+
 /**
  * @brief Handle an interrupt which is assigned to an IRQ
  * @details This function is executed whenever an interrupt is called which is
@@ -84,10 +92,15 @@ static uint32_t interrupt_irq(uint32_t interrupt, UNUSED uint32_t error, UNUSED
 	}
 
 	/* Send EOI */
-	if(irq >= 8)
-		outb(PIC2_COMMAND_PORT, PIC_EOI);
+	if (irqUseApic)
+		apicEOI();
+	else
+	{
+		if(irq >= 8)
+			outb(PIC2_COMMAND_PORT, PIC_EOI);
 
-	outb(PIC1_COMMAND_PORT, PIC_EOI);
+		outb(PIC1_COMMAND_PORT, PIC_EOI);
+	}
 
 	return status;
 }
@@ -96,7 +109,8 @@ static uint32_t interrupt_irq(uint32_t interrupt, UNUSED uint32_t error, UNUSED
  * @brief Initializes the programmable interrupt controller
  * @details The PIC is required to handle hardware interrupts / IRQs.
  *			There are (theoretically) 16 hardware IRQs which can be mapped
- *			to interrupts.
+ *			to interrupts. If apicInit() was successful and the IO APIC can
+ *			route all IRQs, the legacy PIC is masked and the IO APIC is used.
  *
  * @param interruptOffset The first interrupt which should handle the IRQs
  */
@@ -128,6 +142,14 @@ void picInit(uint32_t interruptOffset)
 	outb(PIC1_DATA_PORT, 0xF & (~IRQ_SLAVE));
 	outb(PIC2_DATA_PORT, 0xF);
 
+	/* use the IO APIC if possible, the legacy PIC must not signal any IRQs then */
+	irqUseApic = apicInitIRQ(interruptOffset);
+	if (irqUseApic)
+	{
+		outb(PIC1_DATA_PORT, 0xFF);
+		outb(PIC2_DATA_PORT, 0xFF);
+	}
+
 	/* reset the irqTable */
 	for (i = 0; i < IRQ_COUNT; i++)
 		irqTable[i] = NULL;
@@ -160,6 +182,12 @@ bool picReserveIRQ(uint32_t irq, irq_callback callback)
 	assert(irq != IRQ_SLAVE);
 	irqTable[irq] = callback;
 
+	if (irqUseApic)
+	{
+		apicSetIRQMask(irq, false);
+		return true;
+	}
+
 	/* actually unmask the irq on the PIC */
 	if(irq < 8)
 	{
@@ -195,6 +223,12 @@ void picFreeIRQ(uint32_t irq)
 	assert(irq != IRQ_SLAVE);
 	irqTable[irq] = NULL;
 
+	if (irqUseApic)
+	{
+		apicSetIRQMask(irq, true);
+		return;
+	}
+
 	if(irq < 8)
 	{
 		port = PIC1_DATA_PORT;
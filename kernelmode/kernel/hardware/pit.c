@@ -85,4 +85,28 @@ void pitSetFrequency(uint32_t channel, uint32_t frequency)
 
 	pitSetValue(channel, PIT_MODE_RATE_GENERATOR, value);
 }
+
+/**
+ * @brief Reads the current counter value of the PIT
+ * @details The status and counter are latched with the read-back command, so that
+ *			both bytes of the counter belong together. After pitSetValue() it takes
+ *			one clock cycle until the new value is loaded, in this case the function
+ *			returns false.
+ *
+ * @param channel Either 0, 1 or 2
+ * @param value Will be filled out with the current counter value
+ * @return True on success, false if the counter wasn't loaded yet
+ */
+bool pitGetValue(uint32_t channel, uint16_t *value)
+{
+	uint8_t status;
+	assert(channel < PIT_CHANNEL_COUNT);
+
+	outb(PIT_MODE_PORT, PIT_READ_BACK(channel));
+	status  = inb(PIT_CHANNEL_BASE + channel);
+	*value  = inb(PIT_CHANNEL_BASE + channel);
+	*value |= inb(PIT_CHANNEL_BASE + channel) << 8;
+
+	return !(status & PIT_STATUS_NULL_COUNT);
+}
 /** @}*/
\ No newline at end of file
@@ -0,0 +1,412 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <hardware/smp.h>
+#include <hardware/acpi.h>
+#include <hardware/apic.h>
+#include <hardware/gdt.h>
+#include <hardware/tsc.h>
+#include <hardware/fpu.h>
+#include <interrupt/interrupt.h>
+#include <memory/physmem.h>
+#include <memory/paging.h>
+#include <process/process.h>
+#include <process/thread.h>
+#include <util/util.h>
+
+/**
+ * \defgroup SMP Symmetric Multiprocessing
+ * \addtogroup SMP
+ *  @{
+ *  After a reset only the bootstrap processor executes code, all other
+ *  processors (application processors) wait for an INIT and a STARTUP
+ *  interprocessor interrupt. The STARTUP message contains the page number
+ *  of the code which is executed in real mode, so a small trampoline has to
+ *  be copied below 1MB. The trampoline switches to protected mode, enables
+ *  paging with the page directory of the kernel and jumps to __smpEntryAP()
+ *  using a separate stack for each processor.
+ *
+ *  Each processor has its own task state segment, usermode entry stack and
+ *  run queues, and schedules threads on its own. The kernel itself is
+ *  protected by a single lock, which is held whenever a processor executes
+ *  kernel code and only released while it runs usermode code or waits for
+ *  interrupts. All threads of a process are queued on the same processor,
+ *  since they share the page which publishes the running thread. Processes
+ *  are moved to other processors by the scheduler to balance the load.
+ */
+
+struct cpu cpuTable[SMP_MAX_CPUS];
+uint32_t cpuCount = 0;
+
+/* incremented whenever a kernel mapping changes, see smpLock() */
+volatile uint32_t smpTLBGeneration = 0;
+
+/* kernel lock, processors acquire it in the order of their tickets */
+static volatile uint32_t smpLockNext = 0;
+static volatile uint32_t smpLockServing = 0;
+
+/* physical address of the trampoline (below 1MB) */
+static uint32_t trampolineAddress = 0;
+
+/* values passed to the trampoline, must match the layout of the code below */
+struct smpTrampolineData
+{
+	struct GDTTable gdt;
+	uint32_t jumpOffset;
+	uint16_t jumpSelector;
+	uint32_t cr3;
+	uint32_t esp;
+	uint32_t entry;
+	uint32_t arg;
+} __attribute__((packed));
+
+extern uint8_t __smpTrampolineBegin[];
+extern uint8_t __smpTrampoline32[];
+extern uint8_t __smpTrampolineGDT[];
+extern uint8_t __smpTrampolineData[];
+extern uint8_t __smpTrampolineEnd[];
+
+asm(".text\n.align 4\n"
+".code16\n"
+"__smpTrampolineBegin:\n"
+"	cli\n"
+"	cld\n"
+"	xorl %ebx, %ebx\n"
+"	movw %cs, %bx\n"
+"	movw %bx, %ds\n"
+"	shll $4, %ebx\n"
+"	lgdtl (__smpTrampolineData - __smpTrampolineBegin)\n"
+"	movl %cr0, %eax\n"
+"	orl $1, %eax\n"
+"	movl %eax, %cr0\n"
+"	ljmpl *(__smpTrampolineData - __smpTrampolineBegin + 6)\n"
+".code32\n"
+"__smpTrampoline32:\n"
+"	movw $0x10, %ax\n"
+"	movw %ax, %ds\n"
+"	movw %ax, %es\n"
+"	movw %ax, %fs\n"
+"	movw %ax, %gs\n"
+"	movw %ax, %ss\n"
+"	movl (__smpTrampolineData - __smpTrampolineBegin + 12)(%ebx), %eax\n"
+"	movl %eax, %cr3\n"
+"	movl %cr0, %eax\n"
+"	orl $0x80000000, %eax\n"
+"	movl %eax, %cr0\n"
+"	movl (__smpTrampolineData - __smpTrampolineBegin + 16)(%ebx), %esp\n"
+"	pushl (__smpTrampolineData - __smpTrampolineBegin + 24)(%ebx)\n"
+"	call *(__smpTrampolineData - __smpTrampolineBegin + 20)(%ebx)\n"
+"1:	cli\n"
+"	hlt\n"
+"	jmp 1b\n"
+".align 8\n"
+"__smpTrampolineGDT:\n"
+"	.quad 0x0000000000000000\n"
+"	.quad 0x00CF9A000000FFFF\n" /* ring 0 code */
+"	.quad 0x00CF92000000FFFF\n" /* ring 0 data */
+"__smpTrampolineData:\n"
+"	.fill 28, 1, 0\n"
+"__smpTrampolineEnd:\n"
+);
+
+uint32_t __getCR3();
+asm(".text\n.align 4\n"
+"__getCR3:\n"
+"	movl %cr3, %eax\n"
+"	ret\n"
+);
+
+/* Reloads the page directory, which flushes all TLB entries */
+static inline void __smpFlushTLB()
+{
+	uint32_t cr3;
+	asm volatile("mov %%cr3, %0\n mov %0, %%cr3" : "=r" (cr3) : : "memory");
+}
+
+/* Busy waits for the given amount of nanoseconds */
+static void __smpDelay(uint64_t ns)
+{
+	uint64_t end = tscGetNanoseconds() + ns;
+	while (tscGetNanoseconds() < end)
+		asm volatile("pause");
+}
+
+/**
+ * @brief Handles the wakeup interprocessor interrupt
+ * @details The interrupt only returns the processor to the kernel, so that it
+ *			checks its run queues again.
+ *
+ * @param interrupt Always #SMP_WAKEUP_VECTOR
+ * @param error Does not apply to this interrupt
+ * @param t Not used
+ * @return Always #INTERRUPT_CONTINUE_EXECUTION
+ */
+static uint32_t interrupt_wakeup(UNUSED uint32_t interrupt, UNUSED uint32_t error, UNUSED struct thread *t)
+{
+	apicEOI();
+	return INTERRUPT_CONTINUE_EXECUTION;
+}
+
+/**
+ * @brief Entry point of the application processors
+ * @details Called by the trampoline code with the kernel page directory and
+ *			the stack of the processor. Loads the descriptor tables and the task
+ *			register, initializes the FPU and the local APIC and marks the processor
+ *			as online. Afterwards the processor waits for the kernel lock and
+ *			schedules threads until all processes have been terminated.
+ *
+ * @param cpu Pointer to the cpu structure of this processor
+ */
+static void __attribute__((cdecl, noreturn, used)) __smpEntryAP(struct cpu *cpu)
+{
+	gdtInitCPU(cpu->index);
+	fpuInitCPU();
+	apicInitCPU();
+
+	__sync_synchronize();
+	cpu->online = true;
+
+	smpLock();
+	threadSchedule();
+
+	/* the bootstrap processor might be idle and has to notice it too */
+	smpWakeup(&cpuTable[0]);
+	smpUnlock();
+
+	for (;;)
+		asm volatile("cli\n hlt");
+}
+
+/* Sends the INIT-SIPI-SIPI sequence and waits until the processor is online */
+static bool __smpStartCPU(struct cpu *cpu)
+{
+	struct smpTrampolineData *data;
+	uint64_t timeout;
+
+	data = (struct smpTrampolineData *)(trampolineAddress + (__smpTrampolineData - __smpTrampolineBegin));
+	data->esp	= (uint32_t)cpu->stack + SMP_STACK_PAGES * PAGE_SIZE;
+	data->arg	= (uint32_t)cpu;
+	__sync_synchronize();
+
+	apicSendIPI(cpu->apicID, APIC_ICR_INIT | APIC_ICR_ASSERT | APIC_ICR_LEVEL);
+	apicSendIPI(cpu->apicID, APIC_ICR_INIT | APIC_ICR_LEVEL);
+	__smpDelay(SMP_INIT_DELAY);
+
+	/* the second STARTUP message is only required if the first one got lost */
+	apicSendIPI(cpu->apicID, APIC_ICR_STARTUP | (trampolineAddress >> PAGE_BITS));
+	__smpDelay(SMP_STARTUP_DELAY);
+	if (!cpu->online)
+		apicSendIPI(cpu->apicID, APIC_ICR_STARTUP | (trampolineAddress >> PAGE_BITS));
+
+	timeout = tscGetNanoseconds() + SMP_STARTUP_TIMEOUT;
+	while (!cpu->online)
+	{
+		if (tscGetNanoseconds() >= timeout)
+			return false;
+		asm volatile("pause");
+	}
+
+	return true;
+}
+
+/**
+ * @brief Reserves a page below 1MB for the trampoline code
+ * @details The page is added to the boot map, such that the trampoline can
+ *			continue to execute at the same address after paging was enabled.
+ *			This function has to be called after acpiInit() and before pagingInit().
+ */
+void smpReserveMemory()
+{
+	uint32_t index;
+
+	assert(!trampolineAddress);
+
+	if (acpiCpuCount < 2)
+		return;
+
+	/* the first page contains the real mode interrupt table and stays reserved */
+	if (!physMemTryAllocPage(true, &index)) return;
+	if (index == 0 && !physMemTryAllocPage(true, &index)) return;
+	if (index >= (0x100000 >> PAGE_BITS)) return;
+
+	trampolineAddress = index << PAGE_BITS;
+	physMemProtectBootEntry(trampolineAddress, PAGE_SIZE);
+}
+
+/**
+ * @brief Starts all application processors
+ * @details Adds the bootstrap processor to the cpuTable and afterwards sends
+ *			the startup sequence to each enabled processor listed in the \ref ACPI
+ *			tables. Processors which don't respond in time keep their entry
+ *			with online set to false. Requires the \ref GDT and \ref TSC to be
+ *			initialized and apicInit() and timerInit() have to be called before.
+ *			The bootstrap processor acquires the kernel lock, so the application
+ *			processors only start to schedule threads when threadSchedule() is called.
+ */
+void smpInit()
+{
+	struct smpTrampolineData *data;
+	uint32_t i;
+
+	assert(cpuCount == 0);
+
+	smpLock();
+
+	cpuTable[0].index		= 0;
+	cpuTable[0].apicID		= 0;
+	cpuTable[0].bootstrap	= true;
+	cpuTable[0].online		= true;
+	cpuTable[0].stack		= NULL;
+	cpuCount = 1;
+
+	if (!apicAvailable())
+		return;
+
+	cpuTable[0].apicID = apicGetID();
+
+	/* application processors need the APIC timer for their time slices */
+	if (!trampolineAddress || !apicTimerAvailable())
+		return;
+
+	assert(interruptReserve(SMP_WAKEUP_VECTOR, interrupt_wakeup));
+
+	memcpy((void *)trampolineAddress, __smpTrampolineBegin, __smpTrampolineEnd - __smpTrampolineBegin);
+
+	data = (struct smpTrampolineData *)(trampolineAddress + (__smpTrampolineData - __smpTrampolineBegin));
+	data->gdt.limit		= 3 * sizeof(struct GDTEntry) - 1;
+	data->gdt.address	= trampolineAddress + (__smpTrampolineGDT - __smpTrampolineBegin);
+	data->jumpOffset	= trampolineAddress + (__smpTrampoline32 - __smpTrampolineBegin);
+	data->jumpSelector	= 0x08;
+	data->cr3			= __getCR3();
+	data->entry			= (uint32_t)__smpEntryAP;
+
+	/* each processor needs its own entry stack and task state segment */
+	for (i = 0; i < acpiCpuCount && cpuCount < kernelStackCount; i++)
+	{
+		struct cpu *cpu = &cpuTable[cpuCount];
+		if (acpiCpuApicID[i] == cpuTable[0].apicID)
+			continue;
+
+		cpu->index		= cpuCount;
+		cpu->apicID		= acpiCpuApicID[i];
+		cpu->bootstrap	= false;
+		cpu->online		= false;
+		cpu->stack		= pagingAllocatePhysMemUnpageable(NULL, SMP_STACK_PAGES, true, false);
+
+		/* the entry and stack are kept on failure, the processor might still start later */
+		__smpStartCPU(cpu);
+		cpuCount++;
+	}
+}
+
+/**
+ * @brief Returns the cpu structure of the current processor
+ * @details Each processor uses its own task state segment, so the task register
+ *			identifies the processor without accessing the local APIC.
+ *
+ * @return Pointer to the entry in the cpuTable
+ */
+struct cpu *smpGetCPU()
+{
+	return &cpuTable[gdtGetCPUIndex()];
+}
+
+/**
+ * @brief Acquires the kernel lock
+ * @details The kernel lock is held while a processor executes kernel code, it is
+ *			only released to run usermode code or to wait for interrupts. Kernel
+ *			mappings are only invalidated on the processor which changed them, so
+ *			the TLB is flushed if the kernel page tables were modified in the meantime.
+ */
+void smpLock()
+{
+	uint32_t ticket = __sync_fetch_and_add(&smpLockNext, 1);
+	struct cpu *cpu;
+
+	while (smpLockServing != ticket)
+		asm volatile("pause");
+
+	cpu = smpGetCPU();
+	if (cpu->tlbGeneration != smpTLBGeneration)
+	{
+		cpu->tlbGeneration = smpTLBGeneration;
+		__smpFlushTLB();
+	}
+}
+
+/**
+ * @brief Releases the kernel lock
+ */
+void smpUnlock()
+{
+	__sync_synchronize();
+	smpLockServing++;
+}
+
+/**
+ * @brief Makes another processor check its run queues
+ * @details An interprocessor interrupt is only sent if the processor is idle or
+ *			runs usermode code, otherwise it is waiting for the kernel lock and
+ *			checks its run queues anyway. Has to be called with the kernel lock held.
+ *
+ * @param cpu Pointer to the cpu structure of the target processor
+ */
+void smpWakeup(struct cpu *cpu)
+{
+	if (cpu == smpGetCPU()) return;
+
+	if (cpu->idle || cpu->userProcess)
+		apicSendIPI(cpu->apicID, APIC_ICR_FIXED | SMP_WAKEUP_VECTOR);
+}
+
+/**
+ * @brief Interrupts all processors running usermode code of a process
+ * @details Waits until the processors have returned to the kernel, afterwards the
+ *			threads and the page tables of the process can be modified safely. The
+ *			page directory is reloaded before the process continues, which also
+ *			flushes the TLB. Has to be called with the kernel lock held.
+ *
+ * @param p Pointer to the kernel process object
+ */
+void smpStopProcess(struct process *p)
+{
+	uint32_t i;
+
+	for (i = 0; i < cpuCount; i++)
+	{
+		struct cpu *cpu = &cpuTable[i];
+		if (cpu->userProcess != p) continue;
+
+		apicSendIPI(cpu->apicID, APIC_ICR_FIXED | SMP_WAKEUP_VECTOR);
+		while (cpu->userProcess == p)
+			asm volatile("pause");
+	}
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <hardware/tsc.h>
+#include <hardware/pit.h>
+#include <util/util.h>
+
+/**
+ * \defgroup TSC Time Stamp Counter
+ * \addtogroup TSC
+ *  @{
+ *  The time stamp counter is incremented with a constant rate on all CPUs
+ *  supported by the kernel and can be read without leaving the current
+ *  privilege level. Its frequency is measured once at boot time with the
+ *  help of the \ref PIT, afterwards it is used as the main clock source.
+ */
+
+static uint64_t tscFrequency;
+static uint64_t tscBase;
+
+/**
+ * @brief Measures the frequency of the time stamp counter
+ * @details Channel 0 of the PIT is started in one-shot mode and the number of TSC
+ *			ticks is counted until #TSC_CALIBRATION_TICKS PIT ticks have elapsed.
+ *			This has to be done before the PIT IRQ is enabled, the channel has
+ *			to be reprogrammed afterwards.
+ */
+void tscInit()
+{
+	uint16_t start, value;
+	uint64_t tscStart, tscEnd;
+
+	pitSetValue(0, PIT_MODE_INTERRUPT_ON_TERMINAL, 0xFFFF);
+
+	/* wait until the counter is loaded and starts counting */
+	while (!pitGetValue(0, &start));
+	do
+	{
+		tscStart = rdtsc();
+		assert(pitGetValue(0, &value));
+	}
+	while (value == start);
+	start = value;
+
+	do
+	{
+		tscEnd = rdtsc();
+		assert(pitGetValue(0, &value));
+	}
+	while ((uint16_t)(start - value) < TSC_CALIBRATION_TICKS);
+
+	tscFrequency = (tscEnd - tscStart) * PIT_FREQUENCY / (uint16_t)(start - value);
+	assert(tscFrequency);
+
+	tscBase = rdtsc();
+}
+
+/**
+ * @brief Returns the value of the time stamp counter at the end of the calibration
+ * @details This is the point of time which corresponds to a kernel timestamp of 0.
+ *
+ * @return Value of the time stamp counter
+ */
+uint64_t tscGetBase()
+{
+	return tscBase;
+}
+
+/**
+ * @brief Returns the frequency of the time stamp counter
+ *
+ * @return Frequency in Hz
+ */
+uint64_t tscGetFrequency()
+{
+	return tscFrequency;
+}
+
+/**
+ * @brief Returns the number of nanoseconds since tscInit() was called
+ *
+ * @return Monotonic time in nanoseconds
+ */
+uint64_t tscGetNanoseconds()
+{
+	uint64_t ticks = rdtsc() - tscBase;
+
+	/* split the value, otherwise the multiplication overflows after a few seconds */
+	return (ticks / tscFrequency) * 1000000000ULL +
+		   (ticks % tscFrequency) * 1000000000ULL / tscFrequency;
+}
+
+/**
+ * @}
+ */
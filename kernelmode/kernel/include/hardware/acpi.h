@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _H_ACPI_
+#define _H_ACPI_
+
+#ifdef __KERNEL__
+
+	#include <stdbool.h>
+	#include <stdint.h>
+
+	/**
+	 * \addtogroup ACPI
+	 * @{
+	 */
+
+	/** Maximum number of processors taken from the MADT */
+	#define ACPI_MAX_CPUS			16
+	/** Maximum number of IO APICs taken from the MADT */
+	#define ACPI_MAX_IOAPICS		4
+	/** Number of legacy ISA IRQs which can be redirected */
+	#define ACPI_ISA_IRQ_COUNT		16
+
+	/* signatures, stored as little endian integers */
+	#define ACPI_SIGNATURE_RSDP_LOW		0x20445352 /* "RSD " */
+	#define ACPI_SIGNATURE_RSDP_HIGH	0x20525450 /* "PTR " */
+	#define ACPI_SIGNATURE_MADT			0x43495041 /* "APIC" */
+
+	/* entry types of the MADT */
+	#define ACPI_MADT_LOCAL_APIC		0
+	#define ACPI_MADT_IO_APIC			1
+	#define ACPI_MADT_INTERRUPT_OVERRIDE	2
+	#define ACPI_MADT_LOCAL_APIC_ENABLED	1
+
+	/* polarity and trigger mode of an interrupt source override */
+	#define ACPI_IRQ_POLARITY_MASK		0x3
+	#define ACPI_IRQ_POLARITY_LOW		0x3
+	#define ACPI_IRQ_TRIGGER_MASK		0xC
+	#define ACPI_IRQ_TRIGGER_LEVEL		0xC
+
+	struct acpiRSDP
+	{
+		uint32_t signature[2];
+		uint8_t checksum;
+		uint8_t oemID[6];
+		uint8_t revision;
+		uint32_t rsdtAddress;
+	} __attribute__((packed));
+
+	struct acpiHeader
+	{
+		uint32_t signature;
+		uint32_t length;
+		uint8_t revision;
+		uint8_t checksum;
+		uint8_t oemID[6];
+		uint8_t oemTableID[8];
+		uint32_t oemRevision;
+		uint32_t creatorID;
+		uint32_t creatorRevision;
+	} __attribute__((packed));
+
+	struct acpiMADT
+	{
+		struct acpiHeader header;
+		uint32_t localApicAddress;
+		uint32_t flags;
+	} __attribute__((packed));
+
+	struct acpiMADTEntry
+	{
+		uint8_t type;
+		uint8_t length;
+	} __attribute__((packed));
+
+	struct acpiMADTLocalApic
+	{
+		struct acpiMADTEntry entry;
+		uint8_t processorID;
+		uint8_t apicID;
+		uint32_t flags;
+	} __attribute__((packed));
+
+	struct acpiMADTIOApic
+	{
+		struct acpiMADTEntry entry;
+		uint8_t ioApicID;
+		uint8_t reserved;
+		uint32_t address;
+		uint32_t gsiBase;
+	} __attribute__((packed));
+
+	struct acpiMADTInterruptOverride
+	{
+		struct acpiMADTEntry entry;
+		uint8_t bus;
+		uint8_t source;
+		uint32_t gsi;
+		uint16_t flags;
+	} __attribute__((packed));
+
+	struct acpiIOApic
+	{
+		uint32_t address;
+		uint32_t gsiBase;
+	};
+
+	struct acpiIRQRoute
+	{
+		uint32_t gsi;
+		uint16_t flags;
+	};
+
+	/* information collected by acpiInit() */
+	extern uint32_t acpiLocalApicAddress;
+	extern uint32_t acpiCpuCount;
+	extern uint8_t acpiCpuApicID[ACPI_MAX_CPUS];
+	extern uint32_t acpiIOApicCount;
+	extern struct acpiIOApic acpiIOApics[ACPI_MAX_IOAPICS];
+	extern struct acpiIRQRoute acpiIRQRoutes[ACPI_ISA_IRQ_COUNT];
+
+	bool acpiInit();
+
+	/**
+	 * @}
+	 */
+
+#endif
+
+#endif /* _H_ACPI_ */
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _H_APIC_
+#define _H_APIC_
+
+#ifdef __KERNEL__
+
+	#include <stdbool.h>
+	#include <stdint.h>
+
+	#include <hardware/pic.h>
+
+	/**
+	 * \addtogroup APIC
+	 * @{
+	 */
+
+	/* interrupt vectors used by the local APIC */
+	#define APIC_TIMER_VECTOR			0x30
+	#define APIC_SPURIOUS_VECTOR		0xFF
+
+	/* register offsets of the local APIC */
+	#define APIC_REG_ID					0x020
+	#define APIC_REG_VERSION			0x030
+	#define APIC_REG_TPR				0x080
+	#define APIC_REG_EOI				0x0B0
+	#define APIC_REG_SVR				0x0F0
+	#define APIC_REG_ICR_LOW			0x300
+	#define APIC_REG_ICR_HIGH			0x310
+	#define APIC_REG_LVT_TIMER			0x320
+	#define APIC_REG_TIMER_INITIAL		0x380
+	#define APIC_REG_TIMER_CURRENT		0x390
+	#define APIC_REG_TIMER_DIVIDE		0x3E0
+
+	#define APIC_SVR_ENABLE				0x100
+	#define APIC_LVT_MASKED				0x10000
+	#define APIC_LVT_TIMER_PERIODIC		0x20000
+	#define APIC_TIMER_DIVIDE_16		0x3
+
+	/** Duration of the calibration of the APIC timer against the \ref TSC (in ns) */
+	#define APIC_TIMER_CALIBRATION		10000000
+
+	/* interprocessor interrupt command */
+	#define APIC_ICR_FIXED				0x00000
+	#define APIC_ICR_INIT				0x00500
+	#define APIC_ICR_STARTUP			0x00600
+	#define APIC_ICR_PENDING			0x01000
+	#define APIC_ICR_ASSERT				0x04000
+	#define APIC_ICR_LEVEL				0x08000
+
+	/* register offsets of the IO APIC */
+	#define IOAPIC_REG_SELECT			0x00
+	#define IOAPIC_REG_WINDOW			0x10
+
+	/* indirect registers of the IO APIC */
+	#define IOAPIC_VERSION				0x01
+	#define IOAPIC_REDIRECTION(i)		(0x10 + 2 * (i))
+
+	/* bits of the lower half of a redirection entry */
+	#define IOAPIC_ACTIVE_LOW			0x02000
+	#define IOAPIC_LEVEL				0x08000
+	#define IOAPIC_MASKED				0x10000
+
+	bool apicInit();
+	void apicInitCPU();
+	bool apicAvailable();
+	uint32_t apicGetID();
+	void apicSendIPI(uint32_t apicID, uint32_t command);
+	void apicEOI();
+
+	bool apicInitIRQ(uint32_t interruptOffset);
+	void apicSetIRQMask(uint32_t irq, bool masked);
+
+	bool apicTimerInit();
+	bool apicTimerAvailable();
+	bool apicTimerReserve(irq_callback callback);
+	void apicTimerStart(uint64_t ns, bool periodic);
+	void apicTimerStop();
+
+	/**
+	 * @}
+	 */
+
+#endif
+
+#endif /* _H_APIC_ */
\ No newline at end of file
@@ -77,7 +77,34 @@ struct taskContext
 	uint16_t iomap;
 } __attribute__((packed));
 
-struct fpuContext
+struct interruptFrame
+{
+	uint32_t gs;					/* 0x00 */
+	uint32_t fs;					/* 0x04 */
+	uint32_t es;					/* 0x08 */
+	uint32_t ds;					/* 0x0C */
+
+	uint32_t edi;					/* 0x10 */
+	uint32_t esi;					/* 0x14 */
+	uint32_t ebp;					/* 0x18 */
+	uint32_t __esp;					/* 0x1C */
+	uint32_t ebx;					/* 0x20 */
+	uint32_t edx;					/* 0x24 */
+	uint32_t ecx;					/* 0x28 */
+	uint32_t eax;					/* 0x2C */
+
+	uint32_t intjmp;				/* 0x30 */
+	uint32_t error;					/* 0x34 */
+
+	uint32_t eip;					/* 0x38 */
+	uint32_t cs;					/* 0x3C */
+	uint32_t eflags;				/* 0x40 */
+	uint32_t esp;					/* 0x44 */
+	uint32_t ss;					/* 0x48 */
+} __attribute__((packed));
+
+/* layout used by fnsave / frstor */
+struct fpuLegacyContext
 {
 	uint16_t controlWord;
 	uint16_t __res1;
@@ -94,4 +121,33 @@ struct fpuContext
 	uint8_t  registerArea[80];
 } __attribute__((packed));
 
+/* layout used by fxsave / fxrstor, the legacy layout is used if the CPU doesn't support it */
+struct fpuContext
+{
+	union
+	{
+		struct
+		{
+			uint16_t controlWord;	/* 0x00 */
+			uint16_t statusWord;	/* 0x02 */
+			uint8_t  tagWord;		/* 0x04 */
+			uint8_t  __res1;
+			uint16_t opcode;		/* 0x06 */
+			uint32_t codePointer;	/* 0x08 */
+			uint16_t codeSegment;	/* 0x0C */
+			uint16_t __res2;
+			uint32_t dataPointer;	/* 0x10 */
+			uint16_t dataSegment;	/* 0x14 */
+			uint16_t __res3;
+			uint32_t mxcsr;			/* 0x18 */
+			uint32_t mxcsrMask;		/* 0x1C */
+			uint8_t  registerArea[128];	/* 0x20 */
+			uint8_t  xmmRegisters[128];	/* 0xA0 */
+			uint8_t  __res4[224];		/* 0x120 */
+		} __attribute__((packed));
+
+		struct fpuLegacyContext legacy;
+	};
+} __attribute__((packed, aligned(16)));
+
 #endif /* _H_CONTEXT_ */
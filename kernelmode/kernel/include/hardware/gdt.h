@@ -61,7 +61,7 @@
 	 * @}
 	 */
 
-	/** Size of the ring0 kernel stack which is mapped into each process */
+	/** Size of the ring0 entry stack which is mapped into each process */
 	#define KERNELSTACK_SIZE	PAGE_SIZE
 
 	/**
@@ -95,25 +95,41 @@
 	#define USERMODE_IDT_ADDRESS			0xFF811000
 	#define USERMODE_INTJMP_ADDRESS			0xFF812000
 	#define USERMODE_TASK_ADDRESS			0xFF813000
+	#define USERMODE_VSYSCALL_ADDRESS		0xFF814000
+	/* USERMODE_SHARED_DATA_ADDRESS		0xFF815000 (see process/process.h) */
 
 	#define USERMODE_KERNELSTACK_LIMIT		(USERMODE_KERNELSTACK_ADDRESS + KERNELSTACK_SIZE)
 
-	/* dispatcher ring0 functions */
-	#define USERMODE_INTJMP_ENABLE_FPU		(USERMODE_INTJMP_ADDRESS + 2048)
+	/* entry stacks of the other processors are placed below the one of the bootstrap processor */
+	#define USERMODE_KERNELSTACK_CPU(i)			(USERMODE_KERNELSTACK_ADDRESS - (i) * KERNELSTACK_SIZE)
+	#define USERMODE_KERNELSTACK_LIMIT_CPU(i)	(USERMODE_KERNELSTACK_CPU(i) + KERNELSTACK_SIZE)
+
+	/* context switch code, mapped at the same address in the kernel and each process */
+	#define USERMODE_INTJMP_SWITCH			(USERMODE_INTJMP_ADDRESS + 3072)
+
+	/* usermode return stub for sysenter syscalls */
+	#define USERMODE_VSYSCALL_SYSEXIT		(USERMODE_VSYSCALL_ADDRESS + 0)
+
+	/* model specific registers used for sysenter */
+	#define MSR_SYSENTER_CS					0x174
+	#define MSR_SYSENTER_ESP				0x175
+	#define MSR_SYSENTER_EIP				0x176
 
 	/* memory locations filled by GDT functions */
 	extern void *kernelStack;
+	extern uint32_t kernelStackCount;
 
 	extern void *intJmpTable_kernel;
 	extern void *intJmpTable_user;
 
+	extern void *vsyscallPage;
+
 	extern struct GDTEntry *codeRing0;
 	extern struct GDTEntry *dataRing0;
 	extern struct GDTEntry *codeRing3;
 	extern struct GDTEntry *dataRing3;
 
 	extern struct GDTEntry *kernelTask;
-	extern struct GDTEntry *usermodeTask;
 
 	/**
 	 * \addtogroup GDT
@@ -177,6 +193,8 @@
 	} __attribute__((packed));
 
 	void gdtInit();
+	void gdtInitCPU(uint32_t index);
+	uint32_t gdtGetCPUIndex();
 	struct GDTEntry* gdtGetFreeEntry();
 	uint32_t gdtGetEntryOffset(struct GDTEntry* entry, uint32_t ring);
 	void gdtEntrySetAddress(struct GDTEntry* entry, uint32_t address);
@@ -68,11 +68,18 @@
 	#define PIT_CONTROL_VALUE(FORMAT, MODE, REGISTER, CHANNEL) \
 		((CHANNEL) << 6 | (REGISTER) << 4 | (MODE) << 1 | FORMAT)
 
+	/* latches the status and counter of a single channel */
+	#define PIT_READ_BACK(CHANNEL)	(0xC0 | (2 << (CHANNEL)))
+
+	/* set in the status byte while a new counter value wasn't loaded yet */
+	#define PIT_STATUS_NULL_COUNT	(1 << 6)
+
 	#define PIT_CHANNEL_COUNT	3
 	#define PIT_FREQUENCY		1193182
 
 	void pitSetValue(uint32_t channel, uint32_t mode, uint16_t value);
 	void pitSetFrequency(uint32_t channel, uint32_t frequency);
+	bool pitGetValue(uint32_t channel, uint16_t *value);
 
 #endif
 
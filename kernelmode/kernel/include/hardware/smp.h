@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _H_SMP_
+#define _H_SMP_
+
+#ifdef __KERNEL__
+
+	#include <stdbool.h>
+	#include <stdint.h>
+
+	#include <hardware/acpi.h>
+	#include <process/thread.h>
+	#include <util/list.h>
+
+	/**
+	 * \addtogroup SMP
+	 * @{
+	 */
+
+	#define SMP_MAX_CPUS			ACPI_MAX_CPUS
+	#define SMP_STACK_PAGES			4
+
+	/* interprocessor interrupt used to make a processor reschedule */
+	#define SMP_WAKEUP_VECTOR		0x31
+
+	/* delays of the INIT-SIPI-SIPI sequence (in ns) */
+	#define SMP_INIT_DELAY			10000000
+	#define SMP_STARTUP_DELAY		200000
+	#define SMP_STARTUP_TIMEOUT		100000000
+
+	struct cpu
+	{
+		uint32_t index;
+		uint32_t apicID;
+		bool bootstrap;
+		volatile bool online;
+
+		/* kernel stack used by application processors */
+		void *stack;
+
+		/* run queues and scheduler state, protected by the kernel lock */
+		struct linkedList threadQueues[THREAD_PRIORITY_LEVELS];
+		struct thread *current;
+		struct thread *lastFPUthread;
+		uint64_t lastAging;
+		uint64_t idleTicks;
+
+		/* end of the current time slice (or 0), in ns */
+		uint64_t sliceEnd;
+
+		/* generation of the kernel page tables the TLB was flushed for */
+		uint32_t tlbGeneration;
+
+		/* read by other processors to decide if an interprocessor interrupt is required */
+		volatile bool idle;
+		struct process * volatile userProcess;
+	};
+
+	extern struct cpu cpuTable[SMP_MAX_CPUS];
+	extern uint32_t cpuCount;
+	extern volatile uint32_t smpTLBGeneration;
+
+	void smpReserveMemory();
+	void smpInit();
+	struct cpu *smpGetCPU();
+
+	void smpLock();
+	void smpUnlock();
+	void smpWakeup(struct cpu *cpu);
+	void smpStopProcess(struct process *p);
+
+	/**
+	 * @}
+	 */
+
+#endif
+
+#endif /* _H_SMP_ */
\ No newline at end of file
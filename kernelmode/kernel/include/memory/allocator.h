@@ -28,16 +28,57 @@
 #ifndef _H_ALLOCATOR_
 #define _H_ALLOCATOR_
 
+#include <stdint.h>
+
+/**
+ * @anchor HeapTags
+ * @name Heap allocation tags
+ * Subsystem which owns a block of kernel memory, used for accounting.
+ * @{
+ */
+enum
+{
+	HEAP_TAG_GENERIC,
+	HEAP_TAG_PROCESS,
+	HEAP_TAG_THREAD,
+	HEAP_TAG_HANDLES,
+	HEAP_TAG_PIPE,
+	HEAP_TAG_EVENT,
+	HEAP_TAG_SEMAPHORE,
+	HEAP_TAG_TIMER,
+	HEAP_TAG_FILESYSTEM,
+	HEAP_TAG_FILE_BUFFER,
+	HEAP_TAG_LOADER,
+	HEAP_TAG_IORING,
+
+	HEAP_TAG_COUNT
+};
+/**
+ * @}
+ */
+
+struct heapTagInfo
+{
+	char name[16];
+
+	uint32_t liveBytes;
+	uint32_t peakBytes;
+	uint32_t liveAllocations;
+	uint32_t totalAllocations;
+};
+
 #ifdef __KERNEL__
 	/** \addtogroup Heap
 	 *  @{
 	 */
 
-	void *heapAlloc(uint32_t length);
+	void heapInit();
+	void *heapAlloc(uint32_t length, uint32_t tag);
 	void heapFree(void *addr);
 	uint32_t heapSize(void *addr);
 	void *heapReAlloc(void *addr, uint32_t length);
 	void heapVerify();
+	uint32_t heapInfo(struct heapTagInfo *info, uint32_t count);
 
 	/**
 	 *  @}
@@ -85,6 +85,7 @@
 	void *pagingAllocatePhysMem(struct process *p, uint32_t length, bool rw, bool user);
 	void *pagingAllocatePhysMemUnpageable(struct process *p, uint32_t length, bool rw, bool user);
 	void *pagingTryAllocatePhysMem(struct process *p, uint32_t length, bool rw, bool user);
+	void *pagingTryAllocatePhysMemUnpageable(struct process *p, uint32_t length, bool rw, bool user);
 
 	void *pagingAllocatePhysMemFixed(struct process *p, void *addr, uint32_t length, bool rw, bool user);
 	void *pagingAllocatePhysMemFixedUnpageable(struct process *p, void *addr, uint32_t length, bool rw, bool user);
@@ -99,7 +100,10 @@
 	uint32_t pagingGetPhysMem(struct process *p, void *addr);
 
 	void *pagingMapRemoteMemory(struct process *dst_p, struct process *src_p, void *dst_addr, void *src_addr, uint32_t length, bool rw, bool user);
+	void pagingMarkNoFork(struct process *p, void *addr, uint32_t length);
 	void *pagingTryMapUserMem(struct process *src_p, void *src_addr, uint32_t length, bool rw);
+	void *pagingTryShareUserPage(struct process *src_p, void *src_addr);
+	bool pagingTryMoveToUserPage(struct process *dst_p, void *dst_addr, void *src_addr);
 
 	void pagingAllocProcessPageTable(struct process *p);
 	void pagingForkProcessPageTable(struct process *destination, struct process *source);
@@ -48,6 +48,14 @@
 	#define PHYSMEM_FREE     0
 	#define PHYSMEM_RESERVED 1
 
+	#define MAX_SHRINKERS	8
+
+	/**
+	 * Callback which releases cached memory under memory pressure, should
+	 * return the number of physical pages which have been released.
+	 */
+	typedef uint32_t (*shrinker_callback)(uint32_t pages);
+
 	void physMemInit(multiboot_info_t* bootInfo);
 
 	uint32_t physMemRAMSize();
@@ -60,6 +68,7 @@
 	void physMemFreeMemory(uint32_t addr, uint32_t length);
 	void physMemSetMemoryBits(uint32_t startIndex, uint32_t length, bool reserved);
 
+	bool physMemTryAllocPage(bool lowmem, uint32_t *index);
 	uint32_t physMemAllocPage(bool lowmem);
 	uint32_t physMemReleasePage(uint32_t index);
 
@@ -67,6 +76,11 @@
 	uint32_t physMemMarkUnpageable(uint32_t index);
 	bool physMemIsLastRef(uint32_t index);
 
+	bool physMemRegisterShrinker(shrinker_callback callback);
+	void physMemUnregisterShrinker(shrinker_callback callback);
+	uint32_t physMemShrink(uint32_t pages);
+	bool physMemIsShrinking();
+
 	void physMemPageOut(UNUSED uint32_t length);
 	uint32_t physMemPageIn(UNUSED uint32_t hdd_index);
 
@@ -28,6 +28,22 @@
 #ifndef _H_EVENT_
 #define _H_EVENT_
 
+#include <stdint.h>
+
+/* modes for waiting on an event */
+#define EVENT_WAIT_IDENTIFIER	0 /* returns the identifier of one ready object */
+#define EVENT_WAIT_READY		1 /* returns the number of ready objects, use SYSCALL_EVENT_GET_READY to fetch them */
+
+/* flag for the attach mode (pipes only), the remaining bits are passed to the wait operation of the object */
+#define EVENT_ATTACH_EDGE		0x80000000
+
+/* filled by SYSCALL_EVENT_GET_READY */
+struct eventReady
+{
+	uint32_t identifier;
+	uint32_t result;
+};
+
 #ifdef __KERNEL__
 
 	struct event;
@@ -41,29 +57,48 @@
 	struct event
 	{
 		struct object obj;
-		struct linkedList waiters;
+		struct linkedList waiters;			/* threads waiting with EVENT_WAIT_IDENTIFIER */
+		struct linkedList readyWaiters;		/* threads waiting with EVENT_WAIT_READY */
 
 		struct linkedList subEvents;
 		uint32_t status;
 
+		/* subevents which completed, and subevents which have to be armed again */
+		struct linkedList ready;
+		struct linkedList rearm;
+		uint32_t readyCount;
+
 		bool wakeupAll;
 	};
 
+	/* a subevent is always in exactly one of these states */
+	#define SUBEVENT_BLOCKED	0 /* in the wait queue of the object (obj.entry) */
+	#define SUBEVENT_READY		1 /* in the ready list of the event (entry_ready) */
+	#define SUBEVENT_REARM		2 /* in the rearm list of the event (entry_ready) */
+
 	struct subEvent
 	{
 		struct object obj;
-		bool blocked;
+		uint32_t state;
 
 		struct event *event; /* not refcounted */
 		struct linkedList entry_event;
+		struct linkedList entry_ready;
 
 		struct object *wait;
 		uint32_t waitMode;
 
 		uint32_t identifier;
+		uint32_t result;
+
+		/* edge triggered, ignore completions while rearming until the object blocks */
+		bool edgeTriggered;
+		bool suppress;
 	};
 
 	struct event *eventCreate(bool wakeupAll);
+	struct event *eventIsValid(struct object *obj);
+	uint32_t eventGetReady(struct event *e, struct eventReady *buf, uint32_t count);
 
 #endif
 
@@ -116,10 +116,15 @@
 	struct openedFile *fileOpen(struct file *file);
 	struct openedDirectory *directoryOpen(struct directory *directory);
 
+	int32_t openedFileWriteAt(struct openedFile *h, uint8_t *buf, uint32_t length, uint32_t offset);
+	int32_t openedFileReadAt(struct openedFile *h, uint8_t *buf, uint32_t length, uint32_t offset);
+	int32_t openedFileSplice(struct openedFile *h, struct object *dst, uint32_t length);
+
 	void fileSystemInit(void *addr, uint32_t length);
 
 	struct directory *fileSystemIsValidDirectory(struct object *obj);
 	struct file *fileSystemIsValidFile(struct object *obj);
+	struct openedFile *fileSystemIsValidOpenedFile(struct object *obj);
 
 	struct directory *fileSystemGetRoot();
 
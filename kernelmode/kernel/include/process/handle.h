@@ -50,8 +50,8 @@
 		struct object **handles;
 	};
 
-	void handleTableInit(struct handleTable *table);
-	void handleForkTable(struct handleTable *destination, struct handleTable *source);
+	bool handleTableInit(struct handleTable *table);
+	bool handleForkTable(struct handleTable *destination, struct handleTable *source);
 	void handleTableFree(struct handleTable *table);
 
 	uint32_t handleAllocate(struct handleTable *table, struct object *object);
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef _H_IORING_
+#define _H_IORING_
+
+#include <stdint.h>
+
+/* maximum number of submission entries, the completion queue has twice as many */
+#define IORING_MAX_ENTRIES		1024
+
+/* operations which can be submitted */
+#define IORING_OP_NOP			0
+#define IORING_OP_READ			1 /* objectRead, deferred while the object is not readable */
+#define IORING_OP_WRITE			2 /* objectWrite, deferred while the object is not writeable */
+#define IORING_OP_WAIT			3 /* objectWait with the given mode */
+#define IORING_OP_SIGNAL		4 /* objectSignal with the given mode as result */
+
+struct ioRingSubmission
+{
+	uint32_t opcode;
+	int32_t handle;
+	void *buffer;
+	uint32_t length;
+	uint32_t mode;
+	uint32_t userData;
+};
+
+struct ioRingCompletion
+{
+	uint32_t userData;
+	int32_t result;
+};
+
+/*
+ * Header at the beginning of the shared ring memory. The user appends submissions
+ * at sqTail and consumes completions at cqHead, the kernel advances the other two
+ * indices. All indices are free running, the position in the queue is the index
+ * modulo the number of entries.
+ */
+struct ioRingHeader
+{
+	volatile uint32_t sqHead;
+	volatile uint32_t sqTail;
+	volatile uint32_t cqHead;
+	volatile uint32_t cqTail;
+
+	uint32_t sqEntries;
+	uint32_t cqEntries;
+	uint32_t sqOffset; /* offset of the submission queue in bytes */
+	uint32_t cqOffset; /* offset of the completion queue in bytes */
+};
+
+#ifdef __KERNEL__
+
+	struct ioRing;
+
+	#include <stdbool.h>
+
+	#include <process/object.h>
+	#include <process/process.h>
+	#include <util/list.h>
+
+	struct ioRing
+	{
+		struct object obj;
+		struct linkedList waiters;
+
+		/* owner of the ring, buffers are accessed in its address space (NULL after exec) */
+		struct process *process;
+		struct linkedList entry_process;
+
+		/* kernel mapping of the ring memory */
+		struct ioRingHeader *header;
+		struct ioRingSubmission *sq;
+		struct ioRingCompletion *cq;
+		uint32_t length; /* in pages */
+		void *user_base;
+
+		/* private copies of the indices advanced by the kernel */
+		uint32_t sqHead;
+		uint32_t cqTail;
+		uint32_t sqMask;
+		uint32_t cqMask;
+
+		/* deferred operations, either queued on their object or waiting for a retry */
+		struct linkedList requests;
+		struct linkedList retry;
+		uint32_t inflight;
+	};
+
+	struct ioRequest
+	{
+		/* obj.entry is linked into the wait queue of the target or the retry list of the ring */
+		struct object obj;
+		struct ioRing *ring; /* not refcounted */
+		struct linkedList entry_ring;
+
+		struct object *target;
+		struct ioRingSubmission sqe;
+	};
+
+	struct ioRing *ioRingCreate(struct process *p, uint32_t entries);
+	struct ioRing *ioRingIsValid(struct object *obj);
+	int32_t ioRingEnter(struct ioRing *r, uint32_t count);
+	void ioRingDetachProcess(struct process *p);
+
+#endif
+
+#endif /* _H_IORING_ */
\ No newline at end of file
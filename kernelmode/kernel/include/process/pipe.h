@@ -31,24 +31,43 @@
 #ifdef __KERNEL__
 
 	struct pipe;
+	struct process;
 
 	#include <stdint.h>
 	#include <stdbool.h>
 
 	#include <process/object.h>
+	#include <memory/physmem.h>
 	#include <util/list.h>
 
+	#define MAX_PIPE_BUFFER_SIZE	0x10000
+
+	/* unaligned data of MAX_PIPE_BUFFER_SIZE bytes touches one more page, round up to a power of two */
+	#define PIPE_SEGMENT_COUNT		((MAX_PIPE_BUFFER_SIZE >> PAGE_BITS) * 2)
+	#define PIPE_SEGMENT_MASK		(PIPE_SEGMENT_COUNT - 1)
+
+	/* number of empty segments kept per pipe */
+	#define PIPE_SPARE_SEGMENTS		4
+
 	struct pipe
 	{
 		struct object obj;
 		struct linkedList writeWaiters;
 		struct linkedList readWaiters;
 
-		uint8_t *buffer;
-		uint32_t size;
+		/* entry in the pipeList */
+		struct linkedList entry_list;
+
+		/* ring of page-sized segments, only the ones containing data are allocated */
+		uint8_t *segments[PIPE_SEGMENT_COUNT];
+		uint32_t sharedSegments; /* bitmask of segments borrowed from a writer */
 		uint32_t writePos;
 		uint32_t readPos;
 
+		/* empty segments which can be reused without allocating memory */
+		uint8_t *spare[PIPE_SPARE_SEGMENTS];
+		uint32_t spareCount;
+
 		bool writeable;
 	};
 
@@ -57,7 +76,13 @@
 		struct object obj;
 	};
 
+	void pipeInit();
 	struct pipe *pipeCreate();
+	struct pipe *pipeIsValid(struct object *obj);
+	int32_t pipeWritePages(struct pipe *p, struct process *proc, void *addr, uint32_t length);
+	int32_t pipeReadPages(struct pipe *p, struct process *proc, void *addr, uint32_t length);
+	int32_t pipeSplice(struct pipe *p, struct object *dst, uint32_t length);
+	int32_t pipeTee(struct pipe *p, struct pipe *dst, uint32_t length);
 	struct stdout *stdoutCreate();
 
 #endif
@@ -43,11 +43,43 @@ struct processInfo
 	uint32_t handleCount;
 	uint32_t numberOfTotalThreads;
 	uint32_t numberOfBlockedThreads;
+
+	/* highest priority of all threads */
+	uint32_t priority;
+
+	/* cpu time (in TSC ticks) and statistics of all threads, including terminated ones */
+	uint64_t userTime;
+	uint64_t kernelTime;
+	uint32_t contextSwitches;
+	uint32_t syscalls;
+};
+
+/* read-only page maintained by the kernel, mapped into each process */
+#define USERMODE_SHARED_DATA_ADDRESS	0xFF815000
+
+struct processSharedData
+{
+	/* TSC value at boot and frequency in Hz, allows calculating the kernel timestamp */
+	uint64_t tscBase;
+	uint64_t tscFrequency;
+
+	/* identifiers of the process and the running thread (same as processInfo.processID) */
+	uint32_t processID;
+	uint32_t threadID;
+
+	/* same values as returned by the corresponding syscalls */
+	void *threadLocalBase;
+	uint32_t threadLocalLength;
+	void *programArgumentsBase;
+	uint32_t programArgumentsLength;
+	void *environmentVariablesBase;
+	uint32_t environmentVariablesLength;
 };
 
 #ifdef __KERNEL__
 
 	struct process;
+	struct cpu;
 
 	#include <stdbool.h>
 
@@ -57,6 +89,19 @@ struct processInfo
 	#include <memory/paging.h>
 	#include <util/list.h>
 
+	/* number of retired stacks / thread local storage blocks kept per process */
+	#define PROCESS_REGION_CACHE_SIZE	8
+
+	struct userRegionCache
+	{
+		uint32_t count;
+		struct
+		{
+			void *base;
+			uint32_t length; /* in pages */
+		} regions[PROCESS_REGION_CACHE_SIZE];
+	};
+
 	extern struct linkedList processList;
 
 	struct process
@@ -71,6 +116,9 @@ struct processInfo
 		/* list of threads associated to this process */
 		struct linkedList threads;
 
+		/* processor the threads are queued on */
+		struct cpu *cpu;
+
 		/* page directory and page tables (mapped into the kernel) */
 		struct pagingEntry *pageDirectory;
 		struct pagingEntry *pageTables[PAGETABLE_COUNT];
@@ -88,9 +136,27 @@ struct processInfo
 
 		/* handles */
 		struct handleTable handles;
+
+		/* IO rings mapped into this process */
+		struct linkedList ioRings;
+
+		/* kernel mapping of the page at USERMODE_SHARED_DATA_ADDRESS */
+		struct processSharedData *sharedData;
+
+		/* memory of terminated threads, reused by threadCreate */
+		struct userRegionCache stackCache;
+		struct userRegionCache threadLocalCache;
+
+		/* accumulated statistics of terminated threads */
+		uint64_t userTime;
+		uint64_t kernelTime;
+		uint32_t contextSwitches;
+		uint32_t syscalls;
 	};
 
 	struct process *processCreate(struct process *original);
+	void processMapSharedData(struct process *p);
+	void processUpdateSharedData(struct process *p);
 	uint32_t processCount();
 	uint32_t processInfo(struct processInfo *info, uint32_t count);
 
@@ -28,12 +28,33 @@
 #ifndef _H_THREAD_
 #define _H_THREAD_
 
+#include <stdint.h>
+
+/* threads with a higher priority are scheduled first */
+#define THREAD_PRIORITY_LEVELS		8
+#define THREAD_PRIORITY_MIN			0
+#define THREAD_PRIORITY_DEFAULT		3
+#define THREAD_PRIORITY_MAX			(THREAD_PRIORITY_LEVELS - 1)
+
+/* used by SYSCALL_CREATE_THREAD_EX */
+struct threadCreateInfo
+{
+	void *entryPoint;
+
+	/* initial register values */
+	uint32_t eax;
+	uint32_t ebx;
+	uint32_t ecx;
+	uint32_t edx;
+
+	/* size of the stack in bytes, or 0 for the default size */
+	uint32_t stackSize;
+};
 
 #ifdef __KERNEL__
 
 	struct thread;
 
-	#include <stdint.h>
 	#include <stdbool.h>
 
 	#include <process/object.h>
@@ -41,20 +62,31 @@
 	#include <hardware/context.h>
 	#include <util/list.h>
 
-	extern struct linkedList threadList;
-	extern struct thread *lastFPUthread;
-
 	struct thread
 	{
 		struct object obj;
 		struct linkedList waiters;
 		bool blocked;
 
+		/* user address the thread is sleeping on (only valid while in a futex wait queue) */
+		uint32_t *user_futexAddr;
+
+		/* scheduling (dynamicPriority is the run queue the thread is linked into) */
+		uint32_t priority;
+		uint32_t dynamicPriority;
+		uint64_t queuedTimestamp;
+
 		/* entry in the list of the associated process (not refcounted) */
 		struct process *process;
 		struct linkedList entry_process;
 		uint32_t exitcode;
 
+		/* cpu time (in TSC ticks) and statistics */
+		uint64_t userTime;
+		uint64_t kernelTime;
+		uint32_t contextSwitches;
+		uint32_t syscalls;
+
 		/* fpu was initialized for this thread */
 		bool fpuInitialized;
 
@@ -71,12 +103,24 @@
 	};
 
 	#define DEFAULT_STACK_SIZE	0x10000
+	#define MAX_STACK_SIZE		0x1000000
 	#define DEFAULT_TLB_SIZE	0x1000
 
-	struct thread *threadCreate(struct process *p, struct thread *original, void *eip);
+	/* temporary bonus for threads waking up from a wait operation */
+	#define THREAD_PRIORITY_WAKEUP_BONUS	2
+
+	/* runnable threads waiting longer than this (in ms) are moved to the next queue */
+	#define THREAD_AGING_TIMEOUT			100
+
+	struct thread *threadCreate(struct process *p, struct thread *original, void *eip, uint32_t stackSize);
 	struct thread *threadRun(struct thread *t);
 	void threadRelease(struct thread *t);
 
+	struct thread *threadIsValid(struct object *obj);
+	uint32_t threadSetPriority(struct thread *t, uint32_t priority);
+	uint64_t threadIdleTime();
+
+	void threadInit();
 	void threadSchedule();
 
 	uint32_t threadWait(struct thread *t, struct object *obj, uint32_t mode);
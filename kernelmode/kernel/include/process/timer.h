@@ -36,6 +36,13 @@ struct timerInfo
 	uint32_t interval;
 };
 
+/* same as timerInfo, but in nanoseconds */
+struct timerInfoNs
+{
+	uint64_t timeout;
+	uint64_t interval;
+};
+
 #ifdef __KERNEL__
 
 	struct timer;
@@ -51,16 +58,20 @@ struct timerInfo
 		struct linkedList waiters;
 		bool active;
 
+		/* in nanoseconds */
 		uint64_t timeout;
-		uint32_t interval;
+		uint64_t interval;
 
 		bool wakeupAll;
 	};
 
 	struct timer *timerCreate(bool wakeupAll);
 	uint64_t timerGetTimestamp();
+	uint64_t timerGetTimestampNs();
 
 	void timerInit();
+	void timerStartTimeslice(bool restart);
+	void timerStopTimeslice();
 
 #endif
 
@@ -114,6 +114,38 @@ enum
 	 */
 	 SYSCALL_EXECUTE_PROGRAM,
 
+	/**
+	 * Sleeps until another thread wakes up the futex, if it still contains the expected value.
+	 * - \b Parameters:
+	 *				- Pointer to the futex (32-bit value, has to be 4-byte aligned)
+	 *				- Expected value
+	 * - \b Returns:
+	 *				-  0: woken up by #SYSCALL_FUTEX_WAKE
+	 *				-  1: futex didn't contain the expected value
+	 *				- -1: error
+	 */
+	SYSCALL_FUTEX_WAIT,
+
+	/**
+	 * Wakes up threads sleeping on a futex.
+	 * - \b Parameters:
+	 *				- Pointer to the futex
+	 *				- Maximum number of threads to wake up
+	 * - \b Returns:
+	 *				- Number of threads which were woken up
+	 */
+	SYSCALL_FUTEX_WAKE,
+
+	/**
+	 * Changes the scheduling priority of a thread.
+	 * - \b Parameters:
+	 *				- Thread handle
+	 *				- New priority (between THREAD_PRIORITY_MIN and THREAD_PRIORITY_MAX)
+	 * - \b Returns:
+	 *				- Previous priority of the thread or -1 on error
+	 */
+	SYSCALL_SET_THREAD_PRIORITY,
+
 	/**
 	 * Get thread local storage address.
 	 * - \b Parameters:
@@ -189,6 +221,16 @@ enum
 	 */
 	SYSCALL_RELEASE_MEMORY,
 
+	/**
+	 * Returns the kernel heap usage of each subsystem
+	 * - \b Parameters:
+	 *				- Pointer to an array of heapTagInfo structures
+	 *				- Number of entries in the array
+	 * - \b Returns:
+	 *				- Number of heap tags (can also be greater than the number of entries in the array)
+	 */
+	SYSCALL_GET_HEAP_INFO,
+
 	/**
 	 * Fork process.
 	 * - \b Parameters:
@@ -535,52 +577,279 @@ enum
 	 */
 	SYSCALL_FILESYSTEM_OPEN,
 
+	/**
+	 * Create a new thread with additional options.
+	 * - \b Parameters:
+	 *				- Pointer to a threadCreateInfo structure containing the
+	 *				entry point, the initial register values and the size of
+	 *				the stack in bytes (0 for the default size)
+	 * - \b Returns:
+	 *				- Thread handle
+	 */
+	SYSCALL_CREATE_THREAD_EX						= 0x700,
+
+	/**
+	 * Returns the current kernel timestamp in nanoseconds
+	 * - \b Parameters:
+	 *				- Pointer to a 64-bit value which is filled out with the timestamp
+	 * - \b Returns:
+	 *				- True on success, otherwise false
+	 */
+	SYSCALL_GET_MONOTONIC_CLOCK_NS,
+
+	/**
+	 * Fetches the identifiers of attached objects which are ready, without blocking. Level-triggered
+	 * objects are armed again and reported as long as their wait operation completes immediately,
+	 * edge-triggered objects are not reported again while they stay ready, unless nothing else is ready.
+	 * - \b Parameters:
+	 *				- Handle to an event object
+	 *				- Buffer for an array of eventReady structures
+	 *				- Maximum number of entries
+	 * - \b Returns:
+	 *				- >=0: number of entries stored in the buffer
+	 *				-  <0: invalid handle or pointer
+	 */
+	SYSCALL_EVENT_GET_READY,
+
+	/**
+	 * Creates a new IO ring object and maps the shared ring memory into the process.
+	 * The mapping is not inherited by forked processes.
+	 * - \b Parameters:
+	 *				- Number of submission entries (rounded up to a power of two, at most #IORING_MAX_ENTRIES)
+	 *				- Pointer to a variable which receives the address of the ioRingHeader structure
+	 * - \b Returns:
+	 *				- IO ring handle
+	 */
+	SYSCALL_CREATE_IORING,
+
+	/**
+	 * Executes operations from the submission queue of an IO ring. Operations which would
+	 * block are deferred and complete later, wait on the IO ring to block until a completion
+	 * is available. Only the process which created the IO ring can submit operations.
+	 * - \b Parameters:
+	 *				- Handle to an IO ring object
+	 *				- Maximum number of submissions to consume
+	 * - \b Returns:
+	 *				- >=0: number of consumed submissions, less if the completion queue is full
+	 *				-  <0: invalid handle or submission queue
+	 */
+	SYSCALL_IORING_ENTER,
+
+	/**
+	 * Executes several syscalls in order within one kernel entry. The execution stops
+	 * after the first entry which returns (-1). Syscalls which block, yield or fork
+	 * (SYSCALL_YIELD, SYSCALL_EXIT_*, SYSCALL_FUTEX_WAIT, SYSCALL_FORK, SYSCALL_OBJECT_WAIT
+	 * and SYSCALL_BATCH itself) are rejected with (-1). A successful SYSCALL_EXECUTE_PROGRAM
+	 * ends the batch, the new program starts as usual.
+	 * - \b Parameters:
+	 *				- Pointer to an array of syscallBatchEntry structures
+	 *				- Number of entries
+	 * - \b Returns:
+	 *				- Number of entries for which the result was stored
+	 */
+	SYSCALL_BATCH,
+
+	/**
+	 * Writes the data described by an array of ioVector structures into a kernel object,
+	 * as if the segments were passed to SYSCALL_OBJECT_WRITE one after another.
+	 * - \b Parameters:
+	 *				- Handle to a kernel object
+	 *				- Array of ioVector structures
+	 *				- Number of entries (at most IO_VECTOR_MAX)
+	 * - \b Returns:
+	 *				- >=0: number of bytes written, stops at the first partially written segment
+	 *				-  <0: invalid handle or pointer
+	 */
+	SYSCALL_OBJECT_WRITEV,
+
+	/**
+	 * Reads data from a kernel object into the buffers described by an array of ioVector
+	 * structures, as if the segments were passed to SYSCALL_OBJECT_READ one after another.
+	 * - \b Parameters:
+	 *				- Handle to a kernel object
+	 *				- Array of ioVector structures
+	 *				- Number of entries (at most IO_VECTOR_MAX)
+	 * - \b Returns:
+	 *				- >=0: number of bytes read, stops at the first partially filled segment
+	 *				-  <0: invalid handle or pointer
+	 */
+	SYSCALL_OBJECT_READV,
+
+	/**
+	 * Writes the data described by an array of ioVector structures at a specific position
+	 * of an opened file, without using or modifying the file position. With IO_OFFSET_APPEND
+	 * all segments are appended at the end of the file, this is also accepted for other
+	 * objects like pipes, which behave like SYSCALL_OBJECT_WRITEV then.
+	 * - \b Parameters:
+	 *				- Handle to a kernel object
+	 *				- Array of ioVector structures
+	 *				- Number of entries (at most IO_VECTOR_MAX)
+	 *				- Offset in the file or IO_OFFSET_APPEND
+	 * - \b Returns:
+	 *				- >=0: number of bytes written
+	 *				-  <0: invalid handle, pointer or offset
+	 */
+	SYSCALL_OBJECT_PWRITEV,
+
+	/**
+	 * Reads data at a specific position of an opened file into the buffers described by an
+	 * array of ioVector structures, without using or modifying the file position.
+	 * - \b Parameters:
+	 *				- Handle to an opened file object
+	 *				- Array of ioVector structures
+	 *				- Number of entries (at most IO_VECTOR_MAX)
+	 *				- Offset in the file
+	 * - \b Returns:
+	 *				- >=0: number of bytes read
+	 *				-  <0: invalid handle or pointer, or offset behind the end of the file
+	 *				(with zero entries it only fails for objects which are not opened files)
+	 */
+	SYSCALL_OBJECT_PREADV,
+
+	/**
+	 * Moves data from a pipe or opened file into another object inside of the kernel, like
+	 * a read followed by a write, but without passing the data through usermode buffers.
+	 * Data of an opened file is taken from the current position, which is advanced.
+	 * - \b Parameters:
+	 *				- Handle to a pipe or opened file object (source)
+	 *				- Handle to a kernel object like a pipe, opened file or stdout (destination)
+	 *				- Maximum number of bytes
+	 * - \b Returns:
+	 *				- >=0: number of bytes moved, 0 means that the source is empty or the destination is full
+	 *				-  <0: invalid handle, end of file, or the pipe was closed
+	 */
+	SYSCALL_OBJECT_SPLICE,
+
+	/**
+	 * Duplicates data of a pipe into another pipe, without removing it from the source.
+	 * - \b Parameters:
+	 *				- Handle to a pipe object (source)
+	 *				- Handle to a pipe object (destination)
+	 *				- Maximum number of bytes
+	 * - \b Returns:
+	 *				- >=0: number of bytes duplicated, 0 means that the source is empty or the destination is full
+	 *				-  <0: invalid handle, or one of the pipes was closed
+	 */
+	SYSCALL_OBJECT_TEE,
+
+};
+
+/* entry for SYSCALL_BATCH, the arguments are passed in ebx, ecx, edx, esi and edi */
+struct syscallBatchEntry
+{
+	uint32_t syscall;
+	uint32_t args[5];
+	uint32_t result;
+};
+
+/* segment for the scatter-gather syscalls */
+struct ioVector
+{
+	void *base;
+	uint32_t length;
 };
 
+#define IO_VECTOR_MAX		1024
+
+/* offset for SYSCALL_OBJECT_PWRITEV to append at the end of the file */
+#define IO_OFFSET_APPEND	0xFFFFFFFF
+
 #ifndef __KERNEL__
 
+	#include <process/thread.h>
+	#include <process/process.h>
+	#include <process/event.h>
+	#include <process/ioring.h>
+
+	/* read-only data provided by the kernel, allows some queries without a syscall */
+	#define ibnos_shared ((const struct processSharedData *)USERMODE_SHARED_DATA_ADDRESS)
+
 	#define IBNOS_SYSCALL_FN(syscall, n0, n1, n2, n3, n4, n5, n6, n7, n8, n, ...) ibnos_syscall##n
 	#define ibnos_syscall(syscall, ...) IBNOS_SYSCALL_FN(syscall, ##__VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)(syscall, ##__VA_ARGS__)
 
+	/**
+	 * @brief Checks if syscalls can be done using the sysenter instruction
+	 * @details The kernel enables sysenter on all CPUs reporting the SEP
+	 *			feature flag, except for early Pentium Pro models.
+	 */
+	static inline bool ibnos_sysenter()
+	{
+		static int supported = -1;
+		if (supported < 0)
+		{
+			uint32_t eax, ebx, ecx, edx;
+			asm volatile ("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+			supported = (edx & (1 << 11)) && !(((eax >> 8) & 0xF) == 6 && (eax & 0xFF) < 0x33);
+		}
+		return supported;
+	}
+
+	/* The kernel returns to a stub in the vsyscall page, which restores
+	 * ebp and returns to the address pushed before. */
+	#define IBNOS_SYSENTER \
+		"pushl $1f\n" \
+		"pushl %%ebp\n" \
+		"movl %%esp, %%ebp\n" \
+		"sysenter\n" \
+		"1:\n"
+
 	static inline int ibnos_syscall0(int syscall)
 	{
 		int ret;
-		asm volatile ("int $0x80" :"=a"(ret) :"a"(syscall));
+		if (ibnos_sysenter())
+			asm volatile (IBNOS_SYSENTER :"=a"(ret) :"a"(syscall) : "ecx", "edx", "cc");
+		else
+			asm volatile ("int $0x80" :"=a"(ret) :"a"(syscall));
 		return ret;
 	}
 
 	static inline int ibnos_syscall1(int syscall, uint32_t value1)
 	{
 		int ret;
-		asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1));
+		if (ibnos_sysenter())
+			asm volatile (IBNOS_SYSENTER :"=a"(ret) : "a"(syscall), "b"(value1) : "ecx", "edx", "cc");
+		else
+			asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1));
 		return ret;
 	}
 
 	static inline int ibnos_syscall2(int syscall, uint32_t value1, uint32_t value2)
 	{
 		int ret;
-		asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2));
+		if (ibnos_sysenter())
+			asm volatile (IBNOS_SYSENTER :"=a"(ret), "+c" (value2) : "a"(syscall), "b"(value1) : "edx", "cc");
+		else
+			asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2));
 		return ret;
 	}
 
 	static inline int ibnos_syscall3(int syscall, uint32_t value1, uint32_t value2, uint32_t value3)
 	{
 		int ret;
-		asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2), "d" (value3));
+		if (ibnos_sysenter())
+			asm volatile (IBNOS_SYSENTER :"=a"(ret), "+c" (value2), "+d" (value3) : "a"(syscall), "b"(value1) : "cc");
+		else
+			asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2), "d" (value3));
 		return ret;
 	}
 
 	static inline int ibnos_syscall4(int syscall, uint32_t value1, uint32_t value2, uint32_t value3, uint32_t value4)
 	{
 		int ret;
-		asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2), "d" (value3), "S" (value4));
+		if (ibnos_sysenter())
+			asm volatile (IBNOS_SYSENTER :"=a"(ret), "+c" (value2), "+d" (value3) : "a"(syscall), "b"(value1), "S" (value4) : "cc");
+		else
+			asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2), "d" (value3), "S" (value4));
 		return ret;
 	}
 
 	static inline int ibnos_syscall5(int syscall, uint32_t value1, uint32_t value2, uint32_t value3, uint32_t value4, uint32_t value5)
 	{
 		int ret;
-		asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2), "d" (value3), "S" (value4), "D" (value5));
+		if (ibnos_sysenter())
+			asm volatile (IBNOS_SYSENTER :"=a"(ret), "+c" (value2), "+d" (value3) : "a"(syscall), "b"(value1), "S" (value4), "D" (value5) : "cc");
+		else
+			asm volatile ("int $0x80" :"=a"(ret) : "a"(syscall), "b"(value1), "c" (value2), "d" (value3), "S" (value4), "D" (value5));
 		return ret;
 	}
 
@@ -590,8 +859,12 @@ enum
 	}
 	/* exit is already provided by the libc */
 
+	/* provided by the libc, returns the memory cached by the current thread */
+	void __exit_ibnos_thread();
+
 	static inline void exitThread(int exitcode)
 	{
+		__exit_ibnos_thread();
 		ibnos_syscall(SYSCALL_EXIT_THREAD, exitcode);
 	}
 
@@ -605,10 +878,32 @@ enum
 		return (int32_t)ibnos_syscall(SYSCALL_GET_CURRENT_THREAD);
 	}
 
-	static inline uint32_t getMonotonicClock()
+	static inline uint32_t getCurrentProcessID()
+	{
+		return ibnos_shared->processID;
+	}
+
+	static inline uint32_t getCurrentThreadID()
+	{
+		return ibnos_shared->threadID;
+	}
+
+	/* same calculation as in the kernel, based on the TSC calibration in the shared data */
+	static inline uint64_t getMonotonicClockNs()
 	{
+		uint64_t ticks, frequency = ibnos_shared->tscFrequency;
+		uint32_t low, high;
+
+		asm volatile("rdtsc" : "=a"(low), "=d"(high));
+		ticks = ((((uint64_t)high) << 32) | low) - ibnos_shared->tscBase;
 
-		return ibnos_syscall(SYSCALL_GET_MONOTONIC_CLOCK);
+		return (ticks / frequency) * 1000000000ULL +
+			   (ticks % frequency) * 1000000000ULL / frequency;
+	}
+
+	static inline uint32_t getMonotonicClock()
+	{
+		return (uint32_t)(getMonotonicClockNs() / 1000000);
 	}
 
 	static inline uint32_t getProcessInfo(void *info, uint32_t count)
@@ -621,44 +916,87 @@ enum
 		return ibnos_syscall(SYSCALL_EXECUTE_PROGRAM, (uint32_t)handle, (uint32_t)arg, arglen, (uint32_t)env, envlen);
 	}
 
+	static inline int32_t futexWait(volatile uint32_t *addr, uint32_t expected)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_FUTEX_WAIT, (uint32_t)addr, expected);
+	}
+
+	static inline uint32_t futexWake(volatile uint32_t *addr, uint32_t count)
+	{
+		return ibnos_syscall(SYSCALL_FUTEX_WAKE, (uint32_t)addr, count);
+	}
+
+	static inline uint32_t syscallBatch(struct syscallBatchEntry *entries, uint32_t count)
+	{
+		return ibnos_syscall(SYSCALL_BATCH, (uint32_t)entries, count);
+	}
+
+	/* fills out a batch entry, unused arguments should be 0 */
+	static inline void syscallBatchSet(struct syscallBatchEntry *entry, uint32_t syscall, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+	{
+		entry->syscall	= syscall;
+		entry->args[0]	= arg0;
+		entry->args[1]	= arg1;
+		entry->args[2]	= arg2;
+		entry->args[3]	= 0;
+		entry->args[4]	= 0;
+		entry->result	= -1;
+	}
+
+	static inline int32_t setThreadPriority(int32_t handle, uint32_t priority)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_SET_THREAD_PRIORITY, (uint32_t)handle, priority);
+	}
+
 	static inline void *getTLS()
 	{
-		return (void *)ibnos_syscall(SYSCALL_GET_THREADLOCAL_STORAGE_BASE);
+		return ibnos_shared->threadLocalBase;
 	}
 
 	static inline uint32_t getTLSLength()
 	{
-		return ibnos_syscall(SYSCALL_GET_THREADLOCAL_STORAGE_LENGTH);
+		return ibnos_shared->threadLocalLength;
 	}
 
 	static inline void *getProgramArguments()
 	{
-		return (void *)ibnos_syscall(SYSCALL_GET_PROGRAM_ARGUMENTS_BASE);
+		return ibnos_shared->programArgumentsBase;
 	}
 
 	static inline uint32_t getProgramArgumentsLength()
 	{
-		return ibnos_syscall(SYSCALL_GET_PROGRAM_ARGUMENTS_LENGTH);
+		return ibnos_shared->programArgumentsLength;
 	}
 
 	static inline void *getEnvironmentVariables()
 	{
-		return (void *)ibnos_syscall(SYSCALL_GET_ENVIRONMENT_VARIABLES_BASE);
+		return ibnos_shared->environmentVariablesBase;
 	}
 
 	static inline uint32_t getEnvironmentVariablesLength()
 	{
-		return ibnos_syscall(SYSCALL_GET_ENVIRONMENT_VARIABLES_LENGTH);
+		return ibnos_shared->environmentVariablesLength;
 	}
 
 	/* malloc, free and fork are also provided by the libc */
 
+	static inline uint32_t getHeapInfo(void *info, uint32_t count)
+	{
+		return ibnos_syscall(SYSCALL_GET_HEAP_INFO, (uint32_t)info, count);
+	}
+
 	extern void *_thread_start;
 	static inline int32_t createThread(void *func, uint32_t arg0, uint32_t arg1, uint32_t arg2)
 	{
 		return (int32_t)ibnos_syscall(SYSCALL_CREATE_THREAD, (uint32_t)&_thread_start, (uint32_t)func, arg0, arg1, arg2);
 	}
 
+	static inline int32_t createThreadWithStack(void *func, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t stackSize)
+	{
+		struct threadCreateInfo info = {&_thread_start, (uint32_t)func, arg0, arg1, arg2, stackSize};
+		return (int32_t)ibnos_syscall(SYSCALL_CREATE_THREAD_EX, (uint32_t)&info);
+	}
+
 	static inline int32_t createEvent(bool wakeupAll)
 	{
 		return (int32_t)ibnos_syscall(SYSCALL_CREATE_EVENT, (uint32_t)wakeupAll);
@@ -679,6 +1017,11 @@ enum
 		return (int32_t)ibnos_syscall(SYSCALL_CREATE_TIMER, (uint32_t)wakeupAll);
 	}
 
+	static inline int32_t createIORing(uint32_t entries, struct ioRingHeader **ring)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_CREATE_IORING, entries, (uint32_t)ring);
+	}
+
 	/* dup, dup2 are provided by libc */
 
 	static inline bool objectExists(int32_t handle)
@@ -726,6 +1069,48 @@ enum
 		return (int32_t)ibnos_syscall(SYSCALL_OBJECT_READ, (uint32_t)handle, (uint32_t)buffer, length);
 	}
 
+	static inline int32_t objectWriteV(int32_t handle, struct ioVector *vec, uint32_t count)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_OBJECT_WRITEV, (uint32_t)handle, (uint32_t)vec, count);
+	}
+
+	static inline int32_t objectReadV(int32_t handle, struct ioVector *vec, uint32_t count)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_OBJECT_READV, (uint32_t)handle, (uint32_t)vec, count);
+	}
+
+	static inline int32_t objectPWriteV(int32_t handle, struct ioVector *vec, uint32_t count, uint32_t offset)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_OBJECT_PWRITEV, (uint32_t)handle, (uint32_t)vec, count, offset);
+	}
+
+	static inline int32_t objectPReadV(int32_t handle, struct ioVector *vec, uint32_t count, uint32_t offset)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_OBJECT_PREADV, (uint32_t)handle, (uint32_t)vec, count, offset);
+	}
+
+	static inline int32_t objectPWrite(int32_t handle, void *buffer, uint32_t length, uint32_t offset)
+	{
+		struct ioVector vec = {buffer, length};
+		return objectPWriteV(handle, &vec, 1, offset);
+	}
+
+	static inline int32_t objectPRead(int32_t handle, void *buffer, uint32_t length, uint32_t offset)
+	{
+		struct ioVector vec = {buffer, length};
+		return objectPReadV(handle, &vec, 1, offset);
+	}
+
+	static inline int32_t objectSplice(int32_t src, int32_t dst, uint32_t length)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_OBJECT_SPLICE, (uint32_t)src, (uint32_t)dst, length);
+	}
+
+	static inline int32_t objectTee(int32_t src, int32_t dst, uint32_t length)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_OBJECT_TEE, (uint32_t)src, (uint32_t)dst, length);
+	}
+
 	static inline bool objectAttach(int32_t handle, int32_t childHandle, uint32_t mode, uint32_t ident)
 	{
 		return ibnos_syscall(SYSCALL_OBJECT_ATTACH_OBJ, (uint32_t)handle, (uint32_t)childHandle, mode, ident);
@@ -736,6 +1121,63 @@ enum
 		return ibnos_syscall(SYSCALL_OBJECT_DETACH_OBJ, (uint32_t)handle, ident);
 	}
 
+	static inline int32_t eventGetReady(int32_t handle, struct eventReady *ready, uint32_t count)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_EVENT_GET_READY, (uint32_t)handle, (uint32_t)ready, count);
+	}
+
+	/* blocks until at least one attached object is ready, returns the number of entries */
+	static inline int32_t eventWaitReady(int32_t handle, struct eventReady *ready, uint32_t count)
+	{
+		int32_t res;
+		while ((res = eventGetReady(handle, ready, count)) == 0)
+		{
+			if (objectWait(handle, EVENT_WAIT_READY) < 0) break;
+		}
+		return res;
+	}
+
+	static inline int32_t ioRingEnter(int32_t handle, uint32_t count)
+	{
+		return (int32_t)ibnos_syscall(SYSCALL_IORING_ENTER, (uint32_t)handle, count);
+	}
+
+	/* appends an entry to the submission queue, returns false if it is full */
+	static inline bool ioRingPrepare(struct ioRingHeader *ring, uint32_t opcode, int32_t handle, void *buffer, uint32_t length, uint32_t mode, uint32_t userData)
+	{
+		struct ioRingSubmission *sqe;
+		if (ring->sqTail - ring->sqHead >= ring->sqEntries) return false;
+
+		sqe = (struct ioRingSubmission *)((uint8_t *)ring + ring->sqOffset) + (ring->sqTail & (ring->sqEntries - 1));
+		sqe->opcode		= opcode;
+		sqe->handle		= handle;
+		sqe->buffer		= buffer;
+		sqe->length		= length;
+		sqe->mode		= mode;
+		sqe->userData	= userData;
+		ring->sqTail++;
+		return true;
+	}
+
+	/* removes an entry from the completion queue, returns false if it is empty */
+	static inline bool ioRingGetCompletion(struct ioRingHeader *ring, struct ioRingCompletion *cqe)
+	{
+		if (ring->cqHead == ring->cqTail) return false;
+		*cqe = ((struct ioRingCompletion *)((uint8_t *)ring + ring->cqOffset))[ring->cqHead & (ring->cqEntries - 1)];
+		ring->cqHead++;
+		return true;
+	}
+
+	/* blocks until an entry is available in the completion queue */
+	static inline bool ioRingWaitCompletion(int32_t handle, struct ioRingHeader *ring, struct ioRingCompletion *cqe)
+	{
+		while (!ioRingGetCompletion(ring, cqe))
+		{
+			if (objectWait(handle, 0) < 0) return false;
+		}
+		return true;
+	}
+
 	static inline int32_t consoleWrite(const char *buffer, uint32_t length)
 	{
 		return (int32_t)ibnos_syscall(SYSCALL_CONSOLE_WRITE, (uint32_t)buffer, length);
@@ -50,6 +50,13 @@
 	void debugAssertFailed(const char *assertion, const char *file, const char *function, const char *line, struct taskContext *context);
 	void debugNotImplemented(const char *file, const char *function, const char *line, struct taskContext *context);
 
+	static inline uint64_t rdtsc()
+	{
+		uint64_t value;
+		asm volatile("rdtsc" : "=A" (value));
+		return value;
+	}
+
 	inline void debugHalt()
 	{
 		for (;;) asm volatile("cli\nhlt");
@@ -27,7 +27,10 @@
 
 #include <interrupt/interrupt.h>
 #include <hardware/gdt.h>
+#include <hardware/fpu.h>
+#include <hardware/smp.h>
 #include <memory/physmem.h>
+#include <memory/allocator.h>
 
 #include <process/object.h>
 #include <process/process.h>
@@ -35,7 +38,9 @@
 #include <process/semaphore.h>
 #include <process/pipe.h>
 #include <process/event.h>
+#include <process/ioring.h>
 #include <process/timer.h>
+#include <process/futex.h>
 #include <process/filesystem.h>
 
 #include <loader/elf.h>
@@ -108,10 +113,11 @@ uint32_t dispatchInterrupt(uint32_t interrupt, uint32_t error, struct thread *t)
 
 /**
  * @brief Coprocessor / FPU not available handler
- * @details We use hardware task switches which do not automatically
- *			save the values of the FPU. The CPU automatically protects
- *			the FPU and raises an exception if the FPU is used for the
- *			first time after a task switch. This handler saves the content of
+ * @details Threads are switched in software and the values of the FPU
+ *			are not saved automatically. Instead the TS bit is set before
+ *			a thread which doesn't own the FPU is entered, so that the CPU
+ *			raises an exception if the FPU is used for the first time after
+ *			a thread switch. This handler saves the content of
  *			the FPU to the last task which used the FPU so that the
  *			current task can safely alter the content.
  *
@@ -122,30 +128,29 @@ uint32_t dispatchInterrupt(uint32_t interrupt, uint32_t error, struct thread *t)
  */
 uint32_t interrupt_0x07(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct thread *t)
 {
+	struct cpu *cpu = smpGetCPU();
+
 	/* we currently do not handle kernel errors */
 	if (!t) return INTERRUPT_UNHANDLED;
-	if (t != lastFPUthread)
+	if (t != cpu->lastFPUthread)
 	{
 		asm volatile("clts");
 
 		/* backup context of last fpu thread */
-		if (lastFPUthread)
-			asm volatile("fnsave %0; fwait" : "=m" (lastFPUthread->fpu));
+		if (cpu->lastFPUthread)
+			fpuSave(&cpu->lastFPUthread->fpu);
 
 		/* fpu was never initialized */
 		if (t->fpuInitialized)
-		{
-			t->fpu.statusWord &= t->fpu.controlWord | 0xff80;
-			asm volatile("frstor %0" : : "m" (t->fpu) );
-		}
+			fpuRestore(&t->fpu);
 		else
 		{
-			asm volatile("fninit");
+			fpuReset();
 			t->fpuInitialized = true;
 		}
 
 		/* Remember that we restored the FPU the last time */
-		lastFPUthread = t;
+		cpu->lastFPUthread = t;
 	}
 	return INTERRUPT_CONTINUE_EXECUTION;
 }
@@ -154,27 +159,27 @@ uint32_t interrupt_0x10(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 {
 	/* we currently do not handle kernel errors */
 	if (!t) return INTERRUPT_UNHANDLED;
-	assert(t == lastFPUthread);
+	assert(t == smpGetCPU()->lastFPUthread);
 
 	asm volatile("clts");
-	asm volatile("fnsave %0; fwait" : "=m" (lastFPUthread->fpu));
+	fpuSave(&t->fpu);
 
 	/*
-	if (lastFPUthread->fpu.statusWord & 1)
+	if (t->fpu.statusWord & 1)
 		consoleWriteString("FPU invalid operation\n");
-	if (lastFPUthread->fpu.statusWord & 2)
+	if (t->fpu.statusWord & 2)
 		consoleWriteString("FPU denormalized operand\n");
-	if (lastFPUthread->fpu.statusWord & 4)
+	if (t->fpu.statusWord & 4)
 		consoleWriteString("FPU zero division\n");
-	if (lastFPUthread->fpu.statusWord & 8)
+	if (t->fpu.statusWord & 8)
 		consoleWriteString("FPU overflow\n");
-	if (lastFPUthread->fpu.statusWord & 16)
+	if (t->fpu.statusWord & 16)
 		consoleWriteString("FPU underflow\n");
-	if (lastFPUthread->fpu.statusWord & 32)
+	if (t->fpu.statusWord & 32)
 		consoleWriteString("FPU precision\n");
-	if (lastFPUthread->fpu.statusWord & 64)
+	if (t->fpu.statusWord & 64)
 		consoleWriteString("FPU stack fault\n");
-	if (lastFPUthread->fpu.statusWord & 128)
+	if (t->fpu.statusWord & 128)
 		consoleWriteString("FPU interrupt handler\n");
 	*/
 
@@ -182,24 +187,134 @@ uint32_t interrupt_0x10(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 }
 
 /**
- * @brief Interrupt which handles Syscalls
- * @details This function is called when a user mode program calls the
- *			interrupt 0x80. This interrupt is used to handle Syscalls
- *			and gives the user mode program the possibility to execute
- *			predefined functions in the kernel.
+ * @brief SIMD floating point exception handler
+ * @details Raised when a SSE instruction causes an unmasked floating point
+ *			exception. The state is saved, and the process is terminated
+ *			like for regular FPU exceptions.
  *
- * @param interrupt Always 0x80
+ * @param interrupt Always 0x13
  * @param error Does not apply to this interrupt
+ * @param t The thread which caused the exception
+ * @return Always #INTERRUPT_UNHANDLED
+ */
+uint32_t interrupt_0x13(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct thread *t)
+{
+	/* we currently do not handle kernel errors */
+	if (!t) return INTERRUPT_UNHANDLED;
+	assert(t == smpGetCPU()->lastFPUthread);
+
+	asm volatile("clts");
+	fpuSave(&t->fpu);
+
+	return INTERRUPT_UNHANDLED;
+}
+
+/**
+ * @brief Transfers data between a kernel object and a user buffer
+ * @details Whole pages are moved by reference between pipes and page aligned
+ *			buffers, the remaining data is copied through a kernel mapping of the
+ *			buffer using the regular read and write functions of the object.
+ *
+ * @param p Process which owns the buffer
+ * @param obj Kernel object
+ * @param addr Address of the buffer in the process
+ * @param length Length of the buffer in bytes
+ * @param write True to write into the object, false to read from it
+ * @return Number of bytes transferred, or the result of the read or write function
+ */
+static int32_t __syscallObjectTransfer(struct process *p, struct object *obj, void *addr, uint32_t length, bool write)
+{
+	struct pipe *pipe = pipeIsValid(obj);
+	struct userMemory k;
+	int32_t moved = 0, res;
+
+	if (pipe && !((uint32_t)addr & PAGE_MASK) && length >= PAGE_SIZE)
+	{
+		moved = write ? pipeWritePages(pipe, p, addr, length) : pipeReadPages(pipe, p, addr, length);
+		if (moved < 0 || (uint32_t)moved == length) return moved;
+		addr	= (uint8_t *)addr + moved;
+		length	-= moved;
+	}
+
+	if (!ACCESS_USER_MEMORY(&k, p, addr, length, !write))
+		return moved ? moved : -1;
+
+	res = write ? __objectWrite(obj, k.addr, length) : __objectRead(obj, k.addr, length);
+	RELEASE_USER_MEMORY(&k);
+
+	if (!moved) return res;
+	return (res > 0) ? (moved + res) : moved;
+}
+
+/**
+ * @brief Transfers data between a kernel object and several user buffers
+ * @details The segments are processed in order, until an error occurs or a segment
+ *			can't be transferred completely. If an openedFile object is passed, then
+ *			the data is transferred at the given offset in the file, otherwise the
+ *			regular read and write functions of the object are used.
+ *
+ * @param p Process which owns the buffers
+ * @param obj Kernel object
+ * @param h Kernel openedFile object for positional access, or NULL
+ * @param vec Array of ioVector structures mapped into the kernel
+ * @param count Number of entries
+ * @param offset Position in the file, only used if h is not NULL
+ * @param write True to write into the object, false to read from it
+ * @return Number of bytes transferred, or the error of the first segment
+ */
+static int32_t __syscallObjectVector(struct process *p, struct object *obj, struct openedFile *h, struct ioVector *vec, uint32_t count, uint32_t offset, bool write)
+{
+	struct userMemory k;
+	uint32_t total = 0, i;
+	int32_t res = 0;
+
+	/* the total length has to fit into the return value */
+	for (i = 0; i < count; i++)
+	{
+		if (vec[i].length > 0x7FFFFFFF - total) return -1;
+		total += vec[i].length;
+	}
+
+	/* all segments of an append go to the same position */
+	if (h && write && offset == IO_OFFSET_APPEND)
+		offset = h->file->size;
+
+	total = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (!vec[i].length) continue;
+
+		if (!h)
+			res = __syscallObjectTransfer(p, obj, vec[i].base, vec[i].length, write);
+		else if (ACCESS_USER_MEMORY(&k, p, vec[i].base, vec[i].length, !write))
+		{
+			res = write ? openedFileWriteAt(h, k.addr, vec[i].length, offset + total) : openedFileReadAt(h, k.addr, vec[i].length, offset + total);
+			RELEASE_USER_MEMORY(&k);
+		}
+		else
+			res = -1;
+
+		if (res < 0) break;
+		total += res;
+		if ((uint32_t)res < vec[i].length) break;
+	}
+
+	return (total || res >= 0) ? (int32_t)total : res;
+}
+
+static uint32_t __syscallBatch(struct thread *t, struct syscallBatchEntry *entries, uint32_t count);
+
+/**
+ * @brief Executes a single syscall
+ * @details The syscall number is passed in the eax register of the thread, the
+ *			arguments in ebx, ecx, edx, esi and edi. The result is stored in eax.
+ *
  * @param t The thread which called the syscall
  * @return	How to continue, depends on the called function and must be one of
  *			the \ref InterruptReturnValue "Interrupt return values"
- *
  */
-uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct thread *t)
+static uint32_t __syscallDispatch(struct thread *t)
 {
-	/* we don't expect any syscalls while running in the kernel */
-	if (!t) return INTERRUPT_UNHANDLED;
-
 	uint32_t status = INTERRUPT_CONTINUE_EXECUTION;
 	uint32_t syscall = t->task.eax;
 	struct userMemory k;
@@ -265,11 +380,13 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 
 					/* realloc paging table */
 					pagingAllocProcessPageTable(p);
-					pagingMapRemoteMemory(p, NULL, (void *)USERMODE_KERNELSTACK_ADDRESS, kernelStack, 1, true, false);							/* kernelstack */
+					pagingMapRemoteMemory(p, NULL, kernelStack, kernelStack, kernelStackCount, true, false);									/* kernelstack */
 					pagingMapRemoteMemory(p, NULL, (void *)USERMODE_GDT_ADDRESS, (void *)USERMODE_GDT_ADDRESS, GDT_MAX_PAGES, false, false);	/* gdt */
 					pagingMapRemoteMemory(p, NULL, (void *)USERMODE_IDT_ADDRESS, (void *)USERMODE_IDT_ADDRESS, 1, false, false);				/* idt */
 					pagingMapRemoteMemory(p, NULL, (void *)USERMODE_INTJMP_ADDRESS, intJmpTable_user, 1, false, false);							/* intjmp */
 					pagingMapRemoteMemory(p, NULL, (void *)USERMODE_TASK_ADDRESS, (void *)USERMODE_TASK_ADDRESS, 1, false, false);				/* task */
+					pagingMapRemoteMemory(p, NULL, (void *)USERMODE_VSYSCALL_ADDRESS, vsyscallPage, 1, false, true);							/* vsyscall */
+					processMapSharedData(p);
 
 					/* load target process */
 					if (!elfLoadBinary(p, f->buffer, f->size))
@@ -318,15 +435,24 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 						p->user_environmentVariablesBase	= NULL;
 					}
 
+					processUpdateSharedData(p);
+
 					/* free paging table of old process */
 					pagingReleaseProcessPageTable(&old_p);
 
+					/* IO rings were mapped into the old address space */
+					ioRingDetachProcess(p);
+
 					/* shutdown all other threads */
 					LL_FOR_EACH_SAFE(old_t, __old_t, &p->threads, struct thread, entry_process)
 					{
 						if (t != old_t) objectShutdown(old_t, -3);
 					}
 
+					/* cached memory blocks were part of the old address space */
+					p->stackCache.count			= 0;
+					p->threadLocalCache.count	= 0;
+
 					/* reinitialize the thread t */
 					t->fpuInitialized = false;
 
@@ -372,6 +498,39 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 			}
 			break;
 
+		case SYSCALL_FUTEX_WAIT:
+			status = futexWait(t, (uint32_t *)t->task.ebx, t->task.ecx);
+			break;
+
+		case SYSCALL_FUTEX_WAKE:
+			t->task.eax = futexWake(p, (uint32_t *)t->task.ebx, t->task.ecx);
+			break;
+
+		case SYSCALL_SET_THREAD_PRIORITY:
+			{
+				struct thread *new_t = threadIsValid(handleGet(&p->handles, t->task.ebx));
+				if (!new_t || t->task.ecx > THREAD_PRIORITY_MAX) break;
+				t->task.eax = threadSetPriority(new_t, t->task.ecx);
+			}
+			break;
+
+		case SYSCALL_GET_MONOTONIC_CLOCK_NS:
+			if (ACCESS_USER_MEMORY(&k, p, (void *)t->task.ebx, sizeof(uint64_t), true))
+			{
+				*(uint64_t *)k.addr = timerGetTimestampNs();
+				RELEASE_USER_MEMORY(&k);
+				t->task.eax = true;
+			}
+			break;
+
+		case SYSCALL_BATCH:
+			if (ACCESS_USER_MEMORY_STRUCT(&k, p, (void *)t->task.ebx, t->task.ecx, sizeof(struct syscallBatchEntry), true))
+			{
+				status = __syscallBatch(t, k.addr, t->task.ecx);
+				RELEASE_USER_MEMORY(&k);
+			}
+			break;
+
 		case SYSCALL_GET_THREADLOCAL_STORAGE_BASE:
 			t->task.eax = (uint32_t)t->user_threadLocalBase;
 			break;
@@ -404,12 +563,20 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 			t->task.eax = (uint32_t)pagingTryReleaseUserMem(p, (void *)t->task.ebx, t->task.ecx);
 			break;
 
+		case SYSCALL_GET_HEAP_INFO:
+			if (ACCESS_USER_MEMORY_STRUCT(&k, p, (void *)t->task.ebx, t->task.ecx, sizeof(struct heapTagInfo), true))
+			{
+				t->task.eax = heapInfo((struct heapTagInfo *)k.addr, t->task.ecx);
+				RELEASE_USER_MEMORY(&k);
+			}
+			break;
+
 		case SYSCALL_FORK:
 			{
 				struct process *new_p = processCreate(p);
 				if (new_p)
 				{
-					struct thread *new_t = threadCreate(new_p, t, NULL);
+					struct thread *new_t = threadCreate(new_p, t, NULL, 0);
 					if (new_t)
 					{
 						t->task.eax		= handleAllocate(&p->handles, &new_p->obj);
@@ -423,7 +590,7 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 
 		case SYSCALL_CREATE_THREAD:
 			{
-				struct thread *new_t = threadCreate(p, NULL, (void *)t->task.ebx);
+				struct thread *new_t = threadCreate(p, NULL, (void *)t->task.ebx, 0);
 				if (new_t)
 				{
 					t->task.eax	= handleAllocate(&p->handles, &new_t->obj);
@@ -436,6 +603,24 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 			}
 			break;
 
+		case SYSCALL_CREATE_THREAD_EX:
+			if (ACCESS_USER_MEMORY(&k, p, (void *)t->task.ebx, sizeof(struct threadCreateInfo), false))
+			{
+				struct threadCreateInfo *info = (struct threadCreateInfo *)k.addr;
+				struct thread *new_t = threadCreate(p, NULL, info->entryPoint, info->stackSize);
+				if (new_t)
+				{
+					t->task.eax	= handleAllocate(&p->handles, &new_t->obj);
+					new_t->task.eax = info->eax;
+					new_t->task.ebx = info->ebx;
+					new_t->task.ecx = info->ecx;
+					new_t->task.edx = info->edx;
+					objectRelease(new_t);
+				}
+				RELEASE_USER_MEMORY(&k);
+			}
+			break;
+
 		case SYSCALL_CREATE_EVENT:
 			{
 				struct event *new_e = eventCreate(t->task.ebx);
@@ -480,6 +665,20 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 			}
 			break;
 
+		case SYSCALL_CREATE_IORING:
+			if (ACCESS_USER_MEMORY(&k, p, (void *)t->task.ecx, sizeof(struct ioRingHeader *), true))
+			{
+				struct ioRing *new_r = ioRingCreate(p, t->task.ebx);
+				if (new_r)
+				{
+					*(struct ioRingHeader **)k.addr = new_r->user_base;
+					t->task.eax = handleAllocate(&p->handles, &new_r->obj);
+					objectRelease(new_r);
+				}
+				RELEASE_USER_MEMORY(&k);
+			}
+			break;
+
 		case SYSCALL_OBJECT_DUP:
 			{
 				struct object *obj = handleGet(&p->handles, t->task.ebx);
@@ -549,11 +748,7 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 			{
 				struct object *obj = handleGet(&p->handles, t->task.ebx);
 				if (!obj) break;
-				if (ACCESS_USER_MEMORY(&k, p, (void *)t->task.ecx, t->task.edx, false))
-				{
-					t->task.eax = __objectWrite(obj, k.addr, t->task.edx);
-					RELEASE_USER_MEMORY(&k);
-				}
+				t->task.eax = __syscallObjectTransfer(p, obj, (void *)t->task.ecx, t->task.edx, true);
 			}
 			break;
 
@@ -561,11 +756,7 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 			{
 				struct object *obj = handleGet(&p->handles, t->task.ebx);
 				if (!obj) break;
-				if (ACCESS_USER_MEMORY(&k, p, (void *)t->task.ecx, t->task.edx, true))
-				{
-					t->task.eax = __objectRead(obj, k.addr, t->task.edx);
-					RELEASE_USER_MEMORY(&k);
-				}
+				t->task.eax = __syscallObjectTransfer(p, obj, (void *)t->task.ecx, t->task.edx, false);
 			}
 			break;
 
@@ -585,6 +776,74 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 			}
 			break;
 
+		case SYSCALL_EVENT_GET_READY:
+			{
+				struct event *e = eventIsValid(handleGet(&p->handles, t->task.ebx));
+				if (!e) break;
+				if (ACCESS_USER_MEMORY_STRUCT(&k, p, (void *)t->task.ecx, t->task.edx, sizeof(struct eventReady), true))
+				{
+					t->task.eax = eventGetReady(e, k.addr, t->task.edx);
+					RELEASE_USER_MEMORY(&k);
+				}
+			}
+			break;
+
+		case SYSCALL_IORING_ENTER:
+			{
+				struct ioRing *r = ioRingIsValid(handleGet(&p->handles, t->task.ebx));
+				if (!r || r->process != p) break;
+				t->task.eax = ioRingEnter(r, t->task.ecx);
+			}
+			break;
+
+		case SYSCALL_OBJECT_WRITEV:
+		case SYSCALL_OBJECT_READV:
+		case SYSCALL_OBJECT_PWRITEV:
+		case SYSCALL_OBJECT_PREADV:
+			{
+				struct object *obj = handleGet(&p->handles, t->task.ebx);
+				struct openedFile *h = NULL;
+				bool write = (syscall == SYSCALL_OBJECT_WRITEV || syscall == SYSCALL_OBJECT_PWRITEV);
+				if (!obj || t->task.edx > IO_VECTOR_MAX) break;
+
+				if (syscall == SYSCALL_OBJECT_PWRITEV || syscall == SYSCALL_OBJECT_PREADV)
+				{
+					/* streams like pipes have no position, but every write appends */
+					h = fileSystemIsValidOpenedFile(obj);
+					if (!h && !(syscall == SYSCALL_OBJECT_PWRITEV && t->task.esi == IO_OFFSET_APPEND)) break;
+				}
+
+				if (ACCESS_USER_MEMORY_STRUCT(&k, p, (void *)t->task.ecx, t->task.edx, sizeof(struct ioVector), false))
+				{
+					t->task.eax = __syscallObjectVector(p, obj, h, k.addr, t->task.edx, t->task.esi, write);
+					RELEASE_USER_MEMORY(&k);
+				}
+			}
+			break;
+
+		case SYSCALL_OBJECT_SPLICE:
+			{
+				struct object *src = handleGet(&p->handles, t->task.ebx);
+				struct object *dst = handleGet(&p->handles, t->task.ecx);
+				struct pipe *pipe = pipeIsValid(src);
+				struct openedFile *h = fileSystemIsValidOpenedFile(src);
+				if (!dst) break;
+				if (pipe)
+					t->task.eax = pipeSplice(pipe, dst, t->task.edx);
+				else if (h)
+					t->task.eax = openedFileSplice(h, dst, t->task.edx);
+			}
+			break;
+
+		case SYSCALL_OBJECT_TEE:
+			{
+				struct pipe *src = pipeIsValid(handleGet(&p->handles, t->task.ebx));
+				struct pipe *dst = pipeIsValid(handleGet(&p->handles, t->task.ecx));
+				if (!src || !dst) break;
+				t->task.eax = pipeTee(src, dst, t->task.edx);
+			}
+			break;
+
 		case SYSCALL_CONSOLE_WRITE:
 			if (ACCESS_USER_MEMORY(&k, p, (void *)t->task.ebx, t->task.ecx, true))
 			{
@@ -715,6 +974,105 @@ uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct
 	return status;
 }
 
+/**
+ * @brief Executes several syscalls within one kernel entry
+ * @details The entries are executed in order, until an entry returns (-1). Syscalls
+ *			which block or switch to a different context can't be part of a batch,
+ *			since the batch couldn't continue afterwards. If the process is replaced
+ *			by SYSCALL_EXECUTE_PROGRAM no further entries are executed. The registers
+ *			of the thread are restored after each entry, and eax is set to the number
+ *			of executed entries.
+ *
+ * @param t The thread which called the syscall
+ * @param entries Array of entries mapped into the kernel
+ * @param count Number of entries
+ * @return	How to continue, must be one of the \ref InterruptReturnValue "Interrupt return values"
+ */
+static uint32_t __syscallBatch(struct thread *t, struct syscallBatchEntry *entries, uint32_t count)
+{
+	uint32_t ebx = t->task.ebx, ecx = t->task.ecx, edx = t->task.edx, esi = t->task.esi, edi = t->task.edi;
+	uint32_t status = INTERRUPT_CONTINUE_EXECUTION;
+	struct syscallBatchEntry *e;
+	uint32_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		e = &entries[i];
+
+		switch (e->syscall)
+		{
+			case SYSCALL_YIELD:
+			case SYSCALL_EXIT_PROCESS:
+			case SYSCALL_EXIT_THREAD:
+			case SYSCALL_FUTEX_WAIT:
+			case SYSCALL_FORK:
+			case SYSCALL_OBJECT_WAIT:
+			case SYSCALL_BATCH:
+				e->result = -1;
+				i++;
+				goto out;
+
+			default:
+				break;
+		}
+
+		t->task.eax = e->syscall;
+		t->task.ebx = e->args[0];
+		t->task.ecx = e->args[1];
+		t->task.edx = e->args[2];
+		t->task.esi = e->args[3];
+		t->task.edi = e->args[4];
+
+		status = __syscallDispatch(t);
+		if (status != INTERRUPT_CONTINUE_EXECUTION)
+			return status;
+
+		e->result = t->task.eax;
+
+		/* the registers now belong to the new program */
+		if (e->syscall == SYSCALL_EXECUTE_PROGRAM && e->result != (uint32_t)-1)
+			return status;
+
+		if (e->result == (uint32_t)-1)
+		{
+			i++;
+			break;
+		}
+	}
+
+out:
+	t->task.eax = i;
+	t->task.ebx = ebx;
+	t->task.ecx = ecx;
+	t->task.edx = edx;
+	t->task.esi = esi;
+	t->task.edi = edi;
+	return status;
+}
+
+/**
+ * @brief Interrupt which handles Syscalls
+ * @details This function is called when a user mode program calls the
+ *			interrupt 0x80. This interrupt is used to handle Syscalls
+ *			and gives the user mode program the possibility to execute
+ *			predefined functions in the kernel.
+ *
+ * @param interrupt Always 0x80
+ * @param error Does not apply to this interrupt
+ * @param t The thread which called the syscall
+ * @return	How to continue, depends on the called function and must be one of
+ *			the \ref InterruptReturnValue "Interrupt return values"
+ *
+ */
+uint32_t interrupt_0x80(UNUSED uint32_t interrupt, UNUSED uint32_t error, struct thread *t)
+{
+	/* we don't expect any syscalls while running in the kernel */
+	if (!t) return INTERRUPT_UNHANDLED;
+
+	t->syscalls++;
+	return __syscallDispatch(t);
+}
+
 /**
  * @brief Request an interrupt
  *
@@ -766,7 +1124,7 @@ static interrupt_callback interruptTable[IDT_MAX_COUNT] =
 	/* 0x10 */ interrupt_0x10,
 	/* 0x11 */ NULL,
 	/* 0x12 */ NULL,
-	/* 0x13 */ NULL,
+	/* 0x13 */ interrupt_0x13,
 	/* 0x14 */ NULL,
 	/* 0x15 */ NULL,
 	/* 0x16 */ NULL,
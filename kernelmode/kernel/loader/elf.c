@@ -75,7 +75,7 @@ void __insertRequiredPage(struct linkedList *pages, uint32_t startIndex, uint32_
 	}
 
 	/* insert entry */
-	temp_it = heapAlloc(sizeof(*temp_it));
+	temp_it = heapAlloc(sizeof(*temp_it), HEAP_TAG_LOADER);
 	assert(temp_it);
 
 	temp_it->startIndex = startIndex;
@@ -36,11 +36,17 @@
 #include <hardware/pic.h>
 #include <hardware/keyboard.h>
 #include <hardware/pit.h>
+#include <hardware/fpu.h>
+#include <hardware/tsc.h>
+#include <hardware/acpi.h>
+#include <hardware/apic.h>
+#include <hardware/smp.h>
 
 #include <process/object.h>
 #include <process/process.h>
 #include <process/thread.h>
 #include <process/pipe.h>
+#include <process/futex.h>
 #include <process/timer.h>
 #include <process/filesystem.h>
 #include <process/handle.h>
@@ -51,34 +57,6 @@
 #include <util/list.h>
 #include <util/util.h>
 
-uint32_t __getCR0();
-asm(".text\n.align 4\n"
-"__getCR0:\n"
-"	movl %cr0, %eax\n"
-"	ret\n"
-);
-
-uint32_t __setCR0(uint32_t value);
-asm(".text\n.align 4\n"
-"__setCR0:\n"
-"	movl 4(%esp), %eax\n"
-"	movl %eax, %cr0\n"
-"	ret\n"
-);
-
-/**
- * @brief Initializes the FPU related bits in the CR0 register
- */
-void fpuInit()
-{
-	uint32_t cr0 = __getCR0();
-	cr0 &= ~(1 << 2); /* disable EMuleration */
-	cr0 |=  (1 << 5); /* enable Native Exception */
-	cr0 |=  (1 << 3); /* enable TS bit (kernel shouldn't use FPU) */
-	cr0 |=  (1 << 1); /* enable MP */
-	__setCR0(cr0);
-}
-
 /**
  * @brief Spawns a new process, and afterwards loads the ELF module into it
  * @details The provided memory address and length should represent an ELF
@@ -103,7 +81,7 @@ struct process *loadELFModule(void *addr, uint32_t length)
 		/* load ELF executable */
 		assert(elfLoadBinary(p, addr, length));
 
-		t = threadCreate(p, NULL, p->entryPoint);
+		t = threadCreate(p, NULL, p->entryPoint, 0);
 		if (t) objectRelease(t);
 
 		objectRelease(p);
@@ -132,7 +110,8 @@ void kernel_main(multiboot_info_t *bootInfo)
 	consoleClear();
 
 	assert(sizeof(struct taskContext) == 0x68);
-	assert(sizeof(struct fpuContext) == 0x6C);
+	assert(sizeof(struct fpuLegacyContext) == 0x6C);
+	assert(sizeof(struct fpuContext) == 0x200);
 	assert(offsetof(struct taskContext, eip) == 0x20);
 
 	/* ensure that GRUB loaded a usermode process */
@@ -149,17 +128,27 @@ void kernel_main(multiboot_info_t *bootInfo)
 	consoleInit();
 	consoleSetFont();
 	physMemProtectBootEntry(0x9000, PAGE_SIZE);
+	acpiInit();
+	smpReserveMemory();
 	pagingInit();
+	heapInit();
 	gdtInit();
 	fpuInit();
+	threadInit();
+	futexInit();
 
 	/* initialize stdin & stdout */
+	pipeInit();
 	stdout	= stdoutCreate();
 	stdin	= pipeCreate();
 
+	apicInit();
 	picInit(0x20);
 	keyboardInit(&stdin->obj);
+	tscInit();
+	apicTimerInit();
 	timerInit();
+	smpInit();
 	fileSystemInit((void*)module[1].mod_start, module[1].mod_end - module[1].mod_start);
 
 	/* load init process */
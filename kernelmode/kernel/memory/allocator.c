@@ -25,6 +25,7 @@
  *
  */
 
+#include <memory/allocator.h>
 #include <memory/physmem.h>
 #include <memory/paging.h>
 #include <util/util.h>
@@ -38,106 +39,105 @@
 
 #define HEAP_ALIGN_SIZE 16
 #define HEAP_ALIGN_MASK (HEAP_ALIGN_SIZE - 1)
-#define SMALL_HEAP_MAGIC 0xFEEFABB1
-#define LARGE_HEAP_MAGIC 0xFEEFABB2
+#define SMALL_HEAP_MAGIC 0xABB1
+#define LARGE_HEAP_MAGIC 0xABB2
 
 struct heapEntry
 {
-	uint32_t heapMagic;
+	uint16_t heapMagic;
+	uint16_t tag;
 	struct linkedList entry;
-	uint32_t length		: 31;
+	uint32_t length		: 30;
+	uint32_t prevUnused	: 1;
 	uint32_t reserved	: 1;
 };
 
+/* boundary tag at the end of each unused small heap block */
+struct heapFooter
+{
+	uint32_t length;
+	uint32_t heapMagic;
+};
+
 /*
  * Small block heap
  */
 
+/* largest request (without header) which is still handled by the small heap */
+#define SMALL_HEAP_MAX_LENGTH	(PAGE_SIZE - sizeof(struct heapEntry))
+
+/* minimum size of an unused block, must hold the header and the footer */
+#define SMALL_HEAP_MIN_BLOCK	(sizeof(struct heapEntry) + 16)
+
+/*
+ * Size classes: blocks up to 512 bytes have one class per 16 bytes (exact fit),
+ * larger blocks up to PAGE_SIZE are grouped into classes of 128 bytes each.
+ */
+#define SMALL_HEAP_EXACT_LIMIT	512
+#define SMALL_HEAP_CLASS_COUNT	((SMALL_HEAP_EXACT_LIMIT >> 4) - 1 + ((PAGE_SIZE - SMALL_HEAP_EXACT_LIMIT) >> 7))
+#define SMALL_HEAP_MASK_WORDS	((SMALL_HEAP_CLASS_COUNT + 31) >> 5)
+
 static struct linkedList smallHeap				= LL_INIT(smallHeap);
 
-static struct linkedList smallUnusedHeap32		= LL_INIT(smallUnusedHeap32);
-static struct linkedList smallUnusedHeap64		= LL_INIT(smallUnusedHeap64);
-static struct linkedList smallUnusedHeap128		= LL_INIT(smallUnusedHeap128);
-static struct linkedList smallUnusedHeap256		= LL_INIT(smallUnusedHeap256);
-static struct linkedList smallUnusedHeap512		= LL_INIT(smallUnusedHeap512);
-static struct linkedList smallUnusedHeap1024	= LL_INIT(smallUnusedHeap1024);
+/*
+ * A list in smallUnusedHeap is only valid if the corresponding bit in
+ * smallUnusedMask is set, empty lists are initialized on first use.
+ */
+static struct linkedList smallUnusedHeap[SMALL_HEAP_CLASS_COUNT];
+static uint32_t smallUnusedMask[SMALL_HEAP_MASK_WORDS];
 
-static inline struct heapEntry *__smallFindUnusedHeapEntry(uint32_t length)
+static inline uint32_t __smallGetClass(uint32_t length)
 {
-	struct linkedList *list;
-
-	if (length <= 32		&& !ll_empty(&smallUnusedHeap32))
-		list = &smallUnusedHeap32;
-	else if (length <= 64	&& !ll_empty(&smallUnusedHeap64))
-		list = &smallUnusedHeap64;
-	else if (length <= 128	&& !ll_empty(&smallUnusedHeap128))
-		list = &smallUnusedHeap128;
-	else if (length <= 256	&& !ll_empty(&smallUnusedHeap256))
-		list = &smallUnusedHeap256;
-	else if (length <= 512	&& !ll_empty(&smallUnusedHeap512))
-		list = &smallUnusedHeap512;
-	else if (length <= 1024 && !ll_empty(&smallUnusedHeap1024))
-		list = &smallUnusedHeap1024;
-	else
-		return NULL;
+	assert(length >= SMALL_HEAP_MIN_BLOCK && length <= PAGE_SIZE);
 
-	/* return first entry of the corresponding list */
-	return LL_ENTRY(ll_remove(list->next), struct heapEntry, entry);
+	if (length <= SMALL_HEAP_EXACT_LIMIT)
+		return (length >> 4) - 2;
+
+	return (SMALL_HEAP_EXACT_LIMIT >> 4) - 1 + ((length - SMALL_HEAP_EXACT_LIMIT - 1) >> 7);
 }
 
-static inline struct heapEntry *__smallQueueUnusedHeap(struct heapEntry *heap, uint32_t length)
+/* returns the first non-empty class >= first, or SMALL_HEAP_CLASS_COUNT if there is none */
+static inline uint32_t __smallGetNonEmptyClass(uint32_t first)
 {
-	struct linkedList *list;
+	uint32_t i = first >> 5;
+	uint32_t mask;
 
-	if (((uint32_t)heap & PAGE_MASK) == 0 && length == PAGE_SIZE)
+	if (i >= SMALL_HEAP_MASK_WORDS)
+		return SMALL_HEAP_CLASS_COUNT;
+
+	mask = smallUnusedMask[i] & (~0U << (first & 31));
+	while (!mask)
 	{
-		/* unmap and free this page */
-		pagingReleasePhysMem(NULL, heap, 1);
-		return NULL;
+		if (++i >= SMALL_HEAP_MASK_WORDS)
+			return SMALL_HEAP_CLASS_COUNT;
+		mask = smallUnusedMask[i];
 	}
 
-	if (length >= 1024)
-		list = &smallUnusedHeap1024;
-	else if (length >= 512)
-		list = &smallUnusedHeap512;
-	else if (length >= 256)
-		list = &smallUnusedHeap256;
-	else if (length >= 128)
-		list = &smallUnusedHeap128;
-	else if (length >= 64)
-		list = &smallUnusedHeap64;
-	else if (length >= 32)
-		list = &smallUnusedHeap32;
-	else
-		assert(0);
-
-	/* otherwise remember this frame */
-	heap->heapMagic	= SMALL_HEAP_MAGIC;
-	ll_add_after(list, &heap->entry);
-	heap->length	= length;
-	heap->reserved	= 0;
-
-	return heap;
+	return (i << 5) + __builtin_ctz(mask);
 }
 
-static inline struct heapEntry *__smallGetPreviousHeap(struct heapEntry *heap)
+static inline void __smallLinkUnused(struct heapEntry *heap)
 {
-	struct heapEntry *prev_heap = (struct heapEntry *)((uint32_t)heap & ~PAGE_MASK);
+	uint32_t index = __smallGetClass(heap->length);
+	struct linkedList *list = &smallUnusedHeap[index];
 
-	while (prev_heap < heap)
+	if (!(smallUnusedMask[index >> 5] & (1u << (index & 31))))
 	{
-		assert(prev_heap->heapMagic == SMALL_HEAP_MAGIC);
-		assert((prev_heap->length & HEAP_ALIGN_MASK) == 0);
+		ll_init(list);
+		smallUnusedMask[index >> 5] |= (1u << (index & 31));
+	}
 
-		if ((uint32_t)prev_heap + prev_heap->length >= (uint32_t)heap)
-			return prev_heap;
+	ll_add_after(list, &heap->entry);
+}
 
-		prev_heap = (struct heapEntry *)((uint32_t)prev_heap + prev_heap->length);
-	}
+static inline void __smallUnlinkUnused(struct heapEntry *heap)
+{
+	uint32_t index = __smallGetClass(heap->length);
 
-	/* at this point the prev_heap should match heap, otherwise the structure is corrupted */
-	assert(prev_heap == heap);
-	return prev_heap;
+	ll_remove(&heap->entry);
+
+	if (ll_empty(&smallUnusedHeap[index]))
+		smallUnusedMask[index >> 5] &= ~(1u << (index & 31));
 }
 
 static inline struct heapEntry *__smallGetNextHeap(struct heapEntry *heap, uint32_t length)
@@ -151,7 +151,102 @@ static inline struct heapEntry *__smallGetNextHeap(struct heapEntry *heap, uint3
 	return next_heap;
 }
 
-/* internally used to free memory */
+static inline struct heapEntry *__smallGetPreviousHeap(struct heapEntry *heap)
+{
+	struct heapFooter *footer;
+	struct heapEntry *prev_heap;
+
+	/* only unused blocks have a footer */
+	if (!heap->prevUnused) return NULL;
+	assert((uint32_t)heap & PAGE_MASK);
+
+	footer = (struct heapFooter *)((uint32_t)heap - sizeof(struct heapFooter));
+	assert(footer->heapMagic == SMALL_HEAP_MAGIC);
+	assert((footer->length & HEAP_ALIGN_MASK) == 0);
+
+	prev_heap = (struct heapEntry *)((uint32_t)heap - footer->length);
+	assert(prev_heap->heapMagic == SMALL_HEAP_MAGIC);
+	assert(prev_heap->length == footer->length);
+	assert(!prev_heap->reserved);
+
+	return prev_heap;
+}
+
+static inline void __smallSetNextPrevUnused(struct heapEntry *heap, uint32_t length, bool unused)
+{
+	struct heapEntry *next_heap = __smallGetNextHeap(heap, length);
+	if (next_heap) next_heap->prevUnused = unused;
+}
+
+static inline struct heapEntry *__smallFindUnusedHeapEntry(uint32_t length)
+{
+	struct heapEntry *heap, *best_heap = NULL;
+	uint32_t index = __smallGetClass(length);
+
+	/* exact classes only contain blocks of the same size */
+	if (length <= SMALL_HEAP_EXACT_LIMIT)
+	{
+		index = __smallGetNonEmptyClass(index);
+		if (index >= SMALL_HEAP_CLASS_COUNT) return NULL;
+		heap = LL_ENTRY(smallUnusedHeap[index].next, struct heapEntry, entry);
+		__smallUnlinkUnused(heap);
+		return heap;
+	}
+
+	/* search for an exact match in the corresponding class, otherwise use the best fit */
+	if (smallUnusedMask[index >> 5] & (1u << (index & 31)))
+	{
+		LL_FOR_EACH(heap, &smallUnusedHeap[index], struct heapEntry, entry)
+		{
+			if (heap->length < length) continue;
+			if (!best_heap || heap->length < best_heap->length)
+			{
+				best_heap = heap;
+				if (heap->length == length) break;
+			}
+		}
+	}
+
+	/* all blocks in any of the following classes are big enough */
+	if (!best_heap)
+	{
+		index = __smallGetNonEmptyClass(index + 1);
+		if (index >= SMALL_HEAP_CLASS_COUNT) return NULL;
+		best_heap = LL_ENTRY(smallUnusedHeap[index].next, struct heapEntry, entry);
+	}
+
+	__smallUnlinkUnused(best_heap);
+	return best_heap;
+}
+
+static inline struct heapEntry *__smallQueueUnusedHeap(struct heapEntry *heap, uint32_t length)
+{
+	struct heapFooter *footer;
+
+	if (((uint32_t)heap & PAGE_MASK) == 0 && length == PAGE_SIZE)
+	{
+		/* unmap and free this page */
+		pagingReleasePhysMem(NULL, heap, 1);
+		return NULL;
+	}
+
+	assert(length >= SMALL_HEAP_MIN_BLOCK);
+
+	/* otherwise remember this frame */
+	heap->heapMagic	= SMALL_HEAP_MAGIC;
+	heap->length	= length;
+	heap->reserved	= 0;
+	__smallLinkUnused(heap);
+
+	footer = (struct heapFooter *)((uint32_t)heap + length - sizeof(struct heapFooter));
+	footer->heapMagic	= SMALL_HEAP_MAGIC;
+	footer->length		= length;
+
+	__smallSetNextPrevUnused(heap, length, true);
+	return heap;
+}
+
+/* internally used to free memory, deleted_heap->prevUnused has to be valid */
 static struct heapEntry *__smallInternalFree(struct heapEntry *deleted_heap, uint32_t length)
 {
 	struct heapEntry *heap;
@@ -161,9 +256,9 @@ static struct heapEntry *__smallInternalFree(struct heapEntry *deleted_heap, uin
 
 	/* step 1: try to merge with previous free areas */
 	heap = __smallGetPreviousHeap(deleted_heap);
-	if (heap && !heap->reserved)
+	if (heap)
 	{
-		ll_remove(&heap->entry);
+		__smallUnlinkUnused(heap);
 		length = (uint32_t)deleted_heap + length - (uint32_t)heap;
 		deleted_heap = heap;
 	}
@@ -172,13 +267,28 @@ static struct heapEntry *__smallInternalFree(struct heapEntry *deleted_heap, uin
 	heap = __smallGetNextHeap(deleted_heap, length);
 	if (heap && !heap->reserved)
 	{
-		ll_remove(&heap->entry);
+		__smallUnlinkUnused(heap);
 		length = (uint32_t)heap + heap->length - (uint32_t)deleted_heap;
 	}
 
 	return __smallQueueUnusedHeap(deleted_heap, length);
 }
 
+/* splits a reserved block and gives the remaining part back to the unused lists */
+static void __smallSplitHeap(struct heapEntry *heap, uint32_t length, uint32_t origHeapLength)
+{
+	struct heapEntry *rest_heap;
+
+	if (length < origHeapLength)
+	{
+		rest_heap = (struct heapEntry *)((uint32_t)heap + length);
+		rest_heap->prevUnused = 0;
+		__smallInternalFree(rest_heap, origHeapLength - length);
+	}
+	else
+		__smallSetNextPrevUnused(heap, length, false);
+}
+
 static struct heapEntry *__smallAlloc(uint32_t length)
 {
 	struct heapEntry *heap;
@@ -187,6 +297,7 @@ static struct heapEntry *__smallAlloc(uint32_t length)
 	/* try to find a free area which has the minimum required size */
 	length += sizeof(struct heapEntry);
 	length = (length + HEAP_ALIGN_MASK) & ~HEAP_ALIGN_MASK;
+	if (length < SMALL_HEAP_MIN_BLOCK) length = SMALL_HEAP_MIN_BLOCK;
 	heap = __smallFindUnusedHeapEntry(length);
 
 	/* we found a block */
@@ -201,12 +312,14 @@ static struct heapEntry *__smallAlloc(uint32_t length)
 	}
 	else
 	{
-		heap = pagingAllocatePhysMem(NULL, 1, true, false);
+		heap = pagingTryAllocatePhysMem(NULL, 1, true, false);
+		if (!heap) return NULL;
+		heap->prevUnused = 0;
 		origHeapLength = PAGE_SIZE;
 	}
 
 	/* use full memory if the remaining space is too small to be useful */
-	if (origHeapLength < length + sizeof(struct heapEntry) + 16)
+	if (origHeapLength < length + SMALL_HEAP_MIN_BLOCK)
 		length = origHeapLength;
 
 	heap->heapMagic	= SMALL_HEAP_MAGIC;
@@ -215,9 +328,7 @@ static struct heapEntry *__smallAlloc(uint32_t length)
 	heap->reserved	= 1;
 
 	/* give the rest back to the owner */
-	if (length < origHeapLength)
-		__smallInternalFree((struct heapEntry *)((uint32_t)heap + length), origHeapLength - length);
-
+	__smallSplitHeap(heap, length, origHeapLength);
 	return heap;
 }
 
@@ -241,11 +352,12 @@ static struct heapEntry *__smallReAlloc(struct heapEntry *heap, uint32_t length)
 	assert(heap->reserved);
 
 	/* it makes more sense to store this in a large heap entry */
-	if (length > 1024 - sizeof(struct heapEntry))
+	if (length > SMALL_HEAP_MAX_LENGTH)
 		return NULL;
 
 	length += sizeof(struct heapEntry);
 	length = (length + HEAP_ALIGN_MASK) & ~HEAP_ALIGN_MASK;
+	if (length < SMALL_HEAP_MIN_BLOCK) length = SMALL_HEAP_MIN_BLOCK;
 
 	origHeapLength = heap->length;
 	if (length > origHeapLength)
@@ -256,7 +368,7 @@ static struct heapEntry *__smallReAlloc(struct heapEntry *heap, uint32_t length)
 		if (length > (uint32_t)next_heap + next_heap->length - (uint32_t)heap) return NULL;
 
 		/* temporarily let our current block span both of them */
-		ll_remove(&next_heap->entry);
+		__smallUnlinkUnused(next_heap);
 		origHeapLength = (uint32_t)next_heap + next_heap->length - (uint32_t)heap;
 	}
 
@@ -264,7 +376,7 @@ static struct heapEntry *__smallReAlloc(struct heapEntry *heap, uint32_t length)
 	assert(origHeapLength >= length);
 
 	/* use full memory if the remaining space is too small to be useful */
-	if (origHeapLength < length + sizeof(struct heapEntry) + 16)
+	if (origHeapLength < length + SMALL_HEAP_MIN_BLOCK)
 		length = origHeapLength;
 
 	/* element is still in the smallList */
@@ -273,9 +385,7 @@ static struct heapEntry *__smallReAlloc(struct heapEntry *heap, uint32_t length)
 	heap->reserved	= 1;
 
 	/* give the rest back to the owner */
-	if (length < origHeapLength)
-		__smallInternalFree((struct heapEntry *)((uint32_t)heap + length), origHeapLength - length);
-
+	__smallSplitHeap(heap, length, origHeapLength);
 	return heap;
 }
 
@@ -285,6 +395,100 @@ static struct heapEntry *__smallReAlloc(struct heapEntry *heap, uint32_t length)
 
 static struct linkedList largeHeap = LL_INIT(largeHeap);
 
+/*
+ * Cache of recently freed large blocks, to avoid modifying the page tables
+ * (and flushing the TLB) when the same sizes are allocated again and again.
+ * Runs are bucketed by their number of pages, the total number of cached
+ * pages is limited, the least recently freed runs are released first.
+ */
+#define LARGE_HEAP_CACHE_BUCKETS	32
+#define LARGE_HEAP_CACHE_LIMIT		128
+
+struct largeCacheEntry
+{
+	struct heapEntry heap;
+	struct linkedList lru;
+};
+
+/* a list in largeCache is only valid if the corresponding bit in largeCacheMask is set */
+static struct linkedList largeCache[LARGE_HEAP_CACHE_BUCKETS];
+static uint32_t largeCacheMask = 0;
+
+static struct linkedList largeCacheLRU = LL_INIT(largeCacheLRU);
+static uint32_t largeCachePages = 0;
+
+static void __largeCacheRemove(struct largeCacheEntry *cache)
+{
+	uint32_t index = (cache->heap.length >> PAGE_BITS) - 1;
+
+	assert(cache->heap.heapMagic == LARGE_HEAP_MAGIC);
+	assert(!cache->heap.reserved);
+
+	ll_remove(&cache->heap.entry);
+	ll_remove(&cache->lru);
+
+	if (ll_empty(&largeCache[index]))
+		largeCacheMask &= ~(1u << index);
+
+	largeCachePages -= cache->heap.length >> PAGE_BITS;
+}
+
+static void __largeCacheEvict(struct largeCacheEntry *cache)
+{
+	__largeCacheRemove(cache);
+	pagingReleasePhysMem(NULL, cache, cache->heap.length >> PAGE_BITS);
+}
+
+static void __largeCacheInsert(struct heapEntry *heap, uint32_t length)
+{
+	struct largeCacheEntry *cache = (struct largeCacheEntry *)heap;
+	uint32_t index = (length >> PAGE_BITS) - 1;
+
+	assert(((uint32_t)heap & PAGE_MASK) == 0);
+	assert(length > 0 && (length & PAGE_MASK) == 0);
+
+	/* don't keep memory which is about to be reclaimed */
+	if (index >= LARGE_HEAP_CACHE_BUCKETS || physMemIsShrinking())
+	{
+		pagingReleasePhysMem(NULL, heap, length >> PAGE_BITS);
+		return;
+	}
+
+	/* make room by releasing the oldest entries */
+	while (largeCachePages + (length >> PAGE_BITS) > LARGE_HEAP_CACHE_LIMIT)
+		__largeCacheEvict(LL_ENTRY(largeCacheLRU.prev, struct largeCacheEntry, lru));
+
+	if (!(largeCacheMask & (1u << index)))
+	{
+		ll_init(&largeCache[index]);
+		largeCacheMask |= (1u << index);
+	}
+
+	cache->heap.heapMagic	= LARGE_HEAP_MAGIC;
+	ll_add_after(&largeCache[index], &cache->heap.entry);
+	cache->heap.length		= length;
+	cache->heap.prevUnused	= 0;
+	cache->heap.reserved	= 0;
+	ll_add_after(&largeCacheLRU, &cache->lru);
+
+	largeCachePages += length >> PAGE_BITS;
+}
+
+static struct heapEntry *__largeCacheLookup(uint32_t length)
+{
+	struct largeCacheEntry *cache;
+	uint32_t index = (length >> PAGE_BITS) - 1;
+
+	if (index >= LARGE_HEAP_CACHE_BUCKETS || !(largeCacheMask & (1u << index)))
+		return NULL;
+
+	cache = LL_ENTRY(largeCache[index].next, struct largeCacheEntry, heap.entry);
+	assert(cache->heap.length == length);
+	__largeCacheRemove(cache);
+
+	return &cache->heap;
+}
+
 static struct heapEntry *__largeAlloc(uint32_t length)
 {
 	struct heapEntry *heap;
@@ -292,12 +496,16 @@ static struct heapEntry *__largeAlloc(uint32_t length)
 	/* add overhead for entry and round up to next page boundary */
 	length += sizeof(struct heapEntry);
 	length = (length + PAGE_MASK) & ~PAGE_MASK;
-	heap = pagingAllocatePhysMem(NULL, length >> PAGE_BITS, true, false);
+
+	heap = __largeCacheLookup(length);
+	if (!heap) heap = pagingTryAllocatePhysMem(NULL, length >> PAGE_BITS, true, false);
+	if (!heap) return NULL;
 
 	/* pur into our vector of allocated blocks */
 	heap->heapMagic = LARGE_HEAP_MAGIC;
 	ll_add_after(&largeHeap, &heap->entry);
 	heap->length	= length;
+	heap->prevUnused = 0;
 	heap->reserved	= 1;
 
 	return heap;
@@ -305,8 +513,6 @@ static struct heapEntry *__largeAlloc(uint32_t length)
 
 static void __largeFree(struct heapEntry *heap)
 {
-	/* uint32_t length; */
-
 	assert(((uint32_t)heap & PAGE_MASK) == 0);
 	assert(heap->heapMagic == LARGE_HEAP_MAGIC);
 	assert((heap->length & PAGE_MASK) == 0);
@@ -314,17 +520,19 @@ static void __largeFree(struct heapEntry *heap)
 
 	ll_remove(&heap->entry);
 
-	pagingReleasePhysMem(NULL, heap, heap->length >> PAGE_BITS);
+	__largeCacheInsert(heap, heap->length);
 }
 
 static struct heapEntry *__largeReAlloc(struct heapEntry *heap, uint32_t length)
 {
+	struct heapEntry *new_heap;
+
 	assert(((uint32_t)heap & PAGE_MASK) == 0);
 	assert(heap->heapMagic == LARGE_HEAP_MAGIC);
 	assert((heap->length & PAGE_MASK) == 0);
 
 	/* it makes more sense to store this in a small heap entry */
-	if (length <= 1024 - sizeof(struct heapEntry))
+	if (length <= SMALL_HEAP_MAX_LENGTH)
 		return NULL;
 
 	/* add overhead for entry and round up to next page boundary */
@@ -335,19 +543,125 @@ static struct heapEntry *__largeReAlloc(struct heapEntry *heap, uint32_t length)
 	if (length == heap->length)
 		return heap;
 
-	/* temporarily remove the entry while we're relocating */
+	/* shrinking, move the remaining pages to the cache */
+	if (length < heap->length)
+	{
+		__largeCacheInsert((struct heapEntry *)((uint32_t)heap + length), heap->length - length);
+		heap->length = length;
+		return heap;
+	}
+
+	/* growing, reuse a cached block if there is one with the right size */
+	new_heap = __largeCacheLookup(length);
+	if (!new_heap)
+	{
+		/* try to extend the block in place */
+		if (pagingTryAllocatePhysMemFixed(NULL, (uint8_t *)heap + heap->length,
+				(length - heap->length) >> PAGE_BITS, true, false))
+		{
+			heap->length = length;
+			return heap;
+		}
+
+		/* otherwise move it, but don't fail if we are out of memory */
+		new_heap = pagingTryAllocatePhysMem(NULL, length >> PAGE_BITS, true, false);
+		if (!new_heap) return NULL;
+	}
+
+	memcpy((uint8_t *)new_heap + sizeof(struct heapEntry), (uint8_t *)heap + sizeof(struct heapEntry),
+			heap->length - sizeof(struct heapEntry));
+
 	ll_remove(&heap->entry);
+	__largeCacheInsert(heap, heap->length);
 
-	/* let the paging layer find some better spot for this */
-	heap = pagingReAllocatePhysMem(NULL, heap, heap->length >> PAGE_BITS, length >> PAGE_BITS, true, false);
+	new_heap->heapMagic = LARGE_HEAP_MAGIC;
+	new_heap->tag		= heap->tag;
+	ll_add_after(&largeHeap, &new_heap->entry);
+	new_heap->length		= length;
+	new_heap->prevUnused	= 0;
+	new_heap->reserved		= 1;
 
-	/* update all the values */
-	assert(heap->heapMagic == LARGE_HEAP_MAGIC);
-	ll_add_after(&largeHeap, &heap->entry);
-	heap->length	= length;
-	heap->reserved	= 1;
+	return new_heap;
+}
 
-	return heap;
+/* shrinker, releases the least recently used entries of the large block cache */
+static uint32_t __largeCacheShrink(uint32_t pages)
+{
+	struct largeCacheEntry *cache;
+	uint32_t released = 0;
+
+	while (released < pages && !ll_empty(&largeCacheLRU))
+	{
+		cache = LL_ENTRY(largeCacheLRU.prev, struct largeCacheEntry, lru);
+		released += cache->heap.length >> PAGE_BITS;
+		__largeCacheEvict(cache);
+	}
+
+	return released;
+}
+
+/*
+ * Accounting
+ */
+
+static struct heapTagInfo heapTags[HEAP_TAG_COUNT] =
+{
+	[HEAP_TAG_GENERIC]		= { .name = "generic" },
+	[HEAP_TAG_PROCESS]		= { .name = "process" },
+	[HEAP_TAG_THREAD]		= { .name = "thread" },
+	[HEAP_TAG_HANDLES]		= { .name = "handles" },
+	[HEAP_TAG_PIPE]			= { .name = "pipe" },
+	[HEAP_TAG_EVENT]		= { .name = "event" },
+	[HEAP_TAG_SEMAPHORE]	= { .name = "semaphore" },
+	[HEAP_TAG_TIMER]		= { .name = "timer" },
+	[HEAP_TAG_FILESYSTEM]	= { .name = "filesystem" },
+	[HEAP_TAG_FILE_BUFFER]	= { .name = "file buffer" },
+	[HEAP_TAG_LOADER]		= { .name = "loader" },
+	[HEAP_TAG_IORING]		= { .name = "io ring" },
+};
+
+static inline void __heapAccountAlloc(struct heapEntry *heap)
+{
+	struct heapTagInfo *info = &heapTags[heap->tag];
+
+	info->liveBytes += heap->length;
+	if (info->liveBytes > info->peakBytes)
+		info->peakBytes = info->liveBytes;
+
+	info->liveAllocations++;
+	info->totalAllocations++;
+}
+
+static inline void __heapAccountFree(struct heapEntry *heap)
+{
+	struct heapTagInfo *info = &heapTags[heap->tag];
+
+	assert(info->liveBytes >= heap->length);
+	assert(info->liveAllocations);
+
+	info->liveBytes -= heap->length;
+	info->liveAllocations--;
+}
+
+static inline void __heapAccountResize(struct heapEntry *heap, uint32_t old_length)
+{
+	struct heapTagInfo *info = &heapTags[heap->tag];
+
+	assert(info->liveBytes >= old_length);
+
+	info->liveBytes = info->liveBytes - old_length + heap->length;
+	if (info->liveBytes > info->peakBytes)
+		info->peakBytes = info->liveBytes;
+}
+
+/**
+ * @brief Initializes the kernel memory allocator
+ * @details Registers the shrinker which releases cached memory of the allocator
+ *			when the system runs out of physical memory.
+ */
+void heapInit()
+{
+	assert(physMemRegisterShrinker(__largeCacheShrink));
 }
 
 /**
@@ -355,22 +669,31 @@ static struct heapEntry *__largeReAlloc(struct heapEntry *heap, uint32_t length)
  * @details Allocates a block of kernel memory of the requested size. The algorithm
  *			will always return a pointer aligned to a 16-byte boundary, or NULL
  *			if the request cannot be fulfilled. The new memory block will not be
- *			initialized.
+ *			initialized. The block is accounted to the subsystem given by tag,
+ *			see heapInfo().
  *
  * @param length Number of bytes to allocate
+ * @param tag One of the \ref HeapTags "Heap allocation tags"
  * @return Pointer to the allocated memory block or NULL if the request cannot be fulfilled
  */
-void *heapAlloc(uint32_t length)
+void *heapAlloc(uint32_t length, uint32_t tag)
 {
 	struct heapEntry *heap;
 	if (!length) return NULL;
 
-	if (length <= 1024 - sizeof(struct heapEntry))
+	assert(tag < HEAP_TAG_COUNT);
+
+	if (length <= SMALL_HEAP_MAX_LENGTH)
 		heap = __smallAlloc(length);
 	else
 		heap = __largeAlloc(length);
 
-	return heap ? (void *)((uint32_t)heap + sizeof(struct heapEntry)) : NULL;
+	if (!heap) return NULL;
+
+	heap->tag = tag;
+	__heapAccountAlloc(heap);
+
+	return (void *)((uint32_t)heap + sizeof(struct heapEntry));
 }
 
 /**
@@ -393,6 +716,8 @@ void heapFree(void *addr)
 	assert(heap->heapMagic == SMALL_HEAP_MAGIC || heap->heapMagic == LARGE_HEAP_MAGIC);
 	assert(heap->reserved);
 
+	__heapAccountFree(heap);
+
 	if (heap->heapMagic == SMALL_HEAP_MAGIC)
 		__smallFree(heap);
 	else
@@ -429,7 +754,9 @@ uint32_t heapSize(void *addr)
  *			(for example not enough memory left). Otherwise this function returns
  *			a pointer to the new location of the memory block, which can be, but
  *			is not necessarily equal to the previous location. The new bytes of
- *			memory are not initialized before this function returns.
+ *			memory are not initialized before this function returns. The block
+ *			keeps its allocation tag, if addr is NULL the new block is accounted
+ *			as HEAP_TAG_GENERIC.
  *
  * @param addr Pointer to a memory block
  * @param length New requested length
@@ -439,11 +766,12 @@ uint32_t heapSize(void *addr)
 void *heapReAlloc(void *addr, uint32_t length)
 {
 	struct heapEntry *heap, *new_heap = NULL;
+	uint32_t old_length;
 	void *new_addr;
 
 	/* no addr given -> allocate memory, no length -> free memory */
 	if (!addr)
-		return heapAlloc(length);
+		return heapAlloc(length, HEAP_TAG_GENERIC);
 
 	if (!length)
 	{
@@ -457,6 +785,7 @@ void *heapReAlloc(void *addr, uint32_t length)
 	assert(heap->heapMagic == SMALL_HEAP_MAGIC || heap->heapMagic == LARGE_HEAP_MAGIC);
 	assert(heap->reserved);
 
+	old_length = heap->length;
 	if (heap->heapMagic == SMALL_HEAP_MAGIC)
 		new_heap = __smallReAlloc(heap, length);
 	else
@@ -464,10 +793,13 @@ void *heapReAlloc(void *addr, uint32_t length)
 
 	/* return the new heap if we had success */
 	if (new_heap)
+	{
+		__heapAccountResize(new_heap, old_length);
 		return (void *)((uint32_t)new_heap + sizeof(struct heapEntry));
+	}
 
 	/* no faster method, we allocate a new block and copy the data */
-	new_addr = heapAlloc(length);
+	new_addr = heapAlloc(length, heap->tag);
 	if (!new_addr) return NULL;
 
 	/* copy data */
@@ -484,13 +816,15 @@ void *heapReAlloc(void *addr, uint32_t length)
  */
 void heapVerify()
 {
-	struct heapEntry *heap;
+	struct heapEntry *heap, *next_heap;
+	struct heapFooter *footer;
+	uint32_t i, pages;
 
 	LL_FOR_EACH(heap, &smallHeap, struct heapEntry, entry)
 	{
 		assert(((uint32_t)heap & HEAP_ALIGN_MASK) == 0);
 		assert(heap->heapMagic == SMALL_HEAP_MAGIC);
-		assert(heap->length >= sizeof(struct heapEntry) + 16);
+		assert(heap->length >= SMALL_HEAP_MIN_BLOCK);
 		assert(heap->reserved);
 	}
 
@@ -502,27 +836,69 @@ void heapVerify()
 		assert(heap->reserved);
 	}
 
-	#define VALIDATE_UNUSED_LIST(unused_list) \
-		do \
-		{ \
-			LL_FOR_EACH(heap, unused_list, struct heapEntry, entry) \
-			{ \
-				assert(((uint32_t)heap & HEAP_ALIGN_MASK) == 0); \
-				assert(heap->heapMagic == SMALL_HEAP_MAGIC); \
-				assert(heap->length >= sizeof(struct heapEntry) + 16); \
-				assert(!heap->reserved); \
-			} \
-		} \
-		while(0)
-
-	VALIDATE_UNUSED_LIST(&smallUnusedHeap32);
-	VALIDATE_UNUSED_LIST(&smallUnusedHeap64);
-	VALIDATE_UNUSED_LIST(&smallUnusedHeap128);
-	VALIDATE_UNUSED_LIST(&smallUnusedHeap256);
-	VALIDATE_UNUSED_LIST(&smallUnusedHeap512);
-	VALIDATE_UNUSED_LIST(&smallUnusedHeap1024);
-
-	#undef VALIDATE_UNUSED_LIST
+	pages = 0;
+	for (i = 0; i < LARGE_HEAP_CACHE_BUCKETS; i++)
+	{
+		if (!(largeCacheMask & (1u << i)))
+			continue;
+
+		assert(!ll_empty(&largeCache[i]));
+		LL_FOR_EACH(heap, &largeCache[i], struct heapEntry, entry)
+		{
+			assert(((uint32_t)heap & PAGE_MASK) == 0);
+			assert(heap->heapMagic == LARGE_HEAP_MAGIC);
+			assert(heap->length == (i + 1) << PAGE_BITS);
+			assert(!heap->reserved);
+			pages += i + 1;
+		}
+	}
+	assert(pages == largeCachePages && pages <= LARGE_HEAP_CACHE_LIMIT);
+
+	for (i = 0; i < SMALL_HEAP_CLASS_COUNT; i++)
+	{
+		if (!(smallUnusedMask[i >> 5] & (1u << (i & 31))))
+			continue;
+
+		assert(!ll_empty(&smallUnusedHeap[i]));
+		LL_FOR_EACH(heap, &smallUnusedHeap[i], struct heapEntry, entry)
+		{
+			assert(((uint32_t)heap & HEAP_ALIGN_MASK) == 0);
+			assert(heap->heapMagic == SMALL_HEAP_MAGIC);
+			assert(heap->length >= SMALL_HEAP_MIN_BLOCK);
+			assert(__smallGetClass(heap->length) == i);
+			assert(!heap->reserved);
+
+			footer = (struct heapFooter *)((uint32_t)heap + heap->length - sizeof(struct heapFooter));
+			assert(footer->heapMagic == SMALL_HEAP_MAGIC);
+			assert(footer->length == heap->length);
+
+			/* adjacent unused blocks should have been merged */
+			assert(!heap->prevUnused);
+			next_heap = __smallGetNextHeap(heap, heap->length);
+			assert(!next_heap || (next_heap->reserved && next_heap->prevUnused));
+		}
+	}
+}
+
+/**
+ * @brief Returns the kernel memory usage of each subsystem
+ * @details Fills the provided array with the number of live bytes, the peak
+ *			number of bytes and the allocation counts for each of the
+ *			\ref HeapTags "Heap allocation tags". The byte counts include the
+ *			per-block overhead of the allocator.
+ *
+ * @param info Pointer to an array of heapTagInfo structures
+ * @param count Number of entries in the array
+ * @return Number of heap tags (can also be greater than count)
+ */
+uint32_t heapInfo(struct heapTagInfo *info, uint32_t count)
+{
+	uint32_t i;
+
+	for (i = 0; i < HEAP_TAG_COUNT && i < count; i++)
+		info[i] = heapTags[i];
+
+	return HEAP_TAG_COUNT;
 }
 
 /**
@@ -28,6 +28,7 @@
 #include <memory/paging.h>
 #include <memory/physmem.h>
 #include <interrupt/interrupt.h>
+#include <hardware/smp.h>
 #include <process/process.h>
 #include <process/thread.h>
 #include <console/console.h>
@@ -107,6 +108,9 @@ asm(".text\n.align 4\n"
 static inline void __flushTLBSingle(void *addr)
 {
    asm volatile("invlpg (%0)" ::"r" (addr) : "memory");
+
+   /* other processors flush their TLB when they acquire the kernel lock */
+   smpTLBGeneration++;
 }
 
 static inline bool __isReserved(struct pagingEntry *table)
@@ -127,6 +131,9 @@ static struct pagingEntry *__getPagingEntry(struct process *p, void *addr, bool
 
 	if (pagingEnabled)
 	{
+		/* another processor running the process could still use the old entries */
+		if (p != NULL) smpStopProcess(p);
+
 		/* lookup the paging directory corresponding to the process */
 		dir = (p != NULL) ? p->pageDirectory : (struct pagingEntry *)KERNEL_DIR_ADDR;
 	}
@@ -685,10 +692,7 @@ void *pagingAllocatePhysMem(struct process *p, uint32_t length, bool rw, bool us
  */
 void *pagingAllocatePhysMemUnpageable(struct process *p, uint32_t length, bool rw, bool user)
 {
-	struct pagingEntry *table;
-	void *addr = pagingTrySearchArea(p, length);
-	uint8_t *cur;
-	uint32_t index;
+	void *addr = pagingTryAllocatePhysMemUnpageable(p, length, rw, user);
 
 	if (!addr)
 	{
@@ -696,13 +700,44 @@ void *pagingAllocatePhysMemUnpageable(struct process *p, uint32_t length, bool r
 		return NULL;
 	}
 
+	return addr;
+}
+
+/**
+ * @brief Tries to allocate several pages of unpageable physical memory in a process
+ * @details Similar to pagingAllocatePhysMemUnpageable(), but returns NULL if there
+ *			is no free spot in the page table or not enough physical memory left.
+ *
+ * @param p Pointer to a process object or NULL for the kernel
+ * @param length Number of consecutive pages which have to be unused
+ * @param rw If true then the page has write permission, otherwise it is a read-only page
+ * @param user If true then the user (ring3) also has access to the page, otherwise only the kernel
+ *
+ * @return Virtual base address to the allocated memory block (inside of the process) or NULL
+ */
+void *pagingTryAllocatePhysMemUnpageable(struct process *p, uint32_t length, bool rw, bool user)
+{
+	struct pagingEntry *table;
+	void *addr = pagingTrySearchArea(p, length);
+	uint8_t *cur;
+	uint32_t index, i;
+
+	if (!addr) return NULL;
+
 	/* reserve the whole area - this is necessary since we want to mark the
 	 * memory as unpageable, which will probably again call a memory allocator */
 	pagingReserveArea(p, addr, length, user);
 
-	for (cur = addr; length; length--, cur += PAGE_SIZE)
+	for (cur = addr, i = 0; i < length; i++, cur += PAGE_SIZE)
 	{
-		index = physMemMarkUnpageable(physMemAllocPage(false));
+		if (!physMemTryAllocPage(false, &index))
+		{
+			/* out of memory, release the pages and the remaining reservation */
+			pagingReleasePhysMem(p, addr, length);
+			return NULL;
+		}
+
+		index = physMemMarkUnpageable(index);
 		table = __getPagingEntry(p, cur, true);
 		assert(__isReserved(table));
 
@@ -723,8 +758,8 @@ void *pagingAllocatePhysMemUnpageable(struct process *p, uint32_t length, bool r
 /**
  * @brief Tries to allocates several pages of physical memory in a process
  * @details Similar to pagingAllocatePhysMem(), but doesn't fail if the algorithm
- *			cannot find any spot in the corresponding page table. In such a case
- *			NULL will be returned.
+ *			cannot find any spot in the corresponding page table or if there is
+ *			not enough physical memory left. In such a case NULL will be returned.
  *
  * @param p Pointer to a process object or NULL for the kernel
  * @param length Number of consecutive pages which have to be unused
@@ -744,7 +779,13 @@ void *pagingTryAllocatePhysMem(struct process *p, uint32_t length, bool rw, bool
 
 	for (cur = addr; length; length--, cur += PAGE_SIZE)
 	{
-		index = physMemAllocPage(false);
+		if (!physMemTryAllocPage(false, &index))
+		{
+			/* out of memory, undo everything */
+			pagingReleasePhysMem(p, addr, ((uint32_t)cur - (uint32_t)addr) >> PAGE_BITS);
+			return NULL;
+		}
+
 		table = __getPagingEntry(p, cur, true);
 		assert(!table->value);
 
@@ -857,14 +898,22 @@ void *pagingTryAllocatePhysMemFixed(struct process *p, void *addr, uint32_t leng
 	/* we don't allow mapping something in the NULL page for now */
 	if (((uint32_t)addr & ~PAGE_MASK) == 0) return NULL;
 
+	/* the last page directory entry is used to access the page tables */
+	if ((uint32_t)addr >= (uint32_t)KERNEL_PAGE_ADDR || length > ((uint32_t)KERNEL_PAGE_ADDR - (uint32_t)addr) >> PAGE_BITS) return NULL;
+
 	for (cur = addr; length; length--, cur += PAGE_SIZE)
 	{
-		index = physMemAllocPage(false);
+		if (!physMemTryAllocPage(false, &index))
+		{
+			pagingReleasePhysMem(p, addr, ((uint32_t)cur - (uint32_t)addr) >> PAGE_BITS);
+			return NULL;
+		}
+
 		table = __getPagingEntry(p, cur, true);
 		if (table->value)
 		{
 			physMemReleasePage(index);
-			pagingReleasePhysMem(NULL, addr, ((uint32_t)cur - (uint32_t)addr) >> PAGE_BITS);
+			pagingReleasePhysMem(p, addr, ((uint32_t)cur - (uint32_t)addr) >> PAGE_BITS);
 			return NULL;
 		}
 
@@ -916,6 +965,28 @@ static void *__pagingMove(struct process *p, void *dst_addr, void *src_addr, uin
 	return (void *)((uint32_t)dst_addr | ((uint32_t)src_addr & PAGE_MASK));
 }
 
+/**
+ * @brief Excludes some pages of a process from being copied into forked processes
+ * @details This is used for memory which is shared with the kernel, and therefore
+ *			must not be duplicated on write after forking. The pages have to be present.
+ *
+ * @param p Pointer to the process object
+ * @param addr Virtual address of the memory block
+ * @param length Number of consecutive pages
+ */
+void pagingMarkNoFork(struct process *p, void *addr, uint32_t length)
+{
+	struct pagingEntry *table;
+	uint8_t *cur;
+
+	for (cur = addr; length; length--, cur += PAGE_SIZE)
+	{
+		table = __getPagingEntry(p, cur, false);
+		assert(table && table->present && table->avail == 0);
+		table->avail = PAGING_AVAIL_PRESENT_NO_FORK;
+	}
+}
+
 /**
  * @brief Reallocates a specific range of virtual memory in a process
  * @details Changes the size of a block of virtual memory. If the new size is
@@ -1600,6 +1671,152 @@ invalid:
 	return NULL;
 }
 
+/**
+ * @brief Maps a page of a usermode process into the kernel without copying it
+ * @details The page is mapped read-only into the kernel and marked as copy-on-write
+ *			in the process, such that later modifications by the process don't affect
+ *			the kernel mapping. Pages which are shared with other processes or the
+ *			kernel and read-only pages which are not copy-on-write can't be protected
+ *			this way, for them NULL is returned.
+ *
+ * @param src_p Pointer to the process object
+ * @param src_addr Page aligned virtual address of the source page
+ * @return Virtual address of the mapped page (inside of the kernel) or NULL
+ */
+void *pagingTryShareUserPage(struct process *src_p, void *src_addr)
+{
+	struct pagingEntry *src, *dst;
+	void *dst_addr = pagingSearchArea(NULL, 1);
+
+	assert(((uint32_t)src_addr & PAGE_MASK) == 0);
+
+	/* reserve the area first, paging in the source page might allocate memory */
+	pagingReserveArea(NULL, dst_addr, 1, false);
+
+	src = __getPagingEntry(src_p, src_addr, false);
+	if (!src || !src->value || !src->user) goto invalid;
+
+	if (!src->present)
+	{
+		switch (src->avail)
+		{
+			case PAGING_AVAIL_NOTPRESENT_RESERVED:
+				goto invalid;
+
+			case PAGING_AVAIL_NOTPRESENT_OUTPAGED:
+				physMemPageIn(src->frame);
+				break;
+
+			case PAGING_AVAIL_NOTPRESENT_ON_ACCESS_CREATE:
+			default:
+				assert(0);
+		}
+
+		assert(src->present);
+	}
+
+	/* modifications of shared pages have to stay visible, so they can't be protected */
+	if (src->avail != 0 && src->avail != PAGING_AVAIL_PRESENT_ON_WRITE_DUPLICATE)
+		goto invalid;
+
+	/* read-only pages (like the shared data page) must not become copy-on-write */
+	if (!src->rw && src->avail != PAGING_AVAIL_PRESENT_ON_WRITE_DUPLICATE)
+		goto invalid;
+
+	if (src->rw)
+	{
+		src->rw		= 0;
+		src->avail	= PAGING_AVAIL_PRESENT_ON_WRITE_DUPLICATE;
+	}
+
+	dst = __getPagingEntry(NULL, dst_addr, true);
+	assert(__isReserved(dst));
+
+	/* copy the whole entry to the destination */
+	*dst = *src;
+	dst->user		= false;
+
+	/* increase refcount */
+	physMemAddRefPage(dst->frame);
+
+	__flushTLBSingle(dst_addr);
+	return dst_addr;
+
+invalid:
+	pagingReleasePhysMem(NULL, dst_addr, 1);
+	return NULL;
+}
+
+/**
+ * @brief Moves a kernel page into a usermode process
+ * @details Replaces the page at dst_addr in the process with the physical page which
+ *			is mapped at src_addr in the kernel, and unmaps it from the kernel. The
+ *			previous page of the process is released. If the physical page is still
+ *			referenced somewhere else, it is marked as copy-on-write in the process.
+ *			The destination page has to be writeable by the process and must not be
+ *			shared, otherwise nothing is changed and false is returned.
+ *
+ * @param dst_p Pointer to the process object
+ * @param dst_addr Page aligned virtual address of the destination page
+ * @param src_addr Page aligned virtual address of the source page (inside of the kernel)
+ * @return True on success, otherwise false
+ */
+bool pagingTryMoveToUserPage(struct process *dst_p, void *dst_addr, void *src_addr)
+{
+	struct pagingEntry *dst;
+	uint32_t index, old_index;
+
+	assert(((uint32_t)dst_addr & PAGE_MASK) == 0);
+
+	dst = __getPagingEntry(dst_p, dst_addr, false);
+	if (!dst || !dst->value || !dst->user) return false;
+
+	if (!dst->present)
+	{
+		switch (dst->avail)
+		{
+			case PAGING_AVAIL_NOTPRESENT_RESERVED:
+				return false;
+
+			case PAGING_AVAIL_NOTPRESENT_OUTPAGED:
+				physMemPageIn(dst->frame);
+				break;
+
+			case PAGING_AVAIL_NOTPRESENT_ON_ACCESS_CREATE:
+			default:
+				assert(0);
+		}
+
+		assert(dst->present);
+	}
+
+	/* the page has to be writeable, and other users must not see the change */
+	if (dst->avail ? (dst->avail != PAGING_AVAIL_PRESENT_ON_WRITE_DUPLICATE) : !dst->rw)
+		return false;
+
+	/* take over the physical page */
+	index		= physMemAddRefPage(pagingGetPhysMem(NULL, src_addr));
+	old_index	= dst->frame;
+	pagingReleasePhysMem(NULL, src_addr, 1);
+
+	dst->frame	= index;
+	if (physMemIsLastRef(index))
+	{
+		dst->rw		= 1;
+		dst->avail	= 0;
+	}
+	else
+	{
+		dst->rw		= 0;
+		dst->avail	= PAGING_AVAIL_PRESENT_ON_WRITE_DUPLICATE;
+	}
+
+	physMemReleasePage(old_index);
+
+	if (dst_p == NULL) __flushTLBSingle(dst_addr);
+	return true;
+}
+
 /**
  * @brief Releases several pages of physical memory of a process
  * @details This function is similar to pagingTryReleasePhysMem() and iterates
@@ -60,6 +60,8 @@ struct physMemExtraInfo
 } __attribute__((packed));
 
 static bool physMemInitialized = false;
+static bool physMemShrinking = false;
+static shrinker_callback shrinkerTable[MAX_SHRINKERS];
 static uint32_t physMemMap[(PAGE_COUNT + 31) / 32] __attribute__((aligned(4096)));
 static struct physMemExtraInfo *physMemExtra[PHYSMEMEXTRA_COUNT] __attribute__((aligned(4096)));
 
@@ -371,22 +373,22 @@ void physMemSetMemoryBits(uint32_t startIndex, uint32_t length, bool reserved)
 }
 
 /**
- * @brief Allocates a page of physical memory
+ * @brief Tries to allocate a page of physical memory
  * @details This command searches for an unused page in the physical memory bitmap
  *			and afterwards marks the specific page as reserved. If there is no
- *			physical memory left then the algorithm tries to page out some memory
- *			to the hard drive. If this fails then a system failure is triggered.
+ *			physical memory left then all registered shrinkers are asked to
+ *			release some cached memory before the search is repeated.
  *
  * @param lowmem If true then the search also includes the physical memory area below 1MB
- * @return Index of the physical page which was allocated
+ * @param index Pointer to a variable which receives the index of the allocated page
+ * @return True on success, false if the physical memory is exhausted
  */
-uint32_t physMemAllocPage(bool lowmem)
+bool physMemTryAllocPage(bool lowmem, uint32_t *index)
 {
-	uint32_t try, longIndex, longOffset;
+	uint32_t longIndex, longOffset;
 
-	for (try = 0; try < 0x10; try++)
+	for (;;)
 	{
-
 		for (longIndex = lowmem ? 0 : 8 /* 1MB */; longIndex < sizeof(physMemMap) / sizeof(physMemMap[0]); longIndex++)
 		{
 			if (physMemMap[longIndex] != 0xFFFFFFFF)
@@ -402,9 +404,34 @@ uint32_t physMemAllocPage(bool lowmem)
 
 			physMemMap[longIndex] |= (1 << longOffset);
 
-			return longIndex << 5 | longOffset;
+			*index = longIndex << 5 | longOffset;
+			return true;
 		}
 
+		/* ask the subsystems to release some cached memory */
+		if (!physMemShrink(1))
+			return false;
+	}
+}
+
+/**
+ * @brief Allocates a page of physical memory
+ * @details Similar to physMemTryAllocPage(), but if there is still no physical
+ *			memory left then the algorithm tries to page out some memory to the
+ *			hard drive. If this fails then a system failure is triggered.
+ *
+ * @param lowmem If true then the search also includes the physical memory area below 1MB
+ * @return Index of the physical page which was allocated
+ */
+uint32_t physMemAllocPage(bool lowmem)
+{
+	uint32_t try, index;
+
+	for (try = 0; try < 0x10; try++)
+	{
+		if (physMemTryAllocPage(lowmem, &index))
+			return index;
+
 		/* try to page out some other stuff */
 		physMemPageOut(1);
 	}
@@ -513,6 +540,89 @@ bool physMemIsLastRef(uint32_t index)
 	return (!info || !info->value || info->ref == 1);
 }
 
+/**
+ * @brief Registers a callback which is invoked under memory pressure
+ * @details Subsystems which keep reclaimable memory (like caches or buffers
+ *			which are larger than necessary) can register a shrinker. When the
+ *			physical memory is exhausted the shrinkers are called before the
+ *			allocation fails.
+ *
+ * @param callback The function which should be called
+ * @return True on success, false if there is no free slot left
+ */
+bool physMemRegisterShrinker(shrinker_callback callback)
+{
+	uint32_t i;
+	assert(callback);
+
+	for (i = 0; i < MAX_SHRINKERS; i++)
+	{
+		if (!shrinkerTable[i])
+		{
+			shrinkerTable[i] = callback;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Unregisters a previously registered shrinker
+ *
+ * @param callback The function passed to physMemRegisterShrinker()
+ */
+void physMemUnregisterShrinker(shrinker_callback callback)
+{
+	uint32_t i;
+
+	for (i = 0; i < MAX_SHRINKERS; i++)
+	{
+		if (shrinkerTable[i] == callback)
+			shrinkerTable[i] = NULL;
+	}
+}
+
+/**
+ * @brief Asks the registered shrinkers to release some memory
+ * @details Calls the shrinkers one after another until at least the requested
+ *			number of physical pages was released. Allocations done by a shrinker
+ *			itself will not trigger another round of shrinking.
+ *
+ * @param pages Number of pages which should be released
+ * @return Number of pages which were actually released
+ */
+uint32_t physMemShrink(uint32_t pages)
+{
+	uint32_t i, released = 0;
+
+	if (physMemShrinking)
+		return 0;
+
+	physMemShrinking = true;
+
+	for (i = 0; i < MAX_SHRINKERS && released < pages; i++)
+	{
+		if (shrinkerTable[i])
+			released += shrinkerTable[i](pages - released);
+	}
+
+	physMemShrinking = false;
+	return released;
+}
+
+/**
+ * @brief Checks if the shrinkers are currently running
+ * @details Caches should release memory directly instead of keeping it while
+ *			this function returns true.
+ *
+ * @return True if physMemShrink() is in progress, otherwise false
+ */
+bool physMemIsShrinking()
+{
+	return physMemShrinking;
+}
+
 /**
  * @brief Pages out some memory to the hard drive
  *
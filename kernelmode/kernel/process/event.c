@@ -27,6 +27,7 @@
 
 #include <process/event.h>
 #include <process/object.h>
+#include <process/pipe.h>
 #include <memory/allocator.h>
 #include <process/object.h>
 #include <util/list.h>
@@ -39,6 +40,12 @@
  *  They are comparable with epoll on Linux. You can attach other objects like
  *  pipes, semaphores or timers and wait will return as soon as one
  *  of the objects is signalled.
+ *
+ *  Attached objects stay registered in the wait queue of the object until they
+ *  complete, afterwards they are moved to the ready list of the event. Only
+ *  subevents which were returned to the user are armed again on the next
+ *  wait, so the cost of a wait doesn't depend on the number of attached objects.
+ *  Many ready objects can be fetched at once with eventGetReady().
  */
 
 static void __eventDestroy(struct object *obj);
@@ -94,19 +101,151 @@ struct event *eventCreate(bool wakeupAll)
 	struct event *e;
 
 	/* allocate some new memory */
-	if (!(e = heapAlloc(sizeof(*e))))
+	if (!(e = heapAlloc(sizeof(*e), HEAP_TAG_EVENT)))
 		return NULL;
 
 	/* initialize general object info */
 	__objectInit(&e->obj, &eventFunctions);
 	ll_init(&e->waiters);
+	ll_init(&e->readyWaiters);
 	ll_init(&e->subEvents);
 	e->status = 0;
+	ll_init(&e->ready);
+	ll_init(&e->rearm);
+	e->readyCount = 0;
 	e->wakeupAll = wakeupAll;
 
 	return e;
 }
 
+/* Removes a subevent from the list corresponding to its state and releases it */
+static void __subEventFree(struct subEvent *sub)
+{
+	if (sub->state == SUBEVENT_BLOCKED)
+		ll_remove(&sub->obj.entry);
+	else
+	{
+		if (sub->state == SUBEVENT_READY)
+			sub->event->readyCount--;
+		ll_remove(&sub->entry_ready);
+	}
+
+	ll_remove(&sub->entry_event);
+	__objectRelease(sub->wait);
+
+	sub->obj.functions = NULL;
+	heapFree(sub);
+}
+
+/* Adds a subevent to the ready list before pos, the subevent must not be linked */
+static inline void __subEventSetReady(struct event *e, struct subEvent *sub, struct linkedList *pos, uint32_t result)
+{
+	sub->state	= SUBEVENT_READY;
+	sub->result	= result;
+	ll_add_before(pos, &sub->entry_ready);
+	e->readyCount++;
+}
+
+/* Adds a subevent to the rearm list, the subevent must not be linked */
+static inline void __subEventSetRearm(struct event *e, struct subEvent *sub)
+{
+	sub->state		= SUBEVENT_REARM;
+	sub->suppress	= sub->edgeTriggered;
+	ll_add_tail(&e->rearm, &sub->entry_ready);
+}
+
+/* Removes the first subevent from the ready list after it was returned to the user */
+static struct subEvent *__eventTakeReady(struct event *e)
+{
+	struct subEvent *sub;
+	assert(!ll_empty(&e->ready));
+
+	sub = LL_ENTRY(e->ready.next, struct subEvent, entry_ready);
+	ll_remove(&sub->entry_ready);
+	e->readyCount--;
+
+	__subEventSetRearm(e, sub);
+	return sub;
+}
+
+/*
+ * Tries to arm a subevent from the rearm list, returns false if the wait
+ * operation of the object completed immediately. In this case the subevent
+ * stays in the rearm list.
+ */
+static bool __subEventArm(struct subEvent *sub, uint32_t *result)
+{
+	struct linkedList *queue;
+	assert(sub->state == SUBEVENT_REARM);
+
+	*result = 0;
+	queue = __objectWait(sub->wait, sub->waitMode, result);
+	if (!queue) return false;
+
+	ll_remove(&sub->entry_ready);
+	sub->state = SUBEVENT_BLOCKED;
+	ll_add_after(queue, &sub->obj.entry);
+	return true;
+}
+
+/*
+ * Arms all subevents in the rearm list again. Completed ones are inserted at the
+ * front of the ready list, so an object which stays ready is returned again
+ * before objects which became ready later (in the order they were returned).
+ */
+static void __eventRearm(struct event *e)
+{
+	struct subEvent *sub, *__sub;
+	struct linkedList *pos = e->ready.next;
+	uint32_t result;
+
+	LL_FOR_EACH_SAFE(sub, __sub, &e->rearm, struct subEvent, entry_ready)
+	{
+		if (__subEventArm(sub, &result)) continue;
+
+		/* edge triggered subevents stay in the rearm list until the object blocks */
+		if (sub->suppress)
+		{
+			sub->result = result;
+			continue;
+		}
+
+		ll_remove(&sub->entry_ready);
+		__subEventSetReady(e, sub, pos, result);
+	}
+
+	/*
+	 * Only suppressed subevents are left. If nothing else is ready they are
+	 * reported anyway, otherwise an edge between the last read of the user
+	 * and this wait could be lost.
+	 */
+	if (!ll_empty(&e->ready)) return;
+	LL_FOR_EACH_SAFE(sub, __sub, &e->rearm, struct subEvent, entry_ready)
+	{
+		ll_remove(&sub->entry_ready);
+		__subEventSetReady(e, sub, &e->ready, sub->result);
+	}
+}
+
+/*
+ * Handles a completed subevent, the result is passed directly to a thread
+ * waiting for an identifier if possible. Otherwise the subevent is added
+ * to the ready list. The subevent must not be linked.
+ */
+static void __subEventCompleted(struct event *e, struct subEvent *sub, uint32_t result)
+{
+	if (!ll_empty(&e->waiters))
+	{
+		__subEventSetRearm(e, sub);
+		e->status = result;
+		queueWakeup(&e->waiters, e->wakeupAll, sub->identifier);
+		return;
+	}
+
+	__subEventSetReady(e, sub, &e->ready, result);
+	queueWakeup(&e->readyWaiters, e->wakeupAll, e->readyCount);
+}
+
 /**
  * @brief Destructor for kernel event objects
  *
@@ -119,18 +258,15 @@ static void __eventDestroy(struct object *obj)
 
 	/* release other threads if the user destroys the object before they return */
 	queueWakeup(&e->waiters, true, -1);
+	queueWakeup(&e->readyWaiters, true, -1);
 	assert(ll_empty(&e->waiters));
+	assert(ll_empty(&e->readyWaiters));
 
 	LL_FOR_EACH_SAFE(sub, __sub, &e->subEvents, struct subEvent, entry_event)
 	{
-		if (sub->blocked)
-			ll_remove(&sub->obj.entry);
-		ll_remove(&sub->entry_event); /* not really necessary, as the memory is deallocated afterwards */
-		__objectRelease(sub->wait);
-
-		sub->obj.functions = NULL;
-		heapFree(sub);
+		__subEventFree(sub);
 	}
+	assert(!e->readyCount);
 
 	/* release event memory */
 	e->obj.functions = NULL;
@@ -150,6 +286,7 @@ static void __eventShutdown(struct object *obj, UNUSED uint32_t mode)
 {
 	struct event *e = objectContainer(obj, struct event, &eventFunctions);
 	queueWakeup(&e->waiters, true, -1);
+	queueWakeup(&e->readyWaiters, true, -1);
 }
 
 /**
@@ -172,43 +309,39 @@ static int32_t __eventGetStatus(struct object *obj, UNUSED uint32_t mode)
 
 /**
  * @brief Wait for the kernel event
- * @details Starts waiting for a kernel event. If one of the associated sub objects
- *			is already triggered or doesn't support the wait operation, then the
+ * @details Starts waiting for a kernel event. Subevents returned by a previous
+ *			wait are armed again first. If one of the associated sub objects is
+ *			already triggered or doesn't support the wait operation, then the
  *			control is returned back immediately with the corresponding result value.
  *			Otherwise the waiter linkedlist is returned, such that the thread can add
  *			itself to it.
  *
  * @param obj Pointer to the kernel event object
- * @param mode not used
+ * @param mode #EVENT_WAIT_IDENTIFIER to return the identifier of one ready object,
+ *			   #EVENT_WAIT_READY to return the number of ready objects without removing them
  * @param result Will be filled out with the result code if the operation doesn't block
  * @return NULL if the operation returns immediately, otherwise a pointer to a wait queue linked list
  */
-static struct linkedList *__eventWait(struct object *obj, UNUSED uint32_t mode, uint32_t *result)
+static struct linkedList *__eventWait(struct object *obj, uint32_t mode, uint32_t *result)
 {
 	struct event *e = objectContainer(obj, struct event, &eventFunctions);
 	struct subEvent *sub;
-	struct linkedList *queue;
 
-	LL_FOR_EACH(sub, &e->subEvents, struct subEvent, entry_event)
-	{
-		if (sub->blocked) continue;
-		assert(sub->event == e);
+	__eventRearm(e);
 
-		e->status = 0;
-		queue = __objectWait(sub->wait, sub->waitMode, &e->status);
-		if (queue)
-		{
-			sub->blocked = true;
-			ll_add_after(queue, &sub->obj.entry);
-		}
-		else
-		{
-			*result = sub->identifier;
-			return NULL;
-		}
+	if (mode == EVENT_WAIT_READY)
+	{
+		if (!e->readyCount) return &e->readyWaiters;
+		*result = e->readyCount;
+		return NULL;
 	}
 
-	return &e->waiters;
+	if (ll_empty(&e->ready)) return &e->waiters;
+
+	sub = __eventTakeReady(e);
+	e->status = sub->result;
+	*result = sub->identifier;
+	return NULL;
 }
 
 /**
@@ -222,6 +355,7 @@ static void __eventSignal(struct object *obj, uint32_t result)
 	struct event *e = objectContainer(obj, struct event, &eventFunctions);
 	e->status = 0;
 	queueWakeup(&e->waiters, e->wakeupAll, result);
+	queueWakeup(&e->readyWaiters, e->wakeupAll, result);
 }
 
 /**
@@ -231,9 +365,18 @@ static void __eventSignal(struct object *obj, uint32_t result)
  *			and use them for the wait operation. Whenever the wait operation returns
  *			the result will be the corresponding identifier.
  *
+ *			By default subevents are level triggered: they are reported again as
+ *			long as the wait operation of the subobject completes immediately. If
+ *			#EVENT_ATTACH_EDGE is set in mode, a subevent is not reported again
+ *			while the subobject stays ready, unless no other subobject is ready
+ *			(this avoids lost wakeups when new data arrives before the next wait).
+ *			Edge triggered mode is only supported for pipes, where waiting has no
+ *			side effects. Rearming other objects like semaphores or timers would
+ *			consume completions which are never reported.
+ *
  * @param obj Pointer to the kernel event object
  * @param subObj Pointer to some other kernel object (called subobject)
- * @param mode Mode for the wait operation of the subobject
+ * @param mode Mode for the wait operation of the subobject, optionally combined with #EVENT_ATTACH_EDGE
  * @param ident Identifier which will be returned if this object is triggered
  * @return Returns true if the subobject was assigned successfully, otherwise false
  */
@@ -241,18 +384,34 @@ static bool __eventAttachObj(struct object *obj, struct object *subObj, uint32_t
 {
 	struct subEvent *sub;
 	struct event *e = objectContainer(obj, struct event, &eventFunctions);
+	uint32_t result;
 
-	if (!(sub = heapAlloc(sizeof(*sub))))
+	if ((mode & EVENT_ATTACH_EDGE) && !pipeIsValid(subObj))
+		return false;
+
+	if (!(sub = heapAlloc(sizeof(*sub), HEAP_TAG_EVENT)))
 		return false;
 
 	/* initialize general object info */
 	__objectInit(&sub->obj, &subEventFunctions);
-	sub->blocked	= false;
 	sub->event		= e;
 	ll_add_tail(&e->subEvents, &sub->entry_event);
 	sub->wait		= __objectAddRef(subObj);
-	sub->waitMode	= mode;
+	sub->waitMode	= mode & ~EVENT_ATTACH_EDGE;
 	sub->identifier	= ident;
+	sub->result		= 0;
+	sub->edgeTriggered = (mode & EVENT_ATTACH_EDGE) != 0;
+
+	/* arm it immediately, threads might already wait on the event */
+	sub->state		= SUBEVENT_REARM;
+	sub->suppress	= false;
+	ll_add_tail(&e->rearm, &sub->entry_ready);
+
+	if (!__subEventArm(sub, &result))
+	{
+		ll_remove(&sub->entry_ready);
+		__subEventCompleted(e, sub, result);
+	}
 
 	return true;
 }
@@ -275,14 +434,7 @@ static bool __eventDetachObj(struct object *obj, uint32_t ident)
 	{
 		if (sub->identifier == ident)
 		{
-			if (sub->blocked)
-				ll_remove(&sub->obj.entry);
-			ll_remove(&sub->entry_event);
-			__objectRelease(sub->wait);
-
-			sub->obj.functions = NULL;
-			heapFree(sub);
-
+			__subEventFree(sub);
 			success = true;
 		}
 	}
@@ -299,15 +451,52 @@ static bool __eventDetachObj(struct object *obj, uint32_t ident)
 static void __subEventSignal(struct object *obj, uint32_t result)
 {
 	struct subEvent *s = objectContainer(obj, struct subEvent, &subEventFunctions);
-	struct event *e = s->event;
-	if (!s->blocked) return;
+	if (s->state != SUBEVENT_BLOCKED) return;
 
-	s->blocked = false;
 	ll_remove(&s->obj.entry);
 
 	/* wakeup objects waiting for the main event */
-	e->status = result;
-	queueWakeup(&e->waiters, e->wakeupAll, s->identifier);
+	__subEventCompleted(s->event, s, result);
+}
+
+/**
+ * @brief Checks if a kernel object is an event
+ *
+ * @param obj Pointer to a kernel object
+ * @return Pointer to the kernel event object or NULL
+ */
+struct event *eventIsValid(struct object *obj)
+{
+	if (!obj || obj->functions != &eventFunctions) return NULL;
+	return objectContainer(obj, struct event, &eventFunctions);
+}
+
+/**
+ * @brief Fetches multiple ready subevents at once
+ * @details Subevents returned by a previous call are armed again first, then up
+ *			to count entries are removed from the ready list. This function never
+ *			blocks, use a wait with #EVENT_WAIT_READY to sleep until an entry is ready.
+ *
+ * @param e Pointer to the kernel event object
+ * @param buf Buffer which receives the identifiers and results
+ * @param count Maximum number of entries
+ * @return Number of entries written to buf
+ */
+uint32_t eventGetReady(struct event *e, struct eventReady *buf, uint32_t count)
+{
+	struct subEvent *sub;
+	uint32_t i;
+
+	__eventRearm(e);
+
+	for (i = 0; i < count && !ll_empty(&e->ready); i++)
+	{
+		sub = __eventTakeReady(e);
+		buf[i].identifier	= sub->identifier;
+		buf[i].result		= sub->result;
+	}
+
+	return i;
 }
 
 /**
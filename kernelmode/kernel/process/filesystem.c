@@ -31,6 +31,7 @@
 #include <console/console.h>
 #include <util/list.h>
 #include <util/util.h>
+#include <syscall.h>
 
 /** \addtogroup Filesystem
  *  @{
@@ -177,13 +178,13 @@ struct directory *directoryCreate(struct directory *parent, char *name, uint32_t
 	char *buffer = NULL;
 
 	/* allocate some new memory */
-	if (!(d = heapAlloc(sizeof(*d))))
+	if (!(d = heapAlloc(sizeof(*d), HEAP_TAG_FILESYSTEM)))
 		return NULL;
 
 	/* copy the name */
 	if (name)
 	{
-		if (!(buffer = heapAlloc(nameLength + 1)))
+		if (!(buffer = heapAlloc(nameLength + 1, HEAP_TAG_FILESYSTEM)))
 		{
 			heapFree(d);
 			return NULL;
@@ -285,7 +286,7 @@ static int32_t __directoryWrite(struct object *obj, uint8_t *buf, uint32_t lengt
 	}
 
 	/* allocate new memory for the name */
-	d->name = heapAlloc(length + 1);
+	d->name = heapAlloc(length + 1, HEAP_TAG_FILESYSTEM);
 	if (!d->name) return 0;
 
 	memcpy(d->name, buf, length);
@@ -336,13 +337,13 @@ struct file *fileCreate(struct directory *parent, char *name, uint32_t nameLengt
 	char *buffer = NULL;
 
 	/* allocate some new memory */
-	if (!(f = heapAlloc(sizeof(*f))))
+	if (!(f = heapAlloc(sizeof(*f), HEAP_TAG_FILESYSTEM)))
 		return NULL;
 
 	/* copy the name */
 	if (name)
 	{
-		if (!(buffer = heapAlloc(nameLength + 1)))
+		if (!(buffer = heapAlloc(nameLength + 1, HEAP_TAG_FILESYSTEM)))
 		{
 			heapFree(f);
 			return NULL;
@@ -469,7 +470,7 @@ static int32_t __fileWrite(struct object *obj, uint8_t *buf, uint32_t length)
 	}
 
 	/* allocate new memory for the name */
-	f->name = heapAlloc(length + 1);
+	f->name = heapAlloc(length + 1, HEAP_TAG_FILESYSTEM);
 	if (!f->name) return 0;
 
 	memcpy(f->name, buf, length);
@@ -516,7 +517,7 @@ struct openedFile *fileOpen(struct file *file)
 	assert(file);
 
 	/* allocate some new memory */
-	if (!(h = heapAlloc(sizeof(*h))))
+	if (!(h = heapAlloc(sizeof(*h), HEAP_TAG_FILESYSTEM)))
 		return NULL;
 
 	/* initialize general object info */
@@ -618,18 +619,59 @@ static void __openedFileSignal(struct object *obj, uint32_t result)
 static int32_t __openedFileWrite(struct object *obj, uint8_t *buf, uint32_t length)
 {
 	struct openedFile *h = objectContainer(obj, struct openedFile, &openedFileFunctions);
+	int32_t res = openedFileWriteAt(h, buf, length, h->pos);
+	if (res > 0) h->pos += res;
+	return res;
+}
+
+/**
+ * @brief Reads data from a kernel openedFile object into a buffer
+ * @details This function reads a block of data from a kernel openedFile object.
+ *
+ * @param obj Pointer to the kernel openedFile object
+ * @param buf Pointer to the buffer
+ * @param length Number of bytes to read from the file
+ * @return Number of bytes read
+ */
+static int32_t __openedFileRead(struct object *obj, uint8_t *buf, uint32_t length)
+{
+	struct openedFile *h = objectContainer(obj, struct openedFile, &openedFileFunctions);
+	int32_t res = openedFileReadAt(h, buf, length, h->pos);
+	if (res > 0) h->pos += res;
+	return res;
+}
+
+/**
+ * @brief Writes some data at a specific position into a kernel openedFile object
+ * @details Works like a regular write, but doesn't use or update the position of
+ *			the openedFile object. If offset is IO_OFFSET_APPEND the data is appended
+ *			at the end of the file.
+ *
+ * @param h Pointer to the kernel openedFile object
+ * @param buf Pointer to the buffer
+ * @param length Number of bytes to write into the file
+ * @param offset Position in the file
+ * @return Number of bytes written or (-1) if the offset is invalid
+ */
+int32_t openedFileWriteAt(struct openedFile *h, uint8_t *buf, uint32_t length, uint32_t offset)
+{
 	struct file *f = h->file;
+
+	if (offset == IO_OFFSET_APPEND)
+		offset = f->size;
+
 	if (length == 0) return 0;
+	if (offset + length < offset) return -1;
 
 	/* reallocate file memory */
-	if (h->pos + length > f->size)
+	if (offset + length > f->size)
 	{
 		uint8_t *new_buffer;
 
 		if (!f->isHeap || !f->buffer)
-			new_buffer = heapAlloc(h->pos + length);
+			new_buffer = heapAlloc(offset + length, HEAP_TAG_FILE_BUFFER);
 		else
-			new_buffer = heapReAlloc(f->buffer, h->pos + length);
+			new_buffer = heapReAlloc(f->buffer, offset + length);
 
 		if (new_buffer)
 		{
@@ -638,57 +680,84 @@ static int32_t __openedFileWrite(struct object *obj, uint8_t *buf, uint32_t leng
 				memcpy(new_buffer, f->buffer, f->size);
 
 			/* clear unused buffer space */
-			if (h->pos > f->size)
-				memset(new_buffer + f->size, 0, h->pos - f->size);
+			if (offset > f->size)
+				memset(new_buffer + f->size, 0, offset - f->size);
 
 			f->isHeap	= true;
 			f->buffer	= new_buffer;
-			f->size		= h->pos + length;
+			f->size		= offset + length;
 		}
-		else if (f->isHeap && h->pos < f->size)
+		else if (f->isHeap && offset < f->size)
 		{
-			assert(f->size - h->pos < length);
-			length = f->size - h->pos;
+			assert(f->size - offset < length);
+			length = f->size - offset;
 		}
 		else return 0; /* no bytes left */
 	}
 
 	/* copy bytes to the buffer */
-	memcpy(f->buffer + h->pos, buf, length);
-	h->pos += length;
-
+	memcpy(f->buffer + offset, buf, length);
 	return length;
 }
 
 /**
- * @brief Reads data from a kernel openedFile object into a buffer
- * @details This function reads a block of data from a kernel openedFile object.
+ * @brief Reads data at a specific position from a kernel openedFile object
+ * @details Works like a regular read, but doesn't use or update the position of
+ *			the openedFile object.
  *
- * @param obj Pointer to the kernel openedFile object
+ * @param h Pointer to the kernel openedFile object
  * @param buf Pointer to the buffer
  * @param length Number of bytes to read from the file
- * @return Number of bytes read
+ * @param offset Position in the file
+ * @return Number of bytes read or (-1) if offset is at or behind the end of the file
  */
-static int32_t __openedFileRead(struct object *obj, uint8_t *buf, uint32_t length)
+int32_t openedFileReadAt(struct openedFile *h, uint8_t *buf, uint32_t length, uint32_t offset)
 {
-	struct openedFile *h = objectContainer(obj, struct openedFile, &openedFileFunctions);
 	struct file *f = h->file;
-	if (h->pos >= f->size) return -1;
+	if (offset >= f->size) return -1;
 
 	/* don't read beyond the end of the file */
-	if (length > f->size - h->pos)
-		length = f->size - h->pos;
+	if (length > f->size - offset)
+		length = f->size - offset;
 
 	/* copy bytes to the output */
 	if (length > 0)
-	{
-		memcpy(buf, f->buffer + h->pos, length);
-		h->pos += length;
-	}
+		memcpy(buf, f->buffer + offset, length);
 
 	return length;
 }
 
+/**
+ * @brief Writes data of a kernel openedFile object into another object
+ * @details The data is written directly from the file buffer, starting at the
+ *			current position, which is advanced by the number of bytes written.
+ *
+ * @param h Pointer to the kernel openedFile object
+ * @param dst Pointer to the destination kernel object
+ * @param length Maximum number of bytes to transfer
+ * @return Number of bytes transferred or (-1) if the position is at or behind
+ *		   the end of the file or the destination is not writeable
+ */
+int32_t openedFileSplice(struct openedFile *h, struct object *dst, uint32_t length)
+{
+	struct openedFile *dst_h = fileSystemIsValidOpenedFile(dst);
+	struct file *f = h->file;
+	int32_t res;
+
+	/* writing could reallocate the buffer we are reading from */
+	if (dst_h && dst_h->file == f) return -1;
+	if (h->pos >= f->size) return -1;
+
+	/* don't read beyond the end of the file */
+	if (length > f->size - h->pos)
+		length = f->size - h->pos;
+
+	res = __objectWrite(dst, f->buffer + h->pos, length);
+	if (res > 0) h->pos += res;
+
+	return res;
+}
+
 /**
  * @brief Creates a new kernel openedDirectory object
  *
@@ -702,7 +771,7 @@ struct openedDirectory *directoryOpen(struct directory *directory)
 	assert(directory);
 
 	/* allocate some new memory */
-	if (!(h = heapAlloc(sizeof(*h))))
+	if (!(h = heapAlloc(sizeof(*h), HEAP_TAG_FILESYSTEM)))
 		return NULL;
 
 	/* initialize general object info */
@@ -974,6 +1043,21 @@ struct file *fileSystemIsValidFile(struct object *obj)
 	return NULL;
 }
 
+/**
+ * @brief Checks if a given object is of the type openedFile and casts it if possible
+ * @details Use this function to safely convert an arbitrary object to an openedFile
+ *			object pointer. If the object doesn't have the right type (or a NULL pointer
+ *			is passed), then NULL will be returned.
+ *
+ * @param obj Arbitrary kernel object
+ * @return Pointer to a kernel openedFile object or NULL
+ */
+struct openedFile *fileSystemIsValidOpenedFile(struct object *obj)
+{
+	if (!obj || obj->functions != &openedFileFunctions) return NULL;
+	return objectContainer(obj, struct openedFile, &openedFileFunctions);
+}
+
 /**
  * @brief Returns a reference to the root node of the file system
  * @details This function returns a reference to the root node of the file system
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <process/futex.h>
+#include <process/thread.h>
+#include <process/process.h>
+#include <process/object.h>
+#include <interrupt/interrupt.h>
+#include <memory/paging.h>
+#include <util/list.h>
+#include <util/util.h>
+
+/** \addtogroup Futex
+ *  @{
+ *	Implementation of wait-on-address / wake-address operations
+ *
+ *	A futex is just an aligned 32-bit value in the address space of a usermode
+ *	process. Userland performs the uncontended lock and unlock operations with
+ *	atomic instructions and only enters the kernel when a thread has to sleep
+ *	or when sleeping threads have to be woken up. The kernel doesn't allocate
+ *	any objects for this purpose, instead the waiting threads are linked into
+ *	a small hash table of wait queues, keyed by the process (which defines the
+ *	address space) and the user address.
+ */
+
+static struct linkedList futexQueues[FUTEX_HASH_SIZE];
+
+/**
+ * @brief Returns the wait queue for a specific futex
+ *
+ * @param p Pointer to the kernel process object
+ * @param addr User address of the futex
+ * @return Pointer to the wait queue linked list
+ */
+static inline struct linkedList *__futexGetQueue(struct process *p, uint32_t *addr)
+{
+	uint32_t hash = ((uint32_t)p >> 4) ^ ((uint32_t)addr >> 2);
+	hash *= 0x9E3779B1;
+	return &futexQueues[hash >> (32 - FUTEX_HASH_BITS)];
+}
+
+/**
+ * @brief Initializes the futex wait queues
+ */
+void futexInit()
+{
+	uint32_t i;
+	for (i = 0; i < FUTEX_HASH_SIZE; i++)
+		ll_init(&futexQueues[i]);
+}
+
+/**
+ * @brief Puts a thread to sleep if a futex still contains the expected value
+ * @details This function reads the 32-bit value at the given user address and
+ *			compares it with the expected value. If both are equal the thread is
+ *			removed from the list of runnable threads and appended to the wait queue
+ *			of the futex, otherwise the function returns immediately and usermode
+ *			has to retry its atomic operation. As the kernel is not interrupted while
+ *			handling a syscall the check and the blocking happen atomically, which
+ *			means a wake operation by another thread can never be lost.
+ *
+ *			The result of the operation is stored in the eax register of the thread:
+ *			0 after being woken up, 1 if the value didn't match, and (-1) if the address
+ *			is not valid or the thread was interrupted by destroying its wait queue.
+ *
+ * @param t Pointer to the kernel thread object
+ * @param addr User address of the futex (has to be 4-byte aligned)
+ * @param expected Value the futex has to contain in order to sleep
+ * @return #INTERRUPT_CONTINUE_EXECUTION if the operation was non-blocking, otherwise #INTERRUPT_YIELD
+ */
+uint32_t futexWait(struct thread *t, uint32_t *addr, uint32_t expected)
+{
+	struct process *p = t->process;
+	struct userMemory k;
+	uint32_t value;
+
+	t->task.eax = -1;
+	if ((uint32_t)addr & 3) return INTERRUPT_CONTINUE_EXECUTION;
+
+	if (!ACCESS_USER_MEMORY(&k, p, addr, sizeof(uint32_t), false))
+		return INTERRUPT_CONTINUE_EXECUTION;
+	value = *(uint32_t *)k.addr;
+	RELEASE_USER_MEMORY(&k);
+
+	/* value has changed in the meantime */
+	if (value != expected)
+	{
+		t->task.eax = 1;
+		return INTERRUPT_CONTINUE_EXECUTION;
+	}
+
+	/* link the thread into the wait queue, __threadSignal will unlink it again */
+	assert(!t->blocked);
+	t->blocked			= true;
+	t->user_futexAddr	= addr;
+	t->task.eax			= 0;
+	ll_remove(&t->obj.entry);
+	ll_add_tail(__futexGetQueue(p, addr), &t->obj.entry);
+	return INTERRUPT_YIELD;
+}
+
+/**
+ * @brief Wakes up threads sleeping on a futex
+ * @details This function wakes up at most count threads of the given process, which
+ *			are currently sleeping on the specified user address. The threads are woken
+ *			up in the same order in which they started waiting. Threads which terminate
+ *			while waiting don't have to be handled here, since shutting down a thread
+ *			unlinks it from any wait queue.
+ *
+ * @param p Pointer to the kernel process object
+ * @param addr User address of the futex
+ * @param count Maximum number of threads to wake up
+ * @return Number of threads which were woken up
+ */
+uint32_t futexWake(struct process *p, uint32_t *addr, uint32_t count)
+{
+	struct linkedList *queue = __futexGetQueue(p, addr);
+	struct thread *t, *__t;
+	uint32_t woken = 0;
+
+	LL_FOR_EACH_SAFE(t, __t, queue, struct thread, obj.entry)
+	{
+		if (woken >= count) break;
+		if (t->process != p || t->user_futexAddr != addr) continue;
+
+		t->user_futexAddr = NULL;
+		objectSignal(t, 0);
+		woken++;
+	}
+
+	return woken;
+}
+
+/**
+ * @}
+ */
@@ -44,16 +44,18 @@
  *			allocated table is empty.
  *
  * @param table Pointer to the handle table
+ * @return True on success, false if the table couldn't be allocated
  */
-void handleTableInit(struct handleTable *table)
+bool handleTableInit(struct handleTable *table)
 {
 	table->count		= MIN_HANDLES;
 	table->free_begin	= 0; /* first free element */
 	table->free_end		= 0; /* last used element + 1 */
-	table->handles		= heapAlloc(table->count * sizeof(struct object *));
+	table->handles		= heapAlloc(table->count * sizeof(struct object *), HEAP_TAG_HANDLES);
+	if (!table->handles) return false;
 
-	assert(table->handles);
 	memset(table->handles, 0, table->count * sizeof(struct object *));
+	return true;
 }
 
 /**
@@ -64,8 +66,9 @@ void handleTableInit(struct handleTable *table)
  *
  * @param destination Pointer to the destination handle table (which will be initialized)
  * @param source Pointer to the source handle table
+ * @return True on success, false if the table couldn't be allocated
  */
-void handleForkTable(struct handleTable *destination, struct handleTable *source)
+bool handleForkTable(struct handleTable *destination, struct handleTable *source)
 {
 	uint32_t i;
 	uint32_t count = MIN_HANDLES;
@@ -77,13 +80,15 @@ void handleForkTable(struct handleTable *destination, struct handleTable *source
 	destination->count			= count;
 	destination->free_begin		= source->free_begin;
 	destination->free_end		= source->free_end;
-	destination->handles		= heapAlloc(count * sizeof(struct object *));
+	destination->handles		= heapAlloc(count * sizeof(struct object *), HEAP_TAG_HANDLES);
+	if (!destination->handles) return false;
 
-	assert(destination->handles);
 	memset(destination->handles, 0, destination->count * sizeof(struct object *));
 
 	for (i = 0; i < source->free_end; i++)
 		destination->handles[i] = source->handles[i] ? __objectAddRef(source->handles[i]) : NULL;
+
+	return true;
 }
 
 /**
@@ -112,10 +117,11 @@ void handleTableFree(struct handleTable *table)
  * @param table Pointer to the handle table
  * @param object Pointer to some kernel object
  *
- * @return Handle which is valid inside of the process associated to the table
+ * @return Handle which is valid inside of the process associated to the table, or -1 on failure
  */
 uint32_t handleAllocate(struct handleTable *table, struct object *object)
 {
+	struct object **handles;
 	uint32_t i;
 	assert(object);
 
@@ -142,11 +148,12 @@ uint32_t handleAllocate(struct handleTable *table, struct object *object)
 		/* unable to allocate further handles */
 		if (table->count >= count) return -1;
 
-		table->handles = heapReAlloc(table->handles, count * sizeof(struct object *));
+		if (!(handles = heapReAlloc(table->handles, count * sizeof(struct object *))))
+			return -1;
+
+		table->handles = handles;
 		memset(table->handles + table->count, 0, (count - table->count) * sizeof(struct object *));
 		table->count   = count;
-
-		assert(table->handles);
 	}
 
 	table->free_begin = i + 1;
@@ -163,11 +170,11 @@ uint32_t handleAllocate(struct handleTable *table, struct object *object)
  * @param table Pointer to the handle table
  * @param handle Handle which will be replaced
  * @param object Pointer to some kernel object
- * @return True on success, otherwise false (handle out of range)
+ * @return True on success, otherwise false (handle out of range or out of memory)
  */
 bool handleSet(struct handleTable *table, uint32_t handle, struct object *object)
 {
-	struct object *old_object;
+	struct object **handles, *old_object;
 	assert(object);
 
 	if (handle >= MAX_HANDLES) return false;
@@ -179,11 +186,12 @@ bool handleSet(struct handleTable *table, uint32_t handle, struct object *object
 		if (count > MAX_HANDLES) count = MAX_HANDLES;
 		assert(count > table->count);
 
-		table->handles = heapReAlloc(table->handles, count * sizeof(struct object *));
+		if (!(handles = heapReAlloc(table->handles, count * sizeof(struct object *))))
+			return false;
+
+		table->handles = handles;
 		memset(table->handles + table->count, 0, (count - table->count) * sizeof(struct object *));
 		table->count   = count;
-
-		assert(table->handles);
 	}
 
 	/* replace object */
@@ -226,7 +234,7 @@ struct object *handleGet(struct handleTable *table, uint32_t handle)
  */
 bool handleRelease(struct handleTable *table, uint32_t handle)
 {
-	struct object *object;
+	struct object **handles, *object;
 
 	if (handle >= table->free_end) return false;
 	if (!(object = table->handles[handle])) return false;
@@ -248,10 +256,12 @@ bool handleRelease(struct handleTable *table, uint32_t handle)
 			uint32_t count = table->count / 4;
 			if (count < MIN_HANDLES) count = MIN_HANDLES;
 
-			table->handles = heapReAlloc(table->handles, count * sizeof(struct object *));
-			table->count   = count;
-
-			assert(table->handles);
+			/* keep the old table if we are out of memory */
+			if ((handles = heapReAlloc(table->handles, count * sizeof(struct object *))))
+			{
+				table->handles = handles;
+				table->count   = count;
+			}
 		}
 	}
 
@@ -0,0 +1,549 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <process/ioring.h>
+#include <process/object.h>
+#include <process/process.h>
+#include <process/handle.h>
+#include <memory/allocator.h>
+#include <memory/paging.h>
+#include <util/list.h>
+#include <util/util.h>
+
+/** \addtogroup IORing
+ *  @{
+ *	IO rings allow usermode to queue many read, write, wait and signal operations
+ *	without a syscall for each of them. The ring memory is shared between the
+ *	kernel and the process: usermode appends submissions to the submission queue
+ *	and calls ioRingEnter(), the results are appended to the completion queue.
+ *	Waiting on the ring object blocks until a completion is available.
+ *
+ *	Operations which would block are queued on the wait queue of their object,
+ *	so a single thread can drive many pipes at once. Wait operations complete as
+ *	soon as the object is signalled. Read and write operations are moved to a
+ *	retry list instead and executed again with the next ioRingEnter() or wait
+ *	on the ring, this avoids nesting them into the wakeup of another object.
+ */
+
+static void __ioRingDestroy(struct object *obj);
+static void __ioRingShutdown(struct object *obj, UNUSED uint32_t mode);
+static int32_t __ioRingGetStatus(struct object *obj, UNUSED uint32_t mode);
+static struct linkedList *__ioRingWait(struct object *obj, UNUSED uint32_t mode, uint32_t *result);
+static void __ioRingSignal(struct object *obj, uint32_t result);
+
+static const struct objectFunctions ioRingFunctions =
+{
+	__ioRingDestroy,
+	NULL, /* getMinHandle */
+	__ioRingShutdown,
+	__ioRingGetStatus,
+	__ioRingWait,
+	__ioRingSignal,
+	NULL, /* write */
+	NULL, /* read */
+	NULL, /* insert */
+	NULL, /* remove */
+};
+
+static void __ioRequestSignal(struct object *obj, uint32_t result);
+
+static const struct objectFunctions ioRequestFunctions =
+{
+	NULL, /* destroy */
+	NULL, /* getMinHandle */
+	NULL, /* shutdown */
+	NULL, /* getStatus */
+	NULL, /* wait */
+	__ioRequestSignal,
+	NULL, /* write */
+	NULL, /* read */
+	NULL, /* insert */
+	NULL, /* remove */
+};
+
+/**
+ * @brief Creates a new kernel IO ring object
+ * @details Allocates the shared ring memory and maps it into the address space
+ *			of the process. The mapping is not inherited by forked processes, since
+ *			the kernel has to see the same memory as the process.
+ *
+ * @param p Pointer to the kernel process object which owns the ring
+ * @param entries Number of submission entries, rounded up to a power of two
+ * @return Pointer to the new kernel IO ring object or NULL on failure
+ */
+struct ioRing *ioRingCreate(struct process *p, uint32_t entries)
+{
+	uint32_t sqEntries = 1, cqEntries, sqOffset, cqOffset;
+	struct ioRing *r;
+
+	if (!entries || entries > IORING_MAX_ENTRIES)
+		return NULL;
+
+	while (sqEntries < entries) sqEntries <<= 1;
+	cqEntries = sqEntries * 2;
+	sqOffset = sizeof(struct ioRingHeader);
+	cqOffset = sqOffset + sqEntries * sizeof(struct ioRingSubmission);
+
+	/* allocate some new memory */
+	if (!(r = heapAlloc(sizeof(*r), HEAP_TAG_IORING)))
+		return NULL;
+
+	/* allocate the shared memory and map it into the process */
+	r->length = (cqOffset + cqEntries * sizeof(struct ioRingCompletion) + PAGE_MASK) >> PAGE_BITS;
+	if (!(r->header = pagingTryAllocatePhysMemUnpageable(NULL, r->length, true, false)))
+	{
+		heapFree(r);
+		return NULL;
+	}
+
+	if (!(r->user_base = pagingTrySearchArea(p, r->length)) ||
+		!pagingMapRemoteMemory(p, NULL, r->user_base, r->header, r->length, true, true))
+	{
+		pagingReleasePhysMem(NULL, r->header, r->length);
+		heapFree(r);
+		return NULL;
+	}
+	pagingMarkNoFork(p, r->user_base, r->length);
+
+	/* initialize general object info */
+	__objectInit(&r->obj, &ioRingFunctions);
+	ll_init(&r->waiters);
+	r->process = p;
+	ll_add_tail(&p->ioRings, &r->entry_process);
+	objectAddRef(p);
+
+	memset(r->header, 0, r->length << PAGE_BITS);
+	r->header->sqEntries	= sqEntries;
+	r->header->cqEntries	= cqEntries;
+	r->header->sqOffset		= sqOffset;
+	r->header->cqOffset		= cqOffset;
+	r->sq			= (struct ioRingSubmission *)((uint8_t *)r->header + sqOffset);
+	r->cq			= (struct ioRingCompletion *)((uint8_t *)r->header + cqOffset);
+
+	r->sqHead	= 0;
+	r->cqTail	= 0;
+	r->sqMask	= sqEntries - 1;
+	r->cqMask	= cqEntries - 1;
+
+	ll_init(&r->requests);
+	ll_init(&r->retry);
+	r->inflight = 0;
+
+	return r;
+}
+
+/* Returns the number of completions which were not consumed by the user yet */
+static inline uint32_t __ioRingCompletions(struct ioRing *r)
+{
+	return r->cqTail - r->header->cqHead;
+}
+
+/* Returns true if there is space for one more completion, also counting deferred requests */
+static inline bool __ioRingHasSpace(struct ioRing *r)
+{
+	uint32_t used = __ioRingCompletions(r);
+	if (used > r->cqMask + 1) return false; /* invalid cqHead */
+	return used + r->inflight <= r->cqMask;
+}
+
+/* Appends a completion and wakes up threads waiting on the ring */
+static void __ioRingComplete(struct ioRing *r, uint32_t userData, int32_t result)
+{
+	struct ioRingCompletion *cqe = &r->cq[r->cqTail & r->cqMask];
+	cqe->userData	= userData;
+	cqe->result		= result;
+
+	/* the ring might be polled by a thread running on another processor */
+	__sync_synchronize();
+	r->header->cqTail = ++r->cqTail;
+
+	queueWakeup(&r->waiters, true, __ioRingCompletions(r));
+}
+
+/* Unlinks a request and releases it, obj.entry must already be unlinked */
+static void __ioRequestFree(struct ioRequest *req)
+{
+	req->ring->inflight--;
+	ll_remove(&req->entry_ring);
+	__objectRelease(req->target);
+
+	req->obj.functions = NULL;
+	heapFree(req);
+}
+
+/* Releases a request and posts its completion */
+static void __ioRequestFinish(struct ioRequest *req, int32_t result)
+{
+	struct ioRing *r = req->ring;
+	uint32_t userData = req->sqe.userData;
+
+	__ioRequestFree(req);
+	__ioRingComplete(r, userData, result);
+}
+
+/*
+ * Executes a request, returns false if the operation would block. In this case
+ * the request is added to the wait queue of the target object.
+ */
+static bool __ioRequestRun(struct ioRequest *req, int32_t *result)
+{
+	struct process *p = req->ring->process;
+	struct object *target = req->target;
+	bool write = (req->sqe.opcode == IORING_OP_WRITE);
+	struct linkedList *queue;
+	struct userMemory k;
+	uint32_t mode;
+
+	if (req->sqe.opcode == IORING_OP_WAIT)
+		mode = req->sqe.mode;
+	else
+	{
+		/* don't wait on objects which don't support the operation */
+		if (!(write ? target->functions->write : target->functions->read))
+		{
+			*result = -1;
+			return true;
+		}
+
+		/* mode 0 waits until the object is readable, mode 1 until it is writeable */
+		mode = write ? 1 : 0;
+	}
+
+	*result = 0;
+	queue = __objectWait(target, mode, (uint32_t *)result);
+	if (queue)
+	{
+		ll_add_after(queue, &req->obj.entry);
+		return false;
+	}
+
+	if (req->sqe.opcode == IORING_OP_WAIT)
+		return true;
+
+	/* the process might be terminated already */
+	if (!p->pageDirectory || !ACCESS_USER_MEMORY(&k, p, req->sqe.buffer, req->sqe.length, !write))
+	{
+		*result = -1;
+		return true;
+	}
+
+	if (write)
+		*result = __objectWrite(target, k.addr, req->sqe.length);
+	else
+		*result = __objectRead(target, k.addr, req->sqe.length);
+
+	RELEASE_USER_MEMORY(&k);
+	return true;
+}
+
+/* Executes a request and posts the completion if it doesn't block */
+static void __ioRequestExecute(struct ioRequest *req)
+{
+	int32_t result;
+	if (__ioRequestRun(req, &result))
+		__ioRequestFinish(req, result);
+}
+
+/* Executes all requests in the retry list again */
+static void __ioRingRetry(struct ioRing *r)
+{
+	struct ioRequest *req;
+
+	/* requests can be added again while executing others */
+	while (!ll_empty(&r->retry))
+	{
+		req = LL_ENTRY(r->retry.next, struct ioRequest, obj.entry);
+		ll_remove(&req->obj.entry);
+		__ioRequestExecute(req);
+	}
+}
+
+/* Handles a single submission entry */
+static void __ioRingSubmit(struct ioRing *r, struct ioRingSubmission *sqe)
+{
+	struct ioRequest *req;
+	struct object *obj;
+
+	if (sqe->opcode == IORING_OP_NOP)
+	{
+		__ioRingComplete(r, sqe->userData, 0);
+		return;
+	}
+
+	/* waiting on a ring from a ring would nest the wakeups */
+	if (!(obj = handleGet(&r->process->handles, sqe->handle)) ||
+		(sqe->opcode == IORING_OP_WAIT && ioRingIsValid(obj)))
+	{
+		__ioRingComplete(r, sqe->userData, -1);
+		return;
+	}
+
+	switch (sqe->opcode)
+	{
+		case IORING_OP_SIGNAL:
+			__objectSignal(obj, sqe->mode);
+			__ioRingComplete(r, sqe->userData, true);
+			return;
+
+		case IORING_OP_WAIT:
+		case IORING_OP_READ:
+		case IORING_OP_WRITE:
+			if (!(req = heapAlloc(sizeof(*req), HEAP_TAG_IORING))) break;
+
+			__objectInit(&req->obj, &ioRequestFunctions);
+			req->ring	= r;
+			ll_add_tail(&r->requests, &req->entry_ring);
+			req->target	= __objectAddRef(obj);
+			req->sqe	= *sqe;
+			r->inflight++;
+
+			__ioRequestExecute(req);
+			return;
+
+		default:
+			break;
+	}
+
+	__ioRingComplete(r, sqe->userData, -1);
+}
+
+/**
+ * @brief Destructor for kernel IO ring objects
+ * @details Deferred operations are dropped without posting a completion.
+ *
+ * @param obj Pointer to the kernel IO ring object
+ */
+static void __ioRingDestroy(struct object *obj)
+{
+	struct ioRing *r = objectContainer(obj, struct ioRing, &ioRingFunctions);
+	struct ioRequest *req, *__req;
+
+	/* release other threads if the user destroys the object before they return */
+	queueWakeup(&r->waiters, true, -1);
+	assert(ll_empty(&r->waiters));
+
+	LL_FOR_EACH_SAFE(req, __req, &r->requests, struct ioRequest, entry_ring)
+	{
+		ll_remove(&req->obj.entry);
+		__ioRequestFree(req);
+	}
+	assert(!r->inflight);
+
+	/* unmap the ring from the process, if it wasn't detached and still exists */
+	if (r->process)
+	{
+		ll_remove(&r->entry_process);
+		if (r->process->pageDirectory)
+			pagingTryReleaseUserMem(r->process, r->user_base, r->length);
+		objectRelease(r->process);
+	}
+	pagingReleasePhysMem(NULL, r->header, r->length);
+
+	/* release ring memory */
+	r->obj.functions = NULL;
+	heapFree(r);
+}
+
+/**
+ * @brief Aborts all deferred operations
+ * @details A completion with result (-1) is posted for each deferred operation,
+ *			threads waiting on the ring return (-1).
+ *
+ * @param obj Pointer to the kernel IO ring object
+ * @param mode not used
+ */
+static void __ioRingShutdown(struct object *obj, UNUSED uint32_t mode)
+{
+	struct ioRing *r = objectContainer(obj, struct ioRing, &ioRingFunctions);
+	struct ioRequest *req;
+
+	/* posting a completion wakes up other objects, so don't keep a pointer to the next entry */
+	while (!ll_empty(&r->requests))
+	{
+		req = LL_ENTRY(r->requests.next, struct ioRequest, entry_ring);
+		ll_remove(&req->obj.entry);
+		__ioRequestFinish(req, -1);
+	}
+
+	queueWakeup(&r->waiters, true, -1);
+}
+
+/**
+ * @brief Returns the number of completions which were not consumed yet
+ *
+ * @param obj Pointer to the kernel IO ring object
+ * @param mode not used
+ * @return Number of entries in the completion queue
+ */
+static int32_t __ioRingGetStatus(struct object *obj, UNUSED uint32_t mode)
+{
+	struct ioRing *r = objectContainer(obj, struct ioRing, &ioRingFunctions);
+	return __ioRingCompletions(r);
+}
+
+/**
+ * @brief Wait until a completion is available
+ * @details Deferred read and write operations which can make progress are
+ *			executed first. If the completion queue is still empty the waiter
+ *			linkedlist is returned, such that the thread can add itself to it.
+ *			Waiting threads are also woken up with 0 when a deferred operation
+ *			has to be retried. Waiting on a detached ring fails immediately.
+ *
+ * @param obj Pointer to the kernel IO ring object
+ * @param mode not used
+ * @param result Will be filled out with the number of completions if the operation doesn't block
+ * @return NULL if the operation returns immediately, otherwise a pointer to a wait queue linked list
+ */
+static struct linkedList *__ioRingWait(struct object *obj, UNUSED uint32_t mode, uint32_t *result)
+{
+	struct ioRing *r = objectContainer(obj, struct ioRing, &ioRingFunctions);
+
+	if (!r->process)
+	{
+		*result = -1;
+		return NULL;
+	}
+
+	__ioRingRetry(r);
+	if (!__ioRingCompletions(r)) return &r->waiters;
+
+	*result = __ioRingCompletions(r);
+	return NULL;
+}
+
+/**
+ * @brief Wakes up all threads waiting on the kernel IO ring object
+ *
+ * @param obj Pointer to the kernel IO ring object
+ * @param result Result of the wait operation
+ */
+static void __ioRingSignal(struct object *obj, uint32_t result)
+{
+	struct ioRing *r = objectContainer(obj, struct ioRing, &ioRingFunctions);
+	queueWakeup(&r->waiters, true, result);
+}
+
+/**
+ * @brief Called when the object of a deferred operation is signalled
+ *
+ * @param obj Pointer to the kernel IO request object
+ * @param result Result of the wait operation
+ */
+static void __ioRequestSignal(struct object *obj, uint32_t result)
+{
+	struct ioRequest *req = objectContainer(obj, struct ioRequest, &ioRequestFunctions);
+	struct ioRing *r = req->ring;
+
+	ll_remove(&req->obj.entry);
+
+	/* the wait operation is already completed, side effects like decrementing a semaphore happened */
+	if (req->sqe.opcode == IORING_OP_WAIT)
+	{
+		__ioRequestFinish(req, result);
+		return;
+	}
+
+	ll_add_tail(&r->retry, &req->obj.entry);
+	queueWakeup(&r->waiters, true, 0);
+}
+
+/**
+ * @brief Checks if a kernel object is an IO ring
+ *
+ * @param obj Pointer to a kernel object
+ * @return Pointer to the kernel IO ring object or NULL
+ */
+struct ioRing *ioRingIsValid(struct object *obj)
+{
+	if (!obj || obj->functions != &ioRingFunctions) return NULL;
+	return objectContainer(obj, struct ioRing, &ioRingFunctions);
+}
+
+/**
+ * @brief Executes entries from the submission queue
+ * @details Deferred operations which can make progress are executed first. Afterwards
+ *			up to count submissions are consumed, as long as there is enough space in
+ *			the completion queue for all pending operations. Operations which don't
+ *			block are completed immediately.
+ *
+ * @param r Pointer to the kernel IO ring object
+ * @param count Maximum number of submissions to consume
+ * @return Number of consumed submissions or (-1) if the submission queue is invalid
+ *			or the ring was detached from its process
+ */
+int32_t ioRingEnter(struct ioRing *r, uint32_t count)
+{
+	struct ioRingSubmission sqe;
+	uint32_t pending, i;
+
+	if (!r->process) return -1;
+
+	__ioRingRetry(r);
+
+	pending = r->header->sqTail - r->sqHead;
+	if (pending > r->sqMask + 1) return -1;
+	if (count > pending) count = pending;
+
+	for (i = 0; i < count && __ioRingHasSpace(r); i++)
+	{
+		/* copy the entry, the user could modify it in the meantime */
+		sqe = r->sq[r->sqHead & r->sqMask];
+		r->header->sqHead = ++r->sqHead;
+		__ioRingSubmit(r, &sqe);
+	}
+
+	return i;
+}
+
+/**
+ * @brief Detaches all IO rings from a process
+ * @details Called when the process executes a new program. The ring memory and
+ *			the buffers of deferred operations belong to the old address space, so
+ *			all deferred operations are aborted. Afterwards the ring objects stay
+ *			valid, but all further operations on them fail.
+ *
+ * @param p Pointer to the kernel process object
+ */
+void ioRingDetachProcess(struct process *p)
+{
+	struct ioRing *r;
+
+	while (!ll_empty(&p->ioRings))
+	{
+		r = LL_ENTRY(p->ioRings.next, struct ioRing, entry_process);
+		__ioRingShutdown(&r->obj, 0);
+
+		ll_remove(&r->entry_process);
+		r->process		= NULL;
+		r->user_base	= NULL;
+		objectRelease(p);
+	}
+}
+
+/**
+ * @}
+ */
@@ -28,6 +28,8 @@
 #include <process/pipe.h>
 #include <process/object.h>
 #include <memory/allocator.h>
+#include <memory/physmem.h>
+#include <memory/paging.h>
 #include <console/console.h>
 #include <util/list.h>
 #include <util/util.h>
@@ -38,8 +40,7 @@
  */
 
 
-#define MIN_PIPE_BUFFER_SIZE 0x1000
-#define MAX_PIPE_BUFFER_SIZE 0x10000
+static struct linkedList pipeList = LL_INIT(pipeList);
 
 static void __pipeDestroy(struct object *obj);
 static uint32_t __pipeGetMinHandle(UNUSED struct object *obj);
@@ -81,6 +82,136 @@ static const struct objectFunctions stdoutFunctions =
 	NULL, /* remove */
 };
 
+/**
+ * @brief Returns an empty segment for a kernel pipe object
+ * @details Reuses one of the spare segments of the pipe, or allocates a new page
+ *			if there are none left.
+ *
+ * @param p Pointer to the kernel pipe object
+ * @return Pointer to the segment or NULL if out of memory
+ */
+static uint8_t *__pipeGetSegment(struct pipe *p)
+{
+	if (p->spareCount) return p->spare[--p->spareCount];
+	return pagingTryAllocatePhysMem(NULL, 1, true, false);
+}
+
+/**
+ * @brief Gives back a segment which doesn't contain data anymore
+ * @details The segment is kept for reuse as long as the pipe has less than
+ *			PIPE_SPARE_SEGMENTS spare segments, otherwise the page is released.
+ *			Segments borrowed from a writer are always released, since the page
+ *			might still be mapped into the writer.
+ *
+ * @param p Pointer to the kernel pipe object
+ * @param index Index of the segment in the ring
+ */
+static void __pipePutSegment(struct pipe *p, uint32_t index)
+{
+	uint8_t *segment = p->segments[index];
+	assert(segment);
+	p->segments[index] = NULL;
+
+	if (p->sharedSegments & (1u << index))
+	{
+		p->sharedSegments &= ~(1u << index);
+		pagingReleasePhysMem(NULL, segment, 1);
+	}
+	else if (p->spareCount < PIPE_SPARE_SEGMENTS)
+		p->spare[p->spareCount++] = segment;
+	else
+		pagingReleasePhysMem(NULL, segment, 1);
+}
+
+/**
+ * @brief Releases all segments of a kernel pipe object, including the spare ones
+ *
+ * @param p Pointer to the kernel pipe object
+ */
+static void __pipeReleaseSegments(struct pipe *p)
+{
+	uint32_t i;
+
+	for (i = 0; i < PIPE_SEGMENT_COUNT; i++)
+	{
+		if (p->segments[i]) pagingReleasePhysMem(NULL, p->segments[i], 1);
+		p->segments[i] = NULL;
+	}
+
+	while (p->spareCount)
+		pagingReleasePhysMem(NULL, p->spare[--p->spareCount], 1);
+
+	p->sharedSegments	= 0;
+	p->writePos			= 0;
+	p->readPos	= 0;
+}
+
+/**
+ * @brief Finishes a read operation on a kernel pipe object
+ * @details Hands back the partially consumed segment if the pipe is empty now,
+ *			such that the next write starts at a page boundary again, and wakes
+ *			up waiting writers.
+ *
+ * @param p Pointer to the kernel pipe object
+ */
+static void __pipeReadDone(struct pipe *p)
+{
+	uint32_t used = p->writePos - p->readPos;
+
+	/* buffer is now empty, start again at a page boundary */
+	if (!used)
+	{
+		if (!p->writeable)
+			__pipeReleaseSegments(p);
+		else if (p->readPos & PAGE_MASK)
+		{
+			__pipePutSegment(p, (p->readPos >> PAGE_BITS) & PIPE_SEGMENT_MASK);
+			p->writePos = 0;
+			p->readPos	= 0;
+		}
+	}
+
+	/* wakeup writers if the buffer is not full anymore */
+	if (used < MAX_PIPE_BUFFER_SIZE)
+		queueWakeup(&p->writeWaiters, true, p->writeable ? (MAX_PIPE_BUFFER_SIZE - used) : 0);
+}
+
+/**
+ * @brief Releases the spare segments of kernel pipe objects under memory pressure
+ * @details Segments containing data are never touched, only the ones kept for
+ *			reuse after the reader consumed them. This also runs while a pipe
+ *			allocates a new segment, so the segment ring must stay untouched.
+ *
+ * @param pages Number of pages which should be released
+ * @return Number of pages which were released
+ */
+static uint32_t __pipeShrink(uint32_t pages)
+{
+	struct pipe *p;
+	uint32_t released = 0;
+
+	LL_FOR_EACH(p, &pipeList, struct pipe, entry_list)
+	{
+		while (released < pages && p->spareCount)
+		{
+			pagingReleasePhysMem(NULL, p->spare[--p->spareCount], 1);
+			released++;
+		}
+		if (released >= pages) break;
+	}
+
+	return released;
+}
+
+/**
+ * @brief Initializes the pipe subsystem
+ * @details Registers the shrinker for pipe buffers.
+ */
+void pipeInit()
+{
+	assert(physMemRegisterShrinker(__pipeShrink));
+}
+
 /**
  * @brief Creates a new kernel pipe object
  * @return Pointer to the kernel pipe object
@@ -88,31 +219,257 @@ static const struct objectFunctions stdoutFunctions =
 struct pipe *pipeCreate()
 {
 	struct pipe *p;
-	uint8_t *buffer;
 
 	/* allocate some new memory */
-	if (!(p = heapAlloc(sizeof(*p))))
+	if (!(p = heapAlloc(sizeof(*p), HEAP_TAG_PIPE)))
 		return NULL;
 
-	if (!(buffer = heapAlloc(MIN_PIPE_BUFFER_SIZE)))
-	{
-		heapFree(p);
-		return NULL;
-	}
-
 	/* initialize general object info */
 	__objectInit(&p->obj, &pipeFunctions);
 	ll_init(&p->writeWaiters);
 	ll_init(&p->readWaiters);
-	p->buffer	= buffer;
-	p->size		= MIN_PIPE_BUFFER_SIZE;
-	p->writePos = 0;
-	p->readPos	= 0;
-	p->writeable = true;
-
+	memset(p->segments, 0, sizeof(p->segments));
+	p->sharedSegments = 0;
+	p->writePos		= 0;
+	p->readPos		= 0;
+	p->spareCount	= 0;
+	p->writeable	= true;
+
+	ll_add_tail(&pipeList, &p->entry_list);
 	return p;
 }
 
+/**
+ * @brief Checks if a kernel object is a pipe
+ *
+ * @param obj Pointer to a kernel object
+ * @return Pointer to the kernel pipe object or NULL
+ */
+struct pipe *pipeIsValid(struct object *obj)
+{
+	if (!obj || obj->functions != &pipeFunctions) return NULL;
+	return objectContainer(obj, struct pipe, &pipeFunctions);
+}
+
+/**
+ * @brief Writes whole pages of a process into a kernel pipe object without copying
+ * @details As long as the write position of the pipe is page aligned, the pages
+ *			are queued by reference and marked as copy-on-write in the process.
+ *			The function stops at the first page which can't be shared, or when
+ *			the pipe is full, the caller has to write the rest as usual.
+ *
+ * @param p Pointer to the kernel pipe object
+ * @param proc Process which owns the memory
+ * @param addr Page aligned address of the data in the process
+ * @param length Number of bytes to write into the pipe
+ * @return Number of bytes written (a multiple of PAGE_SIZE) or (-1) if the pipe is not writeable
+ */
+int32_t pipeWritePages(struct pipe *p, struct process *proc, void *addr, uint32_t length)
+{
+	uint32_t used = p->writePos - p->readPos;
+	uint32_t index, written = 0;
+	uint8_t *segment;
+
+	/* fail if the pipe isn't writeable anymore */
+	if (!p->writeable) return -1;
+
+	while (!(p->writePos & PAGE_MASK) && length - written >= PAGE_SIZE && MAX_PIPE_BUFFER_SIZE - used >= PAGE_SIZE)
+	{
+		index = (p->writePos >> PAGE_BITS) & PIPE_SEGMENT_MASK;
+		assert(!p->segments[index]);
+
+		if (!(segment = pagingTryShareUserPage(proc, (uint8_t *)addr + written)))
+			break;
+
+		p->segments[index]	= segment;
+		p->sharedSegments	|= (1u << index);
+		p->writePos			+= PAGE_SIZE;
+		written				+= PAGE_SIZE;
+		used				+= PAGE_SIZE;
+	}
+
+	/* wakeup readers if the buffer is not empty anymore */
+	if (written) queueWakeup(&p->readWaiters, true, used);
+
+	return written;
+}
+
+/**
+ * @brief Reads whole pages from a kernel pipe object into a process without copying
+ * @details As long as the read position of the pipe is page aligned and a complete
+ *			segment is available, the segment is mapped into the process instead
+ *			of the existing page. The function stops at the first page which can't
+ *			be replaced, the caller has to read the rest as usual.
+ *
+ * @param p Pointer to the kernel pipe object
+ * @param proc Process which owns the memory
+ * @param addr Page aligned address of the buffer in the process
+ * @param length Size of the buffer in bytes
+ * @return Number of bytes read (a multiple of PAGE_SIZE)
+ */
+int32_t pipeReadPages(struct pipe *p, struct process *proc, void *addr, uint32_t length)
+{
+	uint32_t used = p->writePos - p->readPos;
+	uint32_t index, read = 0;
+
+	while (!(p->readPos & PAGE_MASK) && length - read >= PAGE_SIZE && used - read >= PAGE_SIZE)
+	{
+		index = (p->readPos >> PAGE_BITS) & PIPE_SEGMENT_MASK;
+		assert(p->segments[index]);
+
+		if (!pagingTryMoveToUserPage(proc, (uint8_t *)addr + read, p->segments[index]))
+			break;
+
+		p->segments[index]	= NULL;
+		p->sharedSegments	&= ~(1u << index);
+		p->readPos			+= PAGE_SIZE;
+		read				+= PAGE_SIZE;
+	}
+
+	if (read) __pipeReadDone(p);
+	return read;
+}
+
+/**
+ * @brief Queues a complete segment of one kernel pipe object in another one
+ * @details Only possible if the destination write position is page aligned. When
+ *			the segment is consumed it is moved, otherwise the physical page is
+ *			mapped a second time, and both pipes treat it as borrowed so that
+ *			neither reuses it for other data.
+ *
+ * @param p Pointer to the source kernel pipe object
+ * @param index Index of the segment in the source
+ * @param dst Pointer to the destination kernel pipe object
+ * @param consume True if the segment is removed from the source
+ * @return True on success, otherwise false
+ */
+static bool __pipeQueueSegment(struct pipe *p, uint32_t index, struct pipe *dst, bool consume)
+{
+	uint32_t dst_index;
+	void *page;
+
+	if (!dst->writeable || (dst->writePos & PAGE_MASK) || MAX_PIPE_BUFFER_SIZE - (dst->writePos - dst->readPos) < PAGE_SIZE)
+		return false;
+
+	dst_index = (dst->writePos >> PAGE_BITS) & PIPE_SEGMENT_MASK;
+	assert(!dst->segments[dst_index]);
+
+	if (consume)
+	{
+		dst->segments[dst_index] = p->segments[index];
+		if (p->sharedSegments & (1u << index)) dst->sharedSegments |= (1u << dst_index);
+		p->segments[index]	= NULL;
+		p->sharedSegments	&= ~(1u << index);
+	}
+	else
+	{
+		/* the caller falls back to copying if the page can't be mapped */
+		if (!(page = pagingTrySearchArea(NULL, 1)) ||
+			!(page = pagingMapRemoteMemory(NULL, NULL, page, p->segments[index], 1, false, false)))
+			return false;
+
+		dst->segments[dst_index] = page;
+		dst->sharedSegments	|= (1u << dst_index);
+		p->sharedSegments	|= (1u << index);
+	}
+
+	dst->writePos += PAGE_SIZE;
+	queueWakeup(&dst->readWaiters, true, dst->writePos - dst->readPos);
+	return true;
+}
+
+/**
+ * @brief Writes data of a kernel pipe object into another object
+ * @details The data is written directly from the segments of the pipe, complete
+ *			segments are passed to destination pipes without copying them.
+ *
+ * @param p Pointer to the kernel pipe object
+ * @param dst Pointer to the destination kernel object
+ * @param length Maximum number of bytes to transfer
+ * @param consume True to remove the transferred data from the pipe
+ * @return Number of bytes transferred or (-1) on error
+ */
+static int32_t __pipeTransfer(struct pipe *p, struct object *dst, uint32_t length, bool consume)
+{
+	struct pipe *dst_pipe = pipeIsValid(dst);
+	uint32_t pos = p->readPos, done = 0;
+	uint32_t index, offset, chunk;
+	int32_t res;
+
+	/* fail if the pipe is empty and nothing can write anymore */
+	if (dst == &p->obj || (!p->writeable && p->writePos == p->readPos)) return -1;
+
+	while (done < length && pos != p->writePos)
+	{
+		index	= (pos >> PAGE_BITS) & PIPE_SEGMENT_MASK;
+		offset	= pos & PAGE_MASK;
+		assert(p->segments[index]);
+
+		chunk = PAGE_SIZE - offset;
+		if (chunk > p->writePos - pos) chunk = p->writePos - pos;
+		if (chunk > length - done) chunk = length - done;
+
+		if (dst_pipe && chunk == PAGE_SIZE && __pipeQueueSegment(p, index, dst_pipe, consume))
+			res = PAGE_SIZE;
+		else
+		{
+			res = __objectWrite(dst, p->segments[index] + offset, chunk);
+			if (res < 0)
+			{
+				if (!done) return -1;
+				break;
+			}
+		}
+
+		pos		+= res;
+		done	+= res;
+
+		if (consume)
+		{
+			p->readPos = pos;
+			if (!(pos & PAGE_MASK) && p->segments[index])
+				__pipePutSegment(p, index);
+		}
+
+		if ((uint32_t)res < chunk) break;
+	}
+
+	if (consume && done) __pipeReadDone(p);
+	return done;
+}
+
+/**
+ * @brief Moves data from a kernel pipe object into another object
+ *
+ * @param p Pointer to the kernel pipe object
+ * @param dst Pointer to the destination kernel object
+ * @param length Maximum number of bytes to move
+ * @return Number of bytes moved, 0 if the pipe is empty or the destination
+ *		   is full, (-1) if the pipe is empty and closed or the destination
+ *		   is not writeable
+ */
+int32_t pipeSplice(struct pipe *p, struct object *dst, uint32_t length)
+{
+	return __pipeTransfer(p, dst, length, true);
+}
+
+/**
+ * @brief Duplicates data of a kernel pipe object into another pipe
+ * @details The data stays in the source pipe and can still be read afterwards.
+ *
+ * @param p Pointer to the source kernel pipe object
+ * @param dst Pointer to the destination kernel pipe object
+ * @param length Maximum number of bytes to duplicate
+ * @return Number of bytes duplicated, 0 if the pipe is empty or the destination
+ *		   is full, (-1) if the pipe is empty and closed or the destination
+ *		   is not writeable
+ */
+int32_t pipeTee(struct pipe *p, struct pipe *dst, uint32_t length)
+{
+	if (!dst->writeable) return -1;
+	return __pipeTransfer(p, &dst->obj, length, false);
+}
+
 /**
  * @brief Destructor for kernel pipe objects
  *
@@ -129,7 +486,8 @@ static void __pipeDestroy(struct object *obj)
 	assert(ll_empty(&p->readWaiters));
 
 	/* release buffer, even if it still contains data */
-	if (p->buffer) heapFree(p->buffer);
+	__pipeReleaseSegments(p);
+	ll_remove(&p->entry_list);
 
 	/* release pipe memory */
 	p->obj.functions = NULL;
@@ -175,11 +533,7 @@ static void __pipeShutdown(struct object *obj, uint32_t mode)
 	queueWakeup(&p->readWaiters, true, -1);
 
 	/* release buffer and reset internal structure */
-	if (p->buffer) heapFree(p->buffer);
-	p->buffer	= NULL;
-	p->size		= 0;
-	p->writePos = 0;
-	p->readPos	= 0;
+	__pipeReleaseSegments(p);
 }
 
 /**
@@ -270,50 +624,41 @@ static int32_t __pipeWrite(struct object *obj, uint8_t *buf, uint32_t length)
 {
 	struct pipe *p = objectContainer(obj, struct pipe, &pipeFunctions);
 	uint32_t used = p->writePos - p->readPos;
+	uint32_t index, offset, chunk, written = 0;
 
 	/* fail if the pipe isn't writeable anymore */
 	if (!p->writeable) return -1;
 
-	/* we expect that the buffer is still there */
-	assert(p->buffer);
-
 	/* ensure that buffer size stays below MAX_PIPE_BUFFER_SIZE */
 	if (length > MAX_PIPE_BUFFER_SIZE - used)
 		length = MAX_PIPE_BUFFER_SIZE - used;
 
-	if (length > p->size - p->writePos)
+	while (written < length)
 	{
+		index	= (p->writePos >> PAGE_BITS) & PIPE_SEGMENT_MASK;
+		offset	= p->writePos & PAGE_MASK;
 
-		/* out of space, move data to the beginning */
-		if (p->readPos != 0)
+		/* out of memory, write as much as possible */
+		if (!p->segments[index] && !(p->segments[index] = __pipeGetSegment(p)))
 		{
-			memmove(p->buffer, p->buffer + p->readPos, p->writePos - p->readPos);
-			p->writePos -= p->readPos;
-			p->readPos = 0;
+			if (!written) return -1;
+			break;
 		}
 
-		if (length > p->size - p->writePos)
-		{
-			uint32_t new_size = p->size * 2;
-			while (new_size < p->writePos + length) new_size *= 2;
+		chunk = PAGE_SIZE - offset;
+		if (chunk > length - written) chunk = length - written;
 
-			p->buffer	= heapReAlloc(p->buffer, new_size);
-			p->size		= new_size;
-			assert(p->buffer);
-		}
+		memcpy(p->segments[index] + offset, buf + written, chunk);
+		p->writePos += chunk;
+		written		+= chunk;
 	}
 
-	if (length > 0)
-	{
-		memcpy(p->buffer + p->writePos, buf, length);
-		p->writePos += length;
-		used += length;
-	}
+	used += written;
 
 	/* wakeup readers if the buffer is not empty anymore */
 	if (used) queueWakeup(&p->readWaiters, true, used);
 
-	return length;
+	return written;
 }
 
 /**
@@ -330,43 +675,34 @@ static int32_t __pipeRead(struct object *obj, uint8_t *buf, uint32_t length)
 {
 	struct pipe *p = objectContainer(obj, struct pipe, &pipeFunctions);
 	uint32_t used = p->writePos - p->readPos;
+	uint32_t index, offset, chunk, read = 0;
 
 	/* fail if the pipe is empty and nothing can write anymore */
 	if (!p->writeable && !used) return -1;
 
-	/* we expect that the buffer is still there */
-	assert(p->buffer);
-
 	/* ensure that length stays below used */
 	if (length > used) length = used;
 
-	/* read some memory */
-	if (length > 0)
+	while (read < length)
 	{
-		memcpy(buf, p->buffer + p->readPos, length);
-		p->readPos += length;
-		used -= length;
-	}
+		index	= (p->readPos >> PAGE_BITS) & PIPE_SEGMENT_MASK;
+		offset	= p->readPos & PAGE_MASK;
+		assert(p->segments[index]);
 
-	/* buffer is now empty */
-	if (p->readPos == p->writePos)
-	{
-		if (!p->writeable)
-		{
-			heapFree(p->buffer);
-			p->buffer	= NULL;
-			p->size		= 0;
-		}
+		chunk = PAGE_SIZE - offset;
+		if (chunk > length - read) chunk = length - read;
 
-		p->readPos  = 0;
-		p->writePos = 0;
-	}
+		memcpy(buf + read, p->segments[index] + offset, chunk);
+		p->readPos	+= chunk;
+		read		+= chunk;
 
-	/* wakeup writers if the buffer is not full anymore */
-	if (used < MAX_PIPE_BUFFER_SIZE)
-		queueWakeup(&p->writeWaiters, true, p->writeable ? (MAX_PIPE_BUFFER_SIZE - used) : 0);
+		/* segment completely consumed */
+		if (!(p->readPos & PAGE_MASK))
+			__pipePutSegment(p, index);
+	}
 
-	return length;
+	__pipeReadDone(p);
+	return read;
 }
 
 /**
@@ -382,7 +718,7 @@ struct stdout *stdoutCreate()
 	struct stdout *p;
 
 	/* allocate some new memory */
-	if (!(p = heapAlloc(sizeof(*p))))
+	if (!(p = heapAlloc(sizeof(*p), HEAP_TAG_PIPE)))
 		return NULL;
 
 	/* initialize general object info */
@@ -30,6 +30,8 @@
 #include <process/thread.h>
 #include <process/object.h>
 #include <hardware/gdt.h>
+#include <hardware/smp.h>
+#include <hardware/tsc.h>
 #include <memory/paging.h>
 #include <memory/allocator.h>
 #include <util/list.h>
@@ -79,44 +81,110 @@ struct process *processCreate(struct process *original)
 	struct process *p;
 
 	/* allocate some new memory */
-	if (!(p = heapAlloc(sizeof(*p))))
+	if (!(p = heapAlloc(sizeof(*p), HEAP_TAG_PROCESS)))
 		return NULL;
 
+	/* the handle table is the only part which can fail, set it up first */
+	if (!(original ? handleForkTable(&p->handles, &original->handles) : handleTableInit(&p->handles)))
+	{
+		heapFree(p);
+		return NULL;
+	}
+
 	/* initialize general object info */
 	__objectInit(&p->obj, &processFunctions);
 	ll_init(&p->waiters);
 	ll_add_tail(&processList, &p->entry_list);
 	p->exitcode = -1;
 	ll_init(&p->threads);
+	p->cpu = smpGetCPU();
+	ll_init(&p->ioRings);
+	p->userTime			= 0;
+	p->kernelTime		= 0;
+	p->contextSwitches	= 0;
+	p->syscalls			= 0;
 	p->pageDirectory = NULL;
 	p->entryPoint    = NULL;
 
 	/* initialize paging for the new process */
 	if (!original)
 	{
-		handleTableInit(&p->handles);
 		pagingAllocProcessPageTable(p);
 
-		pagingMapRemoteMemory(p, NULL, (void *)USERMODE_KERNELSTACK_ADDRESS, kernelStack, 1, true, false);							/* kernelstack */
+		pagingMapRemoteMemory(p, NULL, kernelStack, kernelStack, kernelStackCount, true, false);									/* kernelstack */
 		pagingMapRemoteMemory(p, NULL, (void *)USERMODE_GDT_ADDRESS, (void *)USERMODE_GDT_ADDRESS, GDT_MAX_PAGES, false, false);	/* gdt */
 		pagingMapRemoteMemory(p, NULL, (void *)USERMODE_IDT_ADDRESS, (void *)USERMODE_IDT_ADDRESS, 1, false, false);				/* idt */
 		pagingMapRemoteMemory(p, NULL, (void *)USERMODE_INTJMP_ADDRESS, intJmpTable_user, 1, false, false);							/* intjmp */
 		pagingMapRemoteMemory(p, NULL, (void *)USERMODE_TASK_ADDRESS, (void *)USERMODE_TASK_ADDRESS, 1, false, false);				/* task */
+		pagingMapRemoteMemory(p, NULL, (void *)USERMODE_VSYSCALL_ADDRESS, vsyscallPage, 1, false, true);							/* vsyscall */
 	}
 	else
 	{
-		handleForkTable(&p->handles, &original->handles);
 		pagingForkProcessPageTable(p, original);
+
+		/* the forked page table still references the shared data of the original process */
+		pagingReleasePhysMem(p, (void *)USERMODE_SHARED_DATA_ADDRESS, 1);
+	}
+
+	/* each process has its own shared data page */
+	p->sharedData = pagingAllocatePhysMemUnpageable(NULL, 1, true, false);
+	memset(p->sharedData, 0, PAGE_SIZE);
+	p->sharedData->tscBase		= tscGetBase();
+	p->sharedData->tscFrequency	= tscGetFrequency();
+	p->sharedData->processID	= (uint32_t)p;
+	processMapSharedData(p);
+
+	/* cached memory blocks are part of the forked address space */
+	if (original)
+	{
+		p->stackCache		= original->stackCache;
+		p->threadLocalCache	= original->threadLocalCache;
+	}
+	else
+	{
+		p->stackCache.count			= 0;
+		p->threadLocalCache.count	= 0;
 	}
 
 	p->user_programArgumentsBase		= NULL;
 	p->user_programArgumentsLength		= 0;
 	p->user_environmentVariablesBase	= NULL;
 	p->user_environmentVariablesLength	= 0;
+	processUpdateSharedData(p);
 
 	return p;
 }
 
+/**
+ * @brief Maps the shared data page into the address space of a process
+ * @details The page is mapped read-only at #USERMODE_SHARED_DATA_ADDRESS, the
+ *			page table must not contain a mapping at this address yet.
+ *
+ * @param p Pointer to the kernel process object
+ */
+void processMapSharedData(struct process *p)
+{
+	pagingMapRemoteMemory(p, NULL, (void *)USERMODE_SHARED_DATA_ADDRESS, p->sharedData, 1, false, true);
+}
+
+/**
+ * @brief Updates the program arguments and environment variables in the shared data page
+ * @details The thread specific values are updated again the next time a thread
+ *			of this process is scheduled.
+ *
+ * @param p Pointer to the kernel process object
+ */
+void processUpdateSharedData(struct process *p)
+{
+	struct processSharedData *shared = p->sharedData;
+
+	shared->threadID					= 0;
+	shared->programArgumentsBase		= p->user_programArgumentsBase;
+	shared->programArgumentsLength		= p->user_programArgumentsLength << PAGE_BITS;
+	shared->environmentVariablesBase	= p->user_environmentVariablesBase;
+	shared->environmentVariablesLength	= p->user_environmentVariablesLength << PAGE_BITS;
+}
+
 /**
  * @brief Destructor for kernel process objects
  * @details This function also releases the page table and all handles which are
@@ -148,6 +216,13 @@ static void __processDestroy(struct object *obj)
 		p->handles.handles = NULL;
 	}
 
+	/* release kernel mapping of the shared data page */
+	if (p->sharedData)
+	{
+		pagingReleasePhysMem(NULL, p->sharedData, 1);
+		p->sharedData = NULL;
+	}
+
 	/* unlink from list of existing processes */
 	ll_remove(&p->entry_list);
 
@@ -279,6 +354,11 @@ uint32_t processInfo(struct processInfo *info, uint32_t count)
 		info->handleCount				= 0;
 		info->numberOfTotalThreads		= 0;
 		info->numberOfBlockedThreads	= 0;
+		info->priority					= 0;
+		info->userTime					= 0;
+		info->kernelTime				= threadIdleTime();
+		info->contextSwitches			= 0;
+		info->syscalls					= 0;
 
 		count--;
 		info++;
@@ -296,11 +376,22 @@ uint32_t processInfo(struct processInfo *info, uint32_t count)
 			info->handleCount				= p->handles.handles ? handleCount(&p->handles) : 0;
 			info->numberOfTotalThreads		= 0;
 			info->numberOfBlockedThreads	= 0;
+			info->priority					= 0;
+			info->userTime					= p->userTime;
+			info->kernelTime				= p->kernelTime;
+			info->contextSwitches			= p->contextSwitches;
+			info->syscalls					= p->syscalls;
 
 			LL_FOR_EACH(t, &p->threads, struct thread, entry_process)
 			{
 				info->numberOfTotalThreads++;
 				if (t->blocked) info->numberOfBlockedThreads++;
+				if (t->priority > info->priority) info->priority = t->priority;
+
+				info->userTime			+= t->userTime;
+				info->kernelTime		+= t->kernelTime;
+				info->contextSwitches	+= t->contextSwitches;
+				info->syscalls			+= t->syscalls;
 			}
 
 			count--;
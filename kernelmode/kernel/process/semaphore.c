@@ -70,7 +70,7 @@ struct semaphore *semaphoreCreate(uint32_t value)
 	struct semaphore *s;
 
 	/* allocate some new memory */
-	if (!(s = heapAlloc(sizeof(*s))))
+	if (!(s = heapAlloc(sizeof(*s), HEAP_TAG_SEMAPHORE)))
 		return NULL;
 
 	/* initialize general object info */
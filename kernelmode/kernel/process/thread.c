@@ -28,7 +28,10 @@
 #include <process/thread.h>
 #include <process/process.h>
 #include <process/object.h>
+#include <process/timer.h>
 #include <hardware/gdt.h>
+#include <hardware/fpu.h>
+#include <hardware/smp.h>
 #include <interrupt/interrupt.h>
 #include <memory/physmem.h>
 #include <memory/paging.h>
@@ -39,11 +42,12 @@
 /** \addtogroup Threads
  *  @{
  *  Implementation of threads.
+ *
+ *  Each processor has its own run queues. All threads of a process are queued
+ *  on the processor stored in the process object, idle processors take over
+ *  whole processes from busy ones.
  */
 
-struct linkedList threadList = LL_INIT(threadList);
-struct thread *lastFPUthread;
-
 static void __threadDestroy(struct object *obj);
 static void __threadShutdown(struct object *obj, uint32_t mode);
 static int32_t __threadGetStatus(struct object *obj, UNUSED uint32_t mode);
@@ -64,6 +68,144 @@ static const struct objectFunctions threadFunctions =
 	NULL, /* remove */
 };
 
+/**
+ * @brief Appends a runnable thread to the run queue matching its dynamic priority
+ *
+ * @param t Pointer to the kernel thread object
+ */
+static inline void __threadEnqueue(struct thread *t)
+{
+	t->queuedTimestamp = timerGetTimestamp();
+	ll_add_tail(&t->process->cpu->threadQueues[t->dynamicPriority], &t->obj.entry);
+}
+
+/**
+ * @brief Checks if any other thread than the given one is runnable
+ *
+ * @param cpu Pointer to the processor the thread is queued on
+ * @param t Pointer to the kernel thread object
+ * @return True if the thread has to share the CPU, otherwise false
+ */
+static inline bool __threadOthersRunnable(struct cpu *cpu, struct thread *t)
+{
+	struct linkedList *queues = cpu->threadQueues;
+	uint32_t i;
+
+	for (i = 0; i < THREAD_PRIORITY_LEVELS; i++)
+	{
+		if (ll_empty(&queues[i])) continue;
+		if (i != t->dynamicPriority) return true;
+		if (queues[i].next != &t->obj.entry || queues[i].prev != &t->obj.entry) return true;
+	}
+
+	return false;
+}
+
+/**
+ * @brief Notifies the processors about a thread which became runnable
+ * @details The processor the thread is queued on is woken up in case it is idle
+ *			or running usermode code. If the thread has to share it with other
+ *			threads, an idle processor is woken up too, so it can take over work.
+ *
+ * @param t Pointer to the kernel thread object
+ */
+static void __threadNotify(struct thread *t)
+{
+	struct cpu *cpu = t->process->cpu;
+	uint32_t i;
+
+	smpWakeup(cpu);
+	if (!__threadOthersRunnable(cpu, t)) return;
+
+	for (i = 0; i < cpuCount; i++)
+	{
+		if (cpuTable[i].online && cpuTable[i].idle)
+		{
+			smpWakeup(&cpuTable[i]);
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Drops the FPU state of a thread which is still loaded on any processor
+ *
+ * @param t Pointer to the kernel thread object
+ */
+static void __threadReleaseFPU(struct thread *t)
+{
+	uint32_t i;
+
+	for (i = 0; i < cpuCount; i++)
+	{
+		if (cpuTable[i].lastFPUthread == t)
+			cpuTable[i].lastFPUthread = NULL;
+	}
+}
+
+/**
+ * @brief Allocates a block of user memory, preferably from a cache of retired blocks
+ * @details Reusing the memory of terminated threads avoids allocating, zeroing
+ *			and mapping fresh pages each time a thread is created.
+ *
+ * @param p Pointer to the kernel process object
+ * @param cache Pointer to the cache of the process
+ * @param length Number of pages
+ * @param clear If true a reused block is filled with zeroes, like freshly allocated memory
+ * @return Usermode address of the memory block or NULL if the allocation failed
+ */
+static void *__threadAllocRegion(struct process *p, struct userRegionCache *cache, uint32_t length, bool clear)
+{
+	struct userMemory k;
+	uint32_t i;
+	void *base;
+
+	for (i = 0; i < cache->count; i++)
+	{
+		if (cache->regions[i].length != length) continue;
+
+		base = cache->regions[i].base;
+		cache->regions[i] = cache->regions[--cache->count];
+
+		if (clear)
+		{
+			if (!ACCESS_USER_MEMORY(&k, p, base, length << PAGE_BITS, true))
+			{
+				pagingReleasePhysMem(p, base, length);
+				break;
+			}
+
+			memset(k.addr, 0, length << PAGE_BITS);
+			RELEASE_USER_MEMORY(&k);
+		}
+
+		return base;
+	}
+
+	return pagingTryAllocatePhysMem(p, length, true, true);
+}
+
+/**
+ * @brief Releases a block of user memory allocated with __threadAllocRegion()
+ * @details If the cache is already full the memory is released immediately.
+ *
+ * @param p Pointer to the kernel process object
+ * @param cache Pointer to the cache of the process
+ * @param base Usermode address of the memory block
+ * @param length Number of pages
+ */
+static void __threadReleaseRegion(struct process *p, struct userRegionCache *cache, void *base, uint32_t length)
+{
+	if (cache->count < PROCESS_REGION_CACHE_SIZE)
+	{
+		cache->regions[cache->count].base	= base;
+		cache->regions[cache->count].length	= length;
+		cache->count++;
+	}
+	else
+		pagingReleasePhysMem(p, base, length);
+}
+
 /**
  * @brief Creates a new kernel thread object
  * @details This function allocates and initializes the structure used to store
@@ -75,36 +217,72 @@ static const struct objectFunctions threadFunctions =
  * @param p Pointer to the kernel process object which should contain the new thread
  * @param original Pointer to the original thread object or NULL
  * @param eip Entrypoint (EIP register) of the newly created process
- * @return Pointer to the thread kernel object
+ * @param stackSize Size of the ring3 stack in bytes, or 0 for the default size
+ * @return Pointer to the thread kernel object or NULL if the allocation failed
  */
-struct thread *threadCreate(struct process *p, struct thread *original, void *eip)
+struct thread *threadCreate(struct process *p, struct thread *original, void *eip, uint32_t stackSize)
 {
+	uint32_t stackLength = 0, threadLocalLength = 0;
+	void *stackBase = NULL, *threadLocalBase = NULL;
 	struct thread *t;
-	struct taskContext *task;;
+	struct taskContext *task;
 	assert(p);
 
+	/* allocate the stack and thread local storage first, as this can fail */
+	if (!original)
+	{
+		if (!stackSize) stackSize = DEFAULT_STACK_SIZE;
+		if (stackSize > MAX_STACK_SIZE) return NULL;
+
+		stackLength			= (stackSize + PAGE_MASK) >> PAGE_BITS;
+		threadLocalLength	= DEFAULT_TLB_SIZE >> PAGE_BITS;
+
+		if (!(stackBase = __threadAllocRegion(p, &p->stackCache, stackLength, false)))
+			return NULL;
+
+		if (!(threadLocalBase = __threadAllocRegion(p, &p->threadLocalCache, threadLocalLength, true)))
+		{
+			__threadReleaseRegion(p, &p->stackCache, stackBase, stackLength);
+			return NULL;
+		}
+	}
+
 	/* allocate some new memory */
-	if (!(t = heapAlloc(sizeof(*t))))
+	if (!(t = heapAlloc(sizeof(*t), HEAP_TAG_THREAD)))
+	{
+		if (!original)
+		{
+			__threadReleaseRegion(p, &p->threadLocalCache, threadLocalBase, threadLocalLength);
+			__threadReleaseRegion(p, &p->stackCache, stackBase, stackLength);
+		}
 		return NULL;
+	}
 
 	/* initialize general object info */
 	__objectInit(&t->obj, &threadFunctions);
-	ll_add_tail(&threadList, &t->obj.entry);
 	ll_init(&t->waiters);
 	t->blocked = false;
+	t->user_futexAddr = NULL;
+	t->priority = original ? original->priority : THREAD_PRIORITY_DEFAULT;
+	t->dynamicPriority = t->priority;
 	t->process = p;
+	__threadEnqueue(t);
 	ll_add_tail(&p->threads, &t->entry_process);
 	t->exitcode = -1;
+	t->userTime = 0;
+	t->kernelTime = 0;
+	t->contextSwitches = 0;
+	t->syscalls = 0;
 
 	if (!original)
 	{
 		t->fpuInitialized = false;
 
-		t->user_ring3StackLength	= DEFAULT_STACK_SIZE >> PAGE_BITS;
-		t->user_ring3StackBase		= pagingAllocatePhysMem(p, t->user_ring3StackLength, true, true);
+		t->user_ring3StackLength	= stackLength;
+		t->user_ring3StackBase		= stackBase;
 
-		t->user_threadLocalLength	= DEFAULT_TLB_SIZE >> PAGE_BITS;
-		t->user_threadLocalBase		= pagingAllocatePhysMem(p, t->user_threadLocalLength, true, true);
+		t->user_threadLocalLength	= threadLocalLength;
+		t->user_threadLocalBase		= threadLocalBase;
 
 		/* initialize the cpu registers */
 		task = &t->task;
@@ -158,14 +336,21 @@ struct thread *threadCreate(struct process *p, struct thread *original, void *ei
 		if (t->fpuInitialized)
 		{
 			/* we have to save the last fpu context to memory in order to make sure we copy the latest state */
-			if (lastFPUthread == original)
+			struct cpu *cpu = smpGetCPU();
+			if (cpu->lastFPUthread == original)
 			{
 				asm volatile("clts");
-				asm volatile("fnsave %0; fwait" : "=m" (lastFPUthread->fpu));
+				fpuSave(&original->fpu);
+
+				/* fnsave reinitializes the FPU, so the original thread has to restore it again */
+				cpu->lastFPUthread = NULL;
 			}
 
 			t->fpu = original->fpu;
 		}
+
+		/* an idle processor can take over the new process */
+		__threadNotify(t);
 	}
 
 	/* addref for the corresponding process and thread */
@@ -183,7 +368,7 @@ struct thread *threadCreate(struct process *p, struct thread *original, void *ei
 static void __threadDestroy(struct object *obj)
 {
 	struct thread *t = objectContainer(obj, struct thread, &threadFunctions);
-	if (t == lastFPUthread) lastFPUthread = NULL;
+	__threadReleaseFPU(t);
 
 	/* there should be no more threads waiting on this one */
 	assert(ll_empty(&t->waiters));
@@ -210,26 +395,39 @@ static void __threadShutdown(struct object *obj, uint32_t exitcode)
 {
 	struct thread *t = objectContainer(obj, struct thread, &threadFunctions);
 	struct process *p = t->process;
-	if (t == lastFPUthread) lastFPUthread = NULL;
+	__threadReleaseFPU(t);
 
 	if (t->process)
 	{
+		/* the thread might currently run on another processor */
+		smpStopProcess(p);
+
 		t->process  = NULL;
 		t->exitcode = exitcode;
 
 		assert(t->user_threadLocalBase);
 		assert(t->user_ring3StackBase);
 
-		/* release stacks */
-		pagingReleasePhysMem(p, t->user_threadLocalBase, t->user_threadLocalLength);
+		/* the thread object could be reused at the same address */
+		if (p->sharedData->threadID == (uint32_t)t)
+			p->sharedData->threadID = 0;
+
+		/* release stacks (or keep them for the next thread) */
+		__threadReleaseRegion(p, &p->threadLocalCache, t->user_threadLocalBase, t->user_threadLocalLength);
 		t->user_threadLocalBase = NULL;
 
-		pagingReleasePhysMem(p, t->user_ring3StackBase, t->user_ring3StackLength);
+		__threadReleaseRegion(p, &p->stackCache, t->user_ring3StackBase, t->user_ring3StackLength);
 		t->user_ring3StackBase = NULL;
 
 		ll_remove(&t->obj.entry);
 		ll_remove(&t->entry_process);
 
+		/* keep the statistics of terminated threads */
+		p->userTime			+= t->userTime;
+		p->kernelTime		+= t->kernelTime;
+		p->contextSwitches	+= t->contextSwitches;
+		p->syscalls			+= t->syscalls;
+
 		/* wake up waiting threads */
 		queueWakeup(&t->waiters, true, t->exitcode);
 
@@ -300,30 +498,249 @@ static void __threadSignal(struct object *obj, uint32_t result)
 	t->blocked = false;
 	t->task.eax = result;
 	ll_remove(&t->obj.entry);
-	ll_add_tail(&threadList, &t->obj.entry);
+
+	/* threads waiting for I/O are preferred, so that interactive threads respond quickly */
+	if (t->dynamicPriority < t->priority + THREAD_PRIORITY_WAKEUP_BONUS)
+		t->dynamicPriority = t->priority + THREAD_PRIORITY_WAKEUP_BONUS;
+	if (t->dynamicPriority > THREAD_PRIORITY_MAX)
+		t->dynamicPriority = THREAD_PRIORITY_MAX;
+
+	__threadEnqueue(t);
+	__threadNotify(t);
+}
+
+/**
+ * @brief Moves threads which are waiting for too long to the next higher run queue
+ * @details To prevent starvation of low priority threads the dynamic priority of
+ *			runnable threads which haven't been scheduled for #THREAD_AGING_TIMEOUT
+ *			milliseconds is incremented. As soon as they were running for a time
+ *			slice they slowly decay back to their base priority again.
+ *
+ * @param cpu Pointer to the processor whose run queues should be checked
+ * @return True if an aging pass was done, otherwise false
+ */
+static bool __threadAging(struct cpu *cpu)
+{
+	uint64_t timestamp = timerGetTimestamp();
+	struct thread *t, *__t;
+	uint32_t i;
+
+	if (timestamp - cpu->lastAging < THREAD_AGING_TIMEOUT) return false;
+	cpu->lastAging = timestamp;
+
+	/* start with the highest queue, so that threads are only moved once */
+	for (i = THREAD_PRIORITY_MAX; i-- > 0;)
+	{
+		LL_FOR_EACH_SAFE(t, __t, &cpu->threadQueues[i], struct thread, obj.entry)
+		{
+			/* queues are sorted by the time the threads were appended */
+			if (timestamp - t->queuedTimestamp < THREAD_AGING_TIMEOUT) break;
+
+			ll_remove(&t->obj.entry);
+			t->dynamicPriority = i + 1;
+			__threadEnqueue(t);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * @brief Returns the number of runnable threads queued on a processor
+ *
+ * @param cpu Pointer to the cpu structure
+ * @return Number of threads in all run queues of the processor
+ */
+static uint32_t __threadLoad(struct cpu *cpu)
+{
+	struct thread *t;
+	uint32_t i, load = 0;
+
+	for (i = 0; i < THREAD_PRIORITY_LEVELS; i++)
+	{
+		LL_FOR_EACH(t, &cpu->threadQueues[i], struct thread, obj.entry)
+			load++;
+	}
+
+	return load;
+}
+
+/**
+ * @brief Moves all threads of a process to the run queues of another processor
+ *
+ * @param p Pointer to the kernel process object
+ * @param cpu Pointer to the processor which should run the process from now on
+ */
+static void __threadMigrate(struct process *p, struct cpu *cpu)
+{
+	struct thread *t;
+
+	p->cpu = cpu;
+
+	/* blocked threads are appended to the new run queues when they wake up */
+	LL_FOR_EACH(t, &p->threads, struct thread, entry_process)
+	{
+		if (t->blocked) continue;
+
+		ll_remove(&t->obj.entry);
+		__threadEnqueue(t);
+	}
+}
+
+/**
+ * @brief Returns the number of runnable threads of a process
+ *
+ * @param p Pointer to the kernel process object
+ * @return Number of threads which are not blocked
+ */
+static uint32_t __threadRunnable(struct process *p)
+{
+	struct thread *t;
+	uint32_t count = 0;
+
+	LL_FOR_EACH(t, &p->threads, struct thread, entry_process)
+	{
+		if (!t->blocked) count++;
+	}
+
+	return count;
+}
+
+/**
+ * @brief Takes over a process from the busiest processor
+ * @details A process is only moved if at least two more threads are queued on the
+ *			other processor, and if the move actually reduces the difference. The
+ *			process currently running on the other processor and the process owning
+ *			its FPU state are never moved. The search starts with the lowest run
+ *			queues, which are the least likely to be scheduled there soon.
+ *
+ * @param cpu Pointer to the processor which is looking for work
+ * @return True if a process was moved, otherwise false
+ */
+static bool __threadBalance(struct cpu *cpu)
+{
+	uint32_t i, load = __threadLoad(cpu), maxLoad = load + 1;
+	struct cpu *busiest = NULL;
+	struct process *p;
+	struct thread *t;
+
+	for (i = 0; i < cpuCount; i++)
+	{
+		uint32_t otherLoad;
+		if (&cpuTable[i] == cpu || !cpuTable[i].online) continue;
+
+		otherLoad = __threadLoad(&cpuTable[i]);
+		if (otherLoad > maxLoad)
+		{
+			busiest = &cpuTable[i];
+			maxLoad = otherLoad;
+		}
+	}
+
+	if (!busiest) return false;
+
+	for (i = 0; i < THREAD_PRIORITY_LEVELS; i++)
+	{
+		LL_FOR_EACH(t, &busiest->threadQueues[i], struct thread, obj.entry)
+		{
+			p = t->process;
+			if (busiest->current && busiest->current->process == p) continue;
+			if (busiest->lastFPUthread && busiest->lastFPUthread->process == p) continue;
+			if (__threadRunnable(p) >= maxLoad - load) continue;
+
+			__threadMigrate(p, cpu);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * @brief Returns the next thread which should be executed
+ * @details Each aging pass also gives the processor the chance to take over
+ *			work from a processor which is busier.
+ *
+ * @param cpu Pointer to the current processor
+ * @return Pointer to the first thread in the highest non-empty run queue or NULL
+ */
+static struct thread *__threadGetNext(struct cpu *cpu)
+{
+	uint32_t i;
+
+	if (__threadAging(cpu))
+		__threadBalance(cpu);
+
+	for (i = THREAD_PRIORITY_LEVELS; i-- > 0;)
+	{
+		if (!ll_empty(&cpu->threadQueues[i]))
+			return LL_ENTRY(cpu->threadQueues[i].next, struct thread, obj.entry);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Checks if a thread with a higher priority than the given one is runnable
+ *
+ * @param cpu Pointer to the processor the thread is queued on
+ * @param t Pointer to the kernel thread object
+ * @return True if the thread should be preempted, otherwise false
+ */
+static inline bool __threadPreempt(struct cpu *cpu, struct thread *t)
+{
+	uint32_t i;
+
+	for (i = t->dynamicPriority + 1; i < THREAD_PRIORITY_LEVELS; i++)
+	{
+		if (!ll_empty(&cpu->threadQueues[i]))
+			return true;
+	}
+
+	return false;
 }
 
 /**
  * @brief Runs a specific thread until it is terminated or the scheduler triggers the next thread
+ * @details The thread is also interrupted as soon as a thread with a higher priority
+ *			becomes runnable, for example when an IRQ wakes up a thread waiting for input.
+ *			If the thread is still runnable afterwards it is appended to the end of its
+ *			run queue again, and a previous wakeup bonus decays by one level.
+ *			The timer only interrupts the thread at the end of its time slice if
+ *			other threads are runnable.
  *
+ * @param cpu Pointer to the current processor
  * @param t Pointer to the kernel thread object
- * @return Pointer to the next kernel thread object which should be executed
  */
-static struct thread *__threadRun(struct thread *t)
+static void __threadRun(struct cpu *cpu, struct thread *t)
 {
-	struct thread *next_t = NULL;
 	struct process *p = t->process;
 	uint32_t status = INTERRUPT_CONTINUE_EXECUTION;
 
-	/* get next thread in the linked list */
-	next_t = LL_ENTRY(t->obj.entry.next, struct thread, obj.entry);
+	/* the thread could be released while running, keep it alive till we're done */
+	objectAddRef(t);
+
+	/* the process of the current thread is not moved to other processors */
+	cpu->current = t;
 
 	if (p)
 	{
+		t->contextSwitches++;
+
+		if (__threadOthersRunnable(cpu, t))
+			timerStartTimeslice(true);
+		else
+			timerStopTimeslice();
+
 		/* run task and dispatch the interrupt */
-		while (status == INTERRUPT_CONTINUE_EXECUTION)
+		while (status == INTERRUPT_CONTINUE_EXECUTION && !__threadPreempt(cpu, t))
 		{
 			assert(t->process == p && !t->blocked);
+
+			/* threads woken up in the meantime have to get the CPU at some point */
+			if (__threadOthersRunnable(cpu, t))
+				timerStartTimeslice(false);
+
 			status = tssRunUsermodeThread(t);
 		}
 	}
@@ -331,46 +748,129 @@ static struct thread *__threadRun(struct thread *t)
 	/* handle special cases */
 	if (status == INTERRUPT_EXIT_THREAD)
 	{
-		/* shutdown the current thread (using the borrowed reference) */
+		/* shutdown the current thread */
 		objectShutdown(t, t->task.ebx);
 	}
 	else if (status == INTERRUPT_EXIT_PROCESS)
 	{
-		/* get pointer to the next process */
-		while (&next_t->obj.entry != &threadList && next_t->process == p)
-			next_t = LL_ENTRY(next_t->obj.entry.next, struct thread, obj.entry);
-
-		/* terminate the current process (using the borrowed reference) */
+		/* terminate the current process */
 		objectShutdown(p, t->task.ebx);
 	}
+	else if (t->process && !t->blocked)
+	{
+		if (t->dynamicPriority > t->priority)
+			t->dynamicPriority--;
+
+		ll_remove(&t->obj.entry);
+		__threadEnqueue(t);
+	}
+
+	cpu->current = NULL;
+	objectRelease(t);
+}
 
-	return next_t;
+/**
+ * @brief Initializes the thread run queues of all processors
+ */
+void threadInit()
+{
+	uint32_t i, j;
+	for (i = 0; i < SMP_MAX_CPUS; i++)
+	{
+		for (j = 0; j < THREAD_PRIORITY_LEVELS; j++)
+			ll_init(&cpuTable[i].threadQueues[j]);
+	}
 }
 
 /**
  * @brief Schedules threads until all process have been terminated
  * @details This is the main function which is responsible for running usermode
  *			code. It will be blocking until all processes have been terminated.
+ *			Threads are always taken from the highest non-empty run queue of the
+ *			current processor, threads with the same priority are scheduled using
+ *			Round Robin. Before the processor goes idle it tries to take over a
+ *			process from a busier processor. Has to be called with the kernel lock held.
  */
 void threadSchedule()
 {
+	struct cpu *cpu = smpGetCPU();
 	struct thread *t;
+	uint64_t idleStart;
 
 	/* if the last process is terminated there is nothing we can do */
 	while (!ll_empty(&processList))
 	{
+		/* as long as threads are available schedule them */
+		while ((t = __threadGetNext(cpu)))
+			__threadRun(cpu, t);
+
+		if (__threadBalance(cpu))
+			continue;
+
+		/* enable interrupts and wait, the timer only fires for the next expiry */
+		timerStopTimeslice();
+		cpu->idle = true;
+		idleStart = rdtsc();
+		smpUnlock();
+		tssKernelIdle();
+		cpu->idleTicks += rdtsc() - idleStart;
+		cpu->idle = false;
+	}
+}
 
-		/* as long as threads are available schedule them one after each other */
-		while (!ll_empty(&threadList))
-		{
-			/* we automatically get a pointer to the next thread which should be executed */
-			for (t = LL_ENTRY(threadList.next, struct thread, obj.entry); &t->obj.entry != &threadList;)
-				t = __threadRun(t);
-		}
+/**
+ * @brief Returns the time the kernel was idle
+ *
+ * @return Time all processors spent waiting for interrupts in TSC ticks
+ */
+uint64_t threadIdleTime()
+{
+	uint64_t idleTicks = 0;
+	uint32_t i;
 
-		/* enable interrupts and wait */
-		tssKernelIdle();
+	for (i = 0; i < cpuCount; i++)
+		idleTicks += cpuTable[i].idleTicks;
+
+	return idleTicks;
+}
+
+/**
+ * @brief Returns the kernel thread object if the object is a thread
+ *
+ * @param obj Pointer to a kernel object
+ * @return Pointer to the kernel thread object or NULL
+ */
+struct thread *threadIsValid(struct object *obj)
+{
+	if (!obj || obj->functions != &threadFunctions) return NULL;
+	return objectContainer(obj, struct thread, &threadFunctions);
+}
+
+/**
+ * @brief Changes the base priority of a kernel thread object
+ * @details This function sets the base priority of a thread and drops any
+ *			temporary bonus. If the thread is runnable it is moved to the end of
+ *			the corresponding run queue.
+ *
+ * @param t Pointer to the kernel thread object
+ * @param priority New priority, between #THREAD_PRIORITY_MIN and #THREAD_PRIORITY_MAX
+ * @return Previous base priority of the thread
+ */
+uint32_t threadSetPriority(struct thread *t, uint32_t priority)
+{
+	uint32_t oldPriority = t->priority;
+	assert(priority <= THREAD_PRIORITY_MAX);
+
+	t->priority			= priority;
+	t->dynamicPriority	= priority;
+
+	if (t->process && !t->blocked)
+	{
+		ll_remove(&t->obj.entry);
+		__threadEnqueue(t);
 	}
+
+	return oldPriority;
 }
 
 /**
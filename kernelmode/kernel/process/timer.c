@@ -31,6 +31,9 @@
 #include <interrupt/interrupt.h>
 #include <hardware/pic.h>
 #include <hardware/pit.h>
+#include <hardware/apic.h>
+#include <hardware/smp.h>
+#include <hardware/tsc.h>
 #include <util/list.h>
 #include <util/util.h>
 
@@ -39,12 +42,44 @@
  *  Implementation of timer functions.
  */
 
-#define TIMER_INTERRUPT_FREQUENCY	82 /* Hz */
-#define TIMER_INTERRUPT_DELTA		12 /* ms */
+#define TIMER_INTERRUPT_DELTA		12000000 /* ns, length of a time slice */
 
-static uint64_t currentKernelTimestamp;
+/*
+ * The clock is based on the TSC, the APIC timer (or the PIT if there is no
+ * local APIC) is only used in one-shot mode to generate the next interrupt.
+ * The counter of the PIT has 16 bits, so the maximum delay has to be below
+ * ~54 ms.
+ */
+#define TIMER_MAX_DELAY				50000000 /* ns */
+#define TIMER_MAX_DELAY_APIC		1000000000 /* ns */
+#define TIMER_MIN_PIT_TICKS			0x40
+
+/* the APIC timer is used instead of the PIT */
+static bool timerUseApic;
+
+/* time of the next interrupt programmed on the bootstrap processor (or 0), in ns */
+static uint64_t timerNextInterrupt;
+
+/*
+ * Active timers are kept in a hierarchical timing wheel. Level 0 has one bucket
+ * per 2^TIMER_WHEEL_SHIFT ns (~66 us), each bucket of level n covers
+ * TIMER_WHEEL_SIZE buckets of level n-1. The buckets of higher levels are moved
+ * down (cascaded) as soon as the lower level wraps around. Timers too far in the
+ * future are kept in timerOverflow, which is sorted again when the highest level
+ * wraps around.
+ */
+#define TIMER_WHEEL_SHIFT			16
+#define TIMER_WHEEL_BITS			6
+#define TIMER_WHEEL_SIZE			(1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK			(TIMER_WHEEL_SIZE - 1)
+#define TIMER_WHEEL_LEVELS			4
+
+static struct linkedList timerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SIZE];
+static struct linkedList timerOverflow = LL_INIT(timerOverflow);
+static uint32_t timerActiveCount;
 
-struct linkedList timerList = LL_INIT(timerList);
+/* all timers in buckets below timerWheelTime were already triggered */
+static uint64_t timerWheelTime;
 
 static void __timerDestroy(struct object *obj);
 static void __timerShutdown(struct object *obj, UNUSED uint32_t mode);
@@ -67,38 +102,211 @@ static const struct objectFunctions timerFunctions =
 	NULL, /* remove */
 };
 
-/* disables the timer in the global timerList */
+/* converts milliseconds to nanoseconds, saturating instead of overflowing */
+static inline uint64_t __timerMsToNs(uint64_t ms)
+{
+	return (ms < ~0ULL / 1000000) ? (ms * 1000000) : ~0ULL;
+}
+
+/* returns the key of the wheel bucket for a timeout (rounded up, so timers never fire too early) */
+static inline uint64_t __timerWheelKey(uint64_t timeout)
+{
+	return (timeout >> TIMER_WHEEL_SHIFT) + ((timeout & ((1 << TIMER_WHEEL_SHIFT) - 1)) != 0);
+}
+
+/* returns the bucket of the timing wheel for a specific timeout */
+static inline struct linkedList *__timerGetBucket(uint64_t timeout)
+{
+	uint64_t key = __timerWheelKey(timeout);
+	uint64_t delta;
+	uint32_t level;
+
+	/* already expired, trigger it with the next bucket */
+	if (key < timerWheelTime)
+		return &timerWheel[0][timerWheelTime & TIMER_WHEEL_MASK];
+
+	delta = key - timerWheelTime;
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		if (delta < (1ULL << (TIMER_WHEEL_BITS * (level + 1))))
+			return &timerWheel[level][(key >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK];
+	}
+
+	return &timerOverflow;
+}
+
+/* moves all elements of a list to a temporary list head */
+static inline void __timerTakeList(struct linkedList *list, struct linkedList *tmp)
+{
+	ll_init(tmp);
+	if (ll_empty(list)) return;
+
+	tmp->next		= list->next;
+	tmp->prev		= list->prev;
+	tmp->next->prev	= tmp;
+	tmp->prev->next	= tmp;
+	ll_init(list);
+}
+
+/* disables the timer in the timing wheel */
 static inline void __timerDeactivate(struct timer *t)
 {
 	if (t->active)
 	{
 		ll_remove(&t->obj.entry);
 		t->active = false;
+		timerActiveCount--;
 	}
 }
 
-/* enables the timer in the global timerList */
+/* enables the timer in the timing wheel */
 static inline void __timerActivate(struct timer *t)
 {
 	if (!t->active)
 	{
-		struct timer *cur_t;
-		LL_FOR_EACH(cur_t, &timerList, struct timer, obj.entry)
-		{
-			if (cur_t->timeout > t->timeout) break;
-		}
-		ll_add_before(&cur_t->obj.entry, &t->obj.entry);
+		ll_add_tail(__timerGetBucket(t->timeout), &t->obj.entry);
 		t->active = true;
+		timerActiveCount++;
 	}
 }
 
-/* updates the timer in the global timerList */
+/* updates the timer in the timing wheel */
 static inline void __timerUpdate(struct timer *t)
 {
 	__timerDeactivate(t);
 	__timerActivate(t);
 }
 
+/**
+ * @brief Returns the next timestamp at which the timing wheel has to be advanced
+ * @details This is either the first non-empty bucket of level 0, or the point where
+ *			level 0 wraps around and the next buckets have to be cascaded. The buckets
+ *			for the current range of level 0 are always cascaded already.
+ *
+ * @return Timestamp in nanoseconds
+ */
+static uint64_t __timerWheelNextEvent()
+{
+	uint32_t i, index = timerWheelTime & TIMER_WHEEL_MASK;
+
+	for (i = index; i < TIMER_WHEEL_SIZE; i++)
+	{
+		if (!ll_empty(&timerWheel[0][i])) break;
+	}
+
+	return (timerWheelTime + (i - index)) << TIMER_WHEEL_SHIFT;
+}
+
+/**
+ * @brief Triggers all timers which expired up to the given timestamp
+ *
+ * @param timestamp Current time in nanoseconds
+ */
+static void __timerWheelAdvance(uint64_t timestamp)
+{
+	struct linkedList expired, tmp;
+	struct timer *t, *__t;
+	uint32_t level, index;
+	uint32_t eventCount;
+
+	while (timerWheelTime <= (timestamp >> TIMER_WHEEL_SHIFT))
+	{
+		/* take the timers of the current bucket */
+		__timerTakeList(&timerWheel[0][timerWheelTime & TIMER_WHEEL_MASK], &expired);
+		timerWheelTime++;
+
+		/* move the next buckets of the higher levels down, as long as the levels wrap around */
+		for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+		{
+			if ((timerWheelTime >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK) break;
+			if (level + 1 < TIMER_WHEEL_LEVELS)
+			{
+				index = (timerWheelTime >> (TIMER_WHEEL_BITS * (level + 1))) & TIMER_WHEEL_MASK;
+				__timerTakeList(&timerWheel[level + 1][index], &tmp);
+			}
+			else
+				__timerTakeList(&timerOverflow, &tmp);
+
+			LL_FOR_EACH_SAFE(t, __t, &tmp, struct timer, obj.entry)
+			{
+				ll_add_tail(__timerGetBucket(t->timeout), &t->obj.entry);
+			}
+		}
+
+		/* trigger them */
+		LL_FOR_EACH_SAFE(t, __t, &expired, struct timer, obj.entry)
+		{
+			/* Calculate the number of occurances since the timeout elapsed the last time */
+			if (t->interval)
+			{
+				eventCount = (timestamp - t->timeout) / t->interval + 1;
+				t->timeout += eventCount * t->interval;
+				__timerUpdate(t);
+			}
+			else
+			{
+				eventCount = 1;
+				__timerDeactivate(t);
+			}
+
+			/* wake up waiters */
+			queueWakeup(&t->waiters, t->wakeupAll, eventCount);
+		}
+	}
+}
+
+/**
+ * @brief Programs the APIC timer or the PIT to interrupt at the next event
+ * @details The next event is either the next expiry in the timing wheel, or the
+ *			end of the current time slice. If none of them is close the timer is
+ *			still programmed with #TIMER_MAX_DELAY (or #TIMER_MAX_DELAY_APIC).
+ *			The timing wheel is driven by the timer of the bootstrap processor,
+ *			so this function must only be called there.
+ */
+static void __timerProgram()
+{
+	uint64_t now = tscGetNanoseconds();
+	uint64_t deadline = now + (timerUseApic ? TIMER_MAX_DELAY_APIC : TIMER_MAX_DELAY);
+	uint64_t timeout;
+	uint32_t ticks;
+
+	if (timerActiveCount)
+	{
+		timeout = __timerWheelNextEvent();
+		if (timeout < deadline) deadline = timeout;
+	}
+
+	if (cpuTable[0].sliceEnd && cpuTable[0].sliceEnd < deadline)
+		deadline = cpuTable[0].sliceEnd;
+
+	/* the timer is already programmed correctly */
+	if (deadline == timerNextInterrupt) return;
+	timerNextInterrupt = deadline;
+
+	if (timerUseApic)
+	{
+		apicTimerStart((deadline > now) ? (deadline - now) : 0, false);
+		return;
+	}
+
+	ticks = (deadline > now) ? ((deadline - now) * PIT_FREQUENCY + 999999999) / 1000000000 : 0;
+	if (ticks < TIMER_MIN_PIT_TICKS) ticks = TIMER_MIN_PIT_TICKS;
+	pitSetValue(0, PIT_MODE_INTERRUPT_ON_TERMINAL, ticks);
+}
+
+/* reprograms the hardware timer if the timer expires before the next interrupt */
+static inline void __timerCheckFirst(struct timer *t)
+{
+	if (!t->active || (__timerWheelKey(t->timeout) << TIMER_WHEEL_SHIFT) >= timerNextInterrupt)
+		return;
+
+	/* the timer interrupt of the bootstrap processor reprograms its timer */
+	if (smpGetCPU()->bootstrap)
+		__timerProgram();
+	else
+		apicSendIPI(cpuTable[0].apicID, APIC_ICR_FIXED | APIC_TIMER_VECTOR);
+}
+
 /**
  * @brief Creates a new kernel timer object
  * @details This function allocates and returns the memory for a new kernel timer
@@ -113,7 +321,7 @@ struct timer *timerCreate(bool wakeupAll)
 	struct timer *t;
 
 	/* allocate some new memory */
-	if (!(t = heapAlloc(sizeof(*t))))
+	if (!(t = heapAlloc(sizeof(*t), HEAP_TAG_TIMER)))
 		return NULL;
 
 	/* initialize general object info */
@@ -195,21 +403,24 @@ static int32_t __timerGetStatus(struct object *obj, UNUSED uint32_t mode)
 static struct linkedList *__timerWait(struct object *obj, UNUSED uint32_t mode, uint32_t *result)
 {
 	struct timer *t = objectContainer(obj, struct timer, &timerFunctions);
+	uint64_t timestamp = tscGetNanoseconds();
 	uint32_t eventCount;
 
 	/* wait for event */
-	if (t->timeout > currentKernelTimestamp)
+	if (t->timeout > timestamp)
 	{
 		__timerActivate(t);
+		__timerCheckFirst(t);
 		return &t->waiters;
 	}
 
 	/* Calculate the number of occurances since the timeout elapsed the last time */
 	if (t->interval)
 	{
-		eventCount = (currentKernelTimestamp - t->timeout) / t->interval + 1;
+		eventCount = (timestamp - t->timeout) / t->interval + 1;
 		t->timeout += eventCount * t->interval;
 		__timerUpdate(t);
+		__timerCheckFirst(t);
 	}
 	else
 	{
@@ -241,79 +452,149 @@ static void __timerSignal(struct object *obj, UNUSED uint32_t result)
 /**
  * @brief Changes the timeout and interval of a kernel timer
  * @details Buffer should point to a timerInfo structure containing the timeout
- *			and interval. The timer internal information is updated afterwards.
+ *			and interval in milliseconds, or a timerInfoNs structure containing
+ *			them in nanoseconds. The timer internal information is updated afterwards.
  *
  * @param obj Pointer to the kernel timer object
- * @param buf Pointer to a timerInfo structure
- * @param length Should be sizeof(struct timerInfo)
- * @return (-1) if the structure was invalid, otherwise sizeof(struct timerInfo)
+ * @param buf Pointer to a timerInfo or timerInfoNs structure
+ * @param length Should be sizeof(struct timerInfo) or sizeof(struct timerInfoNs)
+ * @return (-1) if the structure was invalid, otherwise length
  */
 static int32_t __timerWrite(struct object *obj, uint8_t *buf, uint32_t length)
 {
 	struct timer *t = objectContainer(obj, struct timer, &timerFunctions);
-	struct timerInfo *info = (struct timerInfo *)buf;
-	if (length != sizeof(struct timerInfo)) return -1;
+	uint64_t timeout, interval;
+
+	if (length == sizeof(struct timerInfo))
+	{
+		struct timerInfo *info = (struct timerInfo *)buf;
+		timeout  = __timerMsToNs(info->timeout);
+		interval = __timerMsToNs(info->interval);
+	}
+	else if (length == sizeof(struct timerInfoNs))
+	{
+		struct timerInfoNs *info = (struct timerInfoNs *)buf;
+		timeout  = info->timeout;
+		interval = info->interval;
+	}
+	else
+		return -1;
 
 	/* update timer structure */
-	t->timeout  = currentKernelTimestamp + info->timeout;
-	t->interval = info->interval;
+	t->timeout  = tscGetNanoseconds();
+	t->timeout  = (timeout < ~0ULL - t->timeout) ? (t->timeout + timeout) : ~0ULL;
+	t->interval = interval;
 
 	/* update the timer */
 	__timerUpdate(t);
+	__timerCheckFirst(t);
 	return length;
 }
 
 /**
  * @brief Handles the timer IRQ
- * @details This function triggers any expired timers and afterwards schedules
- *			the next thread (Round Robin scheduling).
+ * @details This function triggers any expired timers and programs the hardware
+ *			timer for the next event. If the time slice of the current thread has elapsed
+ *			the next thread is scheduled (Round Robin scheduling).
  *
  * @param irq not used
- * @return Always returns #INTERRUPT_YIELD
+ * @return #INTERRUPT_YIELD at the end of a time slice, otherwise #INTERRUPT_CONTINUE_EXECUTION
  */
 static uint32_t timer_irq(UNUSED uint32_t irq)
 {
-	struct timer *t;
-	uint32_t eventCount;
-
-	currentKernelTimestamp += TIMER_INTERRUPT_DELTA;
+	uint32_t status = INTERRUPT_CONTINUE_EXECUTION;
+	uint64_t now = tscGetNanoseconds();
+	struct cpu *cpu = smpGetCPU();
 
-	for (t = LL_ENTRY(timerList.next, struct timer, obj.entry); &t->obj.entry != &timerList;)
+	/* continue with the next thread */
+	if (cpu->sliceEnd && cpu->sliceEnd <= now)
 	{
-		if (t->timeout > currentKernelTimestamp) break;
-
-		/* Calculate the number of occurances since the timeout elapsed the last time */
-		if (t->interval)
-		{
-			eventCount = (currentKernelTimestamp - t->timeout) / t->interval + 1;
-			t->timeout += eventCount * t->interval;
-			__timerUpdate(t);
-		}
-		else
-		{
-			eventCount = 1;
-			__timerDeactivate(t);
-		}
-
-		/* wake up waiters */
-		queueWakeup(&t->waiters, t->wakeupAll, eventCount);
+		cpu->sliceEnd = 0;
+		status = INTERRUPT_YIELD;
+	}
 
-		/* get next timer */
-		t = LL_ENTRY(timerList.next, struct timer, obj.entry);
+	/* application processors only use their timer for time slices */
+	if (!cpu->bootstrap)
+	{
+		if (cpu->sliceEnd)
+			apicTimerStart(cpu->sliceEnd - now, false);
+		return status;
 	}
 
-	/* continue with the next thread */
-	return INTERRUPT_YIELD;
+	/* The one-shot timer has expired, possibly a bit before the deadline because
+	 * of the limited precision of the hardware timer. Nothing is programmed anymore,
+	 * so __timerProgram() must not skip the next deadline even if it is unchanged. */
+	timerNextInterrupt = 0;
+
+	__timerWheelAdvance(now);
+	__timerProgram();
+	return status;
 }
 
 /**
  * @brief Initializes the system timer
  * @details This function initializes the system timer which is used to schedule threads.
+ *			The APIC timer (or the PIT) runs in one-shot mode and is only programmed
+ *			for the next event, so an idle system isn't woken up periodically.
+ *			tscInit() and apicTimerInit() have to be called before.
  */
 void timerInit()
 {
-	pitSetFrequency(0, TIMER_INTERRUPT_FREQUENCY);
-	picReserveIRQ(IRQ_PIT, timer_irq);
+	uint32_t level, i;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		for (i = 0; i < TIMER_WHEEL_SIZE; i++)
+			ll_init(&timerWheel[level][i]);
+	}
+
+	timerActiveCount	= 0;
+	timerWheelTime		= 0;
+	timerNextInterrupt	= 0;
+	timerUseApic		= apicTimerAvailable() && apicTimerReserve(timer_irq);
+
+	__timerProgram();
+	if (!timerUseApic)
+		picReserveIRQ(IRQ_PIT, timer_irq);
+}
+
+/**
+ * @brief Starts a new time slice for the current thread
+ * @details The scheduler only needs a periodic tick if more than one thread is
+ *			runnable. After #TIMER_INTERRUPT_DELTA nanoseconds the timer IRQ
+ *			returns #INTERRUPT_YIELD to schedule the next thread.
+ *
+ * @param restart If false an already running time slice is continued
+ */
+void timerStartTimeslice(bool restart)
+{
+	struct cpu *cpu = smpGetCPU();
+	if (cpu->sliceEnd && !restart) return;
+
+	cpu->sliceEnd = tscGetNanoseconds() + TIMER_INTERRUPT_DELTA;
+
+	if (cpu->bootstrap)
+		__timerProgram();
+	else
+		apicTimerStart(TIMER_INTERRUPT_DELTA, false);
+}
+
+/**
+ * @brief Stops the current time slice
+ * @details Used when no other thread is waiting for the CPU, the current thread
+ *			can then run until it blocks or another thread wakes up.
+ */
+void timerStopTimeslice()
+{
+	struct cpu *cpu = smpGetCPU();
+	if (!cpu->sliceEnd) return;
+
+	cpu->sliceEnd = 0;
+
+	if (cpu->bootstrap)
+		__timerProgram();
+	else
+		apicTimerStop();
 }
 
 /**
@@ -324,7 +605,17 @@ void timerInit()
  */
 uint64_t timerGetTimestamp()
 {
-	return currentKernelTimestamp;
+	return tscGetNanoseconds() / 1000000;
+}
+
+/**
+ * @brief Returns the current kernel timestamp in nanoseconds
+ * @details The clock is based on the TSC, which was calibrated at boot time.
+ * @return Number of nanoseconds since the system was booted
+ */
+uint64_t timerGetTimestampNs()
+{
+	return tscGetNanoseconds();
 }
 
 /**
@@ -78,11 +78,20 @@ char **__get_ibnos_envp()
 	return (char **)buf_envp;
 }
 
+void __tcache_init(struct _reent *ptr);
+void __tcache_release(struct _reent *ptr);
+
 void __init_ibnos_thread()
 {
 	struct _reent *reent = __getreent();
 	_REENT_INIT_PTR(reent);
 	__sinit(reent);
+	__tcache_init(reent);
+}
+
+void __exit_ibnos_thread()
+{
+	__tcache_release(__getreent());
 }
 
 void __init_ibnos()
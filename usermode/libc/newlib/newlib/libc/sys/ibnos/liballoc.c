@@ -3,7 +3,6 @@
 /**  Durand's Ridiculously Amazing Super Duper Memory functions.  */
 
 //#define DEBUG	
-#define LIBALLOC_MAGIC	0xc001c0de
 #define MAXCOMPLETE		5
 #define MAXEXP	32
 #define MINEXP	8	
@@ -208,6 +207,7 @@ static inline struct boundary_tag* split_tag( struct boundary_tag* tag )
 
 	new_tag->next = NULL;
 	new_tag->prev = NULL;
+	new_tag->owner = NULL;
 
 	new_tag->split_left = tag;
 	new_tag->split_right = tag->split_right;
@@ -254,6 +254,7 @@ static struct boundary_tag* allocate_new_tag( unsigned int size )
 	tag->prev		= NULL;
 	tag->split_left 	= NULL;
 	tag->split_right 	= NULL;
+	tag->owner		= NULL;
 
 
 	#ifdef DEBUG
@@ -267,14 +268,13 @@ static struct boundary_tag* allocate_new_tag( unsigned int size )
 	return tag;
 }
 
-void *liballoc_malloc_r(size_t size)
+// Must be called with the lock held.
+static void *liballoc_malloc_locked(size_t size)
 {
 	int index;
 	void *ptr;
 	struct boundary_tag *tag = NULL;
 
-	liballoc_lock();
-
 		if ( l_initialized == 0 )
 		{
 			#ifdef DEBUG
@@ -314,10 +314,7 @@ void *liballoc_malloc_r(size_t size)
 		if ( tag == NULL )
 		{	
 			if ( (tag = allocate_new_tag( size )) == NULL )
-			{
-				liballoc_unlock();
 				return NULL;
-			}
 			
 			index = getexp( tag->real_size - sizeof(struct boundary_tag) );
 		}
@@ -332,6 +329,7 @@ void *liballoc_malloc_r(size_t size)
 		// We have a free page.  Remove it from the free pages list.
 
 		tag->size = size;
+		tag->owner = NULL;
 
 		// Removed... see if we can re-use the excess space.
 
@@ -369,28 +367,18 @@ void *liballoc_malloc_r(size_t size)
 	dump_array();
 	#endif
 
-
-	liballoc_unlock();
 	return ptr;
 }
 
-void liballoc_free_r(void *ptr)
+// Must be called with the lock held.
+static void liballoc_free_locked(void *ptr)
 {
 	int index;
 	struct boundary_tag *tag;
 
-	if ( ptr == NULL ) return;
-
-	liballoc_lock();
-	
-
 		tag = (struct boundary_tag*)((unsigned int)ptr - sizeof( struct boundary_tag ));
 	
-		if ( tag->magic != LIBALLOC_MAGIC ) 
-		{
-			liballoc_unlock();		// release the lock
-			return;
-		}
+		if ( tag->magic != LIBALLOC_MAGIC ) return;
 
 
 
@@ -444,7 +432,6 @@ void liballoc_free_r(void *ptr)
 				dump_array();
 				#endif
 
-				liballoc_unlock();
 				return;
 			}
 
@@ -462,6 +449,62 @@ void liballoc_free_r(void *ptr)
 	printf("Returning tag with %i bytes (requested %i bytes), which has exponent: %i\n", tag->real_size, tag->size, index ); 
 	dump_array();
 	#endif
+}
+
+void *liballoc_malloc_r(size_t size)
+{
+	void *ptr;
+
+	liballoc_lock();
+	ptr = liballoc_malloc_locked( size );
+	liballoc_unlock();
+
+	return ptr;
+}
+
+void liballoc_free_r(void *ptr)
+{
+	if ( ptr == NULL ) return;
+
+	liballoc_lock();
+	liballoc_free_locked( ptr );
+	liballoc_unlock();
+}
+
+/** Allocates up to 'count' blocks of 'size' bytes and marks them as
+ * belonging to 'owner'. Only takes the lock once, which is used to
+ * refill the per-thread caches.
+ *
+ * \return The number of blocks stored in 'ptrs'.
+ */
+int liballoc_malloc_batch_r(size_t size, void **ptrs, int count, void *owner)
+{
+	struct boundary_tag *tag;
+	int i;
+
+	liballoc_lock();
+
+		for ( i = 0; i < count; i++ )
+		{
+			if ( (ptrs[i] = liballoc_malloc_locked( size )) == NULL ) break;
+
+			tag = (struct boundary_tag*)((unsigned int)ptrs[i] - sizeof( struct boundary_tag ));
+			tag->owner = owner;
+		}
+
+	liballoc_unlock();
+	return i;
+}
+
+/** Frees 'count' blocks while only taking the lock once. */
+void liballoc_free_batch_r(void **ptrs, int count)
+{
+	int i;
+
+	liballoc_lock();
+
+		for ( i = 0; i < count; i++ )
+			liballoc_free_locked( ptrs[i] );
 
 	liballoc_unlock();
 }
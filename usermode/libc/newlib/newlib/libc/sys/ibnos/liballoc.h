@@ -20,6 +20,8 @@ typedef	unsigned int	size_t;
 extern "C" {
 #endif
 
+#define LIBALLOC_MAGIC	0xc001c0de
+
 /** This is a boundary tag which is prepended to the
  * page or section of a page which we have allocated. It is
  * used to identify valid memory blocks that the
@@ -37,6 +39,8 @@ struct	boundary_tag
 	
 	struct boundary_tag *next;	//< Linked list info.
 	struct boundary_tag *prev;	//< Linked list info.
+
+	void *owner;				//< Thread cache the block belongs to, or NULL.
 };
 
 /** This function is supposed to lock the memory data structures. It
@@ -80,6 +84,9 @@ void     *liballoc_realloc_r(void *, size_t);		//< The standard function.
 void     *liballoc_calloc_r(size_t, size_t);		//< The standard function.
 void      liballoc_free_r(void *);					//< The standard function.
 
+int       liballoc_malloc_batch_r(size_t, void **, int, void *);	//< Allocates several blocks of the same size under one lock.
+void      liballoc_free_batch_r(void **, int);					//< Frees several blocks under one lock.
+
 #ifdef __cplusplus
 }
 #endif
@@ -4,25 +4,27 @@
 #include <unistd.h>
 #include <errno.h>
 #include <reent.h>
+#include <string.h>
 #include "syscall.h"
 
 #define _ALLOC_SKIP_DEFINE
 
 #include "liballoc.h"
+#include <sys/mutex.h>
 
-volatile int memory_lock = 0;
+/* threads which lose the race sleep in the kernel instead of spinning */
+static mutex_t memory_lock = MUTEX_INITIALIZER;
 
 int liballoc_lock()
 {
-    while (__sync_lock_test_and_set(&memory_lock, 1)) {};
-    return 0;
+	mutexLock(&memory_lock);
+	return 0;
 }
 
 int liballoc_unlock()
 {
-    __sync_synchronize(); // Memory barrier.
-    memory_lock = 0;
-    return 0;
+	mutexUnlock(&memory_lock);
+	return 0;
 }
 
 void* liballoc_alloc(int size)
@@ -34,13 +36,236 @@ int liballoc_free(void *ptr, int size)
 {
 	return ibnos_syscall(SYSCALL_RELEASE_MEMORY, (uint32_t)ptr, size);
 }
+
+/*
+	Per-thread caches ("magazines") for small allocations. They are stored
+	in the thread local storage block directly behind the reent structure,
+	so the pointer passed to the *_r functions is enough to find them without
+	an additional syscall. Each class keeps a stack of free blocks of exactly
+	that size, which is refilled from and flushed to liballoc in batches.
+
+	Blocks remember the cache which allocated them. When another thread frees
+	such a block it is collected in a pending list and pushed to the inbox of
+	the owner as a whole, once the batch is full. The inbox lives on the heap
+	since the thread local storage is released when the owning thread exits;
+	inboxes of terminated threads are reused by new threads.
+*/
+
+#define TCACHE_MAGIC		0x7cac4e00
+#define TCACHE_MIN_SHIFT	4
+#define TCACHE_CLASSES		5	/* 16, 32, 64, 128, 256 bytes */
+#define TCACHE_MAX_SIZE		(1 << (TCACHE_MIN_SHIFT + TCACHE_CLASSES - 1))
+#define TCACHE_MAGAZINE		32	/* blocks per class */
+#define TCACHE_BATCH		16	/* blocks moved from / to liballoc at once */
+#define TCACHE_OFFSET		((sizeof(struct _reent) + 15) & ~15)
+
+struct tcache_inbox
+{
+	void * volatile		head;	/* blocks freed by other threads */
+	struct tcache_inbox	*next;	/* next unused inbox */
+};
+
+struct tcache
+{
+	uint32_t			magic;
+	struct tcache		*self;
+	struct tcache_inbox	*inbox;
+
+	uint32_t			count[TCACHE_CLASSES];
+	void				*blocks[TCACHE_CLASSES][TCACHE_MAGAZINE];
+
+	/* blocks of another thread, waiting to be returned */
+	struct tcache_inbox	*remote_owner;
+	void				*remote_head;
+	void				*remote_tail;
+	uint32_t			remote_count;
+};
+
+/* protected by memory_lock */
+static struct tcache_inbox *unused_inboxes = NULL;
+
+static inline struct boundary_tag *__tcache_tag(void *ptr)
+{
+	return (struct boundary_tag *)((uint32_t)ptr - sizeof(struct boundary_tag));
+}
+
+static inline uint32_t __tcache_class(size_t size)
+{
+	if (size <= (1 << TCACHE_MIN_SHIFT)) return 0;
+	return 32 - __builtin_clz(size - 1) - TCACHE_MIN_SHIFT;
+}
+
+static inline struct tcache *__tcache_get(struct _reent *ptr)
+{
+	struct tcache *c;
+
+	/* the global reent structure is not part of a thread local storage block */
+	if (!ptr || ptr == _GLOBAL_REENT) return NULL;
+
+	c = (struct tcache *)((uint8_t *)ptr + TCACHE_OFFSET);
+	return (c->magic == TCACHE_MAGIC && c->self == c) ? c : NULL;
+}
+
+static struct tcache_inbox *__tcache_get_inbox()
+{
+	struct tcache_inbox *inbox;
+
+	liballoc_lock();
+	if ((inbox = unused_inboxes))
+		unused_inboxes = inbox->next;
+	liballoc_unlock();
+
+	if (!inbox && (inbox = liballoc_malloc_r(sizeof(*inbox))))
+		inbox->head = NULL;
+
+	return inbox;
+}
+
+static void __tcache_flush_remote(struct tcache *c)
+{
+	struct tcache_inbox *owner = c->remote_owner;
+	void *head;
+
+	if (!c->remote_count) return;
+
+	do
+	{
+		head = owner->head;
+		*(void **)c->remote_tail = head;
+	}
+	while (!__sync_bool_compare_and_swap(&owner->head, head, c->remote_head));
+
+	c->remote_owner	= NULL;
+	c->remote_head	= NULL;
+	c->remote_tail	= NULL;
+	c->remote_count	= 0;
+}
+
+static void __tcache_remote_free(struct tcache *c, struct tcache_inbox *owner, void *ptr)
+{
+	if (c->remote_owner != owner)
+	{
+		__tcache_flush_remote(c);
+		c->remote_owner = owner;
+	}
+
+	*(void **)ptr = c->remote_head;
+	c->remote_head = ptr;
+	if (!c->remote_count++) c->remote_tail = ptr;
+
+	if (c->remote_count >= TCACHE_BATCH)
+		__tcache_flush_remote(c);
+}
+
+static void __tcache_put(struct tcache *c, void *ptr)
+{
+	uint32_t cls = __tcache_class(__tcache_tag(ptr)->size);
+
+	/* magazine is full, give the oldest half back to liballoc */
+	if (c->count[cls] >= TCACHE_MAGAZINE)
+	{
+		liballoc_free_batch_r(c->blocks[cls], TCACHE_BATCH);
+		memmove(c->blocks[cls], c->blocks[cls] + TCACHE_BATCH, (TCACHE_MAGAZINE - TCACHE_BATCH) * sizeof(void *));
+		c->count[cls] -= TCACHE_BATCH;
+	}
+
+	c->blocks[cls][c->count[cls]++] = ptr;
+}
+
+static void __tcache_drain(struct tcache *c)
+{
+	void *ptr, *next;
+
+	if (!c->inbox || !c->inbox->head) return;
+
+	for (ptr = __sync_lock_test_and_set(&c->inbox->head, NULL); ptr; ptr = next)
+	{
+		next = *(void **)ptr;
+		__tcache_put(c, ptr);
+	}
+}
+
+static void *__tcache_alloc(struct tcache *c, size_t size)
+{
+	uint32_t cls = __tcache_class(size);
+
+	if (!c->count[cls])
+	{
+		__tcache_drain(c);
+
+		if (!c->count[cls])
+		{
+			if (!c->inbox && !(c->inbox = __tcache_get_inbox())) return NULL;
+			c->count[cls] = liballoc_malloc_batch_r(1 << (cls + TCACHE_MIN_SHIFT), c->blocks[cls], TCACHE_BATCH, c->inbox);
+			if (!c->count[cls]) return NULL;
+		}
+	}
+
+	return c->blocks[cls][--c->count[cls]];
+}
+
+static int __tcache_free(struct tcache *c, void *ptr)
+{
+	struct boundary_tag *tag = __tcache_tag(ptr);
+
+	if (tag->magic != LIBALLOC_MAGIC || !tag->owner)
+		return 0;
+
+	if (tag->owner == c->inbox)
+		__tcache_put(c, ptr);
+	else
+		__tcache_remote_free(c, tag->owner, ptr);
+
+	return 1;
+}
+
+void __tcache_init(struct _reent *ptr)
+{
+	struct tcache *c = (struct tcache *)((uint8_t *)ptr + TCACHE_OFFSET);
+
+	/* not enough thread local storage, use the shared heap only */
+	if (TCACHE_OFFSET + sizeof(*c) > getTLSLength()) return;
+
+	memset(c, 0, sizeof(*c));
+	c->magic	= TCACHE_MAGIC;
+	c->self		= c;
+}
+
+void __tcache_release(struct _reent *ptr)
+{
+	struct tcache *c = __tcache_get(ptr);
+	uint32_t cls;
+
+	if (!c) return;
+
+	__tcache_flush_remote(c);
+	__tcache_drain(c);
+
+	for (cls = 0; cls < TCACHE_CLASSES; cls++)
+	{
+		liballoc_free_batch_r(c->blocks[cls], c->count[cls]);
+		c->count[cls] = 0;
+	}
+
+	/* blocks still in use elsewhere keep pointing to the inbox, so keep it for the next thread */
+	if (c->inbox)
+	{
+		liballoc_lock();
+		c->inbox->next = unused_inboxes;
+		unused_inboxes = c->inbox;
+		liballoc_unlock();
+	}
+
+	c->magic = 0;
+}
 /* 
 	The *_r are functions required for internal commands. Since we do
 	not use the default allocator of newlib we need to implement them
 */ 
 void* _malloc_r (struct _reent *ptr, size_t size)
 {
-	void *addr = liballoc_malloc_r(size);
+	struct tcache *c = __tcache_get(ptr);
+	void *addr = (c && size <= TCACHE_MAX_SIZE) ? __tcache_alloc(c, size) : liballoc_malloc_r(size);
 	if (!addr && ptr)
 		ptr->_errno = ENOMEM;
 	return addr;
@@ -64,6 +289,8 @@ void* _calloc_r (struct _reent *ptr, size_t num, size_t size)
 
 void _free_r (struct _reent *eptr, void* ptr)
 {
+	struct tcache *c = __tcache_get(eptr);
+	if (ptr && c && __tcache_free(c, ptr)) return;
 	liballoc_free_r(ptr);
 }
 
@@ -0,0 +1,70 @@
+#include <stdint.h>
+#include <sys/mutex.h>
+#include "syscall.h"
+
+/*
+	Futex based mutex, see "Futexes Are Tricky" by Ulrich Drepper. The
+	value is only set to 2 when there might be sleeping threads, so that
+	unlocking an uncontended mutex doesn't require a syscall.
+*/
+
+void mutexInit(mutex_t *m)
+{
+	m->value = 0;
+}
+
+void mutexLock(mutex_t *m)
+{
+	uint32_t c = __sync_val_compare_and_swap(&m->value, 0, 1);
+	if (c == 0) return;
+
+	/* mark as contended and sleep until we get the lock */
+	if (c != 2) c = __sync_lock_test_and_set(&m->value, 2);
+	while (c != 0)
+	{
+		futexWait(&m->value, 2);
+		c = __sync_lock_test_and_set(&m->value, 2);
+	}
+}
+
+int mutexTrylock(mutex_t *m)
+{
+	return (__sync_val_compare_and_swap(&m->value, 0, 1) == 0);
+}
+
+void mutexUnlock(mutex_t *m)
+{
+	if (__sync_fetch_and_sub(&m->value, 1) != 1)
+	{
+		m->value = 0;
+		futexWake(&m->value, 1);
+	}
+}
+
+void condInit(cond_t *c)
+{
+	c->seq = 0;
+}
+
+void condWait(cond_t *c, mutex_t *m)
+{
+	uint32_t seq = c->seq;
+	mutexUnlock(m);
+	futexWait(&c->seq, seq);
+
+	/* we can't know if other threads are still sleeping, so take the lock as contended */
+	while (__sync_lock_test_and_set(&m->value, 2) != 0)
+		futexWait(&m->value, 2);
+}
+
+void condSignal(cond_t *c)
+{
+	__sync_fetch_and_add(&c->seq, 1);
+	futexWake(&c->seq, 1);
+}
+
+void condBroadcast(cond_t *c)
+{
+	__sync_fetch_and_add(&c->seq, 1);
+	futexWake(&c->seq, 0xFFFFFFFF);
+}
@@ -0,0 +1,41 @@
+#include "config.h"
+#include <_ansi.h>
+#include <_syslist.h>
+#include <unistd.h>
+#include <reent.h>
+#include <errno.h>
+#include "syscall.h"
+
+ssize_t pread(int fd, void *buf, size_t nbytes, off_t offset)
+{
+	int32_t ret, size;
+	struct _reent *reent = __getreent();
+	reent->_errno = 0;
+
+	if (offset < 0)
+	{
+		reent->_errno = EINVAL;
+		return -1;
+	}
+
+	ret = objectPRead(fd, buf, nbytes, offset);
+	if (ret < 0)
+	{
+		/* an empty positional read only fails for objects without a position */
+		if (objectPReadV(fd, NULL, 0, offset) < 0)
+		{
+			reent->_errno = ESPIPE;
+			return -1;
+		}
+
+		/* reading at or behind the end of the file is not an error */
+		size = objectGetStatus(fd, 0);
+		if (size >= 0 && offset >= size)
+			return 0;
+
+		reent->_errno = EFAULT;
+		return -1;
+	}
+
+	return ret;
+}
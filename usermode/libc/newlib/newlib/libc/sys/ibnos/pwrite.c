@@ -0,0 +1,29 @@
+#include "config.h"
+#include <_ansi.h>
+#include <_syslist.h>
+#include <unistd.h>
+#include <reent.h>
+#include <errno.h>
+#include "syscall.h"
+
+ssize_t pwrite(int fd, const void *buf, size_t nbytes, off_t offset)
+{
+	int32_t ret;
+	struct _reent *reent = __getreent();
+	reent->_errno = 0;
+
+	if (offset < 0)
+	{
+		reent->_errno = EINVAL;
+		return -1;
+	}
+
+	ret = objectPWrite(fd, (void *)buf, nbytes, offset);
+	if (ret < 0)
+	{
+		reent->_errno = ESPIPE;
+		return -1;
+	}
+
+	return ret;
+}
@@ -4,5 +4,5 @@
 
 struct _reent * __getreent()
 {
-	return (struct _reent *)ibnos_syscall(SYSCALL_GET_THREADLOCAL_STORAGE_BASE);
+	return (struct _reent *)getTLS();
 }
@@ -0,0 +1,34 @@
+#ifndef _SYS_MUTEX_H
+#define _SYS_MUTEX_H
+
+/*
+ * Mutexes and condition variables for ibnos, built on top of the
+ * futex syscalls. Uncontended operations never enter the kernel.
+ */
+
+#include <stdint.h>
+
+/* value is 0 (unlocked), 1 (locked) or 2 (locked, possibly with waiters) */
+typedef struct {
+	volatile uint32_t	value;
+} mutex_t;
+
+/* seq is incremented by every signal / broadcast operation */
+typedef struct {
+	volatile uint32_t	seq;
+} cond_t;
+
+#define MUTEX_INITIALIZER	{ 0 }
+#define COND_INITIALIZER	{ 0 }
+
+void mutexInit (mutex_t *);
+void mutexLock (mutex_t *);
+int mutexTrylock (mutex_t *);
+void mutexUnlock (mutex_t *);
+
+void condInit (cond_t *);
+void condWait (cond_t *, mutex_t *);
+void condSignal (cond_t *);
+void condBroadcast (cond_t *);
+
+#endif /* _SYS_MUTEX_H */
@@ -32,11 +32,13 @@
 #include <syscall.h>
 #include <unistd.h>
 #include <console/console.h>
+#include <process/thread.h>
 #include <assert.h>
 #include "vconsole.h"
 #include "shell.h"
 
 #define BUFFER_SIZE 1024
+#define WRITE_BATCH_SIZE 16
 
 extern struct virtConsole consoles[NUM_VIRT_CONSOLES];
 
@@ -74,61 +76,83 @@ int main()
 	/* also wait for stdin */
 	objectAttach(event, 0, 0, 0);
 
+	/* forward input and output before the shells get scheduled again */
+	i = getCurrentThread();
+	setThreadPriority(i, THREAD_PRIORITY_MAX);
+	objectClose(i);
+
 	for (;;)
 	{
-		int32_t index, length, handle = objectWait(event, 0);
-		if (handle < 0) continue;
-		length = read(handle, buffer, BUFFER_SIZE);
+		struct eventReady ready[NUM_VIRT_CONSOLES + 1];
+		int32_t j, numReady = eventWaitReady(event, ready, NUM_VIRT_CONSOLES + 1);
 
-		/* redirect output from the process to the virtual console */
-		if (handle != 0)
+		for (j = 0; j < numReady; j++)
 		{
-			index = 0;
-			while (index < NUM_VIRT_CONSOLES && consoles[index].output != handle)
-				index++;
+			struct syscallBatchEntry writes[WRITE_BATCH_SIZE];
+			int32_t index, length, start, count, handle = ready[j].identifier;
+			length = read(handle, buffer, BUFFER_SIZE);
 
-			if (index < NUM_VIRT_CONSOLES)
+			/* redirect output from the process to the virtual console */
+			if (handle != 0)
 			{
-				for (i = 0; i < length; i++){
+				index = 0;
+				while (index < NUM_VIRT_CONSOLES && consoles[index].output != handle)
+					index++;
 
-					if (!consoles[index].escape && buffer[i] == '\e')
-					{
-						consoles[index].escape = true;
-						consoles[index].escapeCode = 0;
-						consoles[index].escapeValue = 0;
-						continue;
-					}
+				if (index < NUM_VIRT_CONSOLES)
+				{
+					for (i = 0; i < length; i++){
 
-					if (consoles[index].escape)
-					{
-						if (!consoles[index].escapeCode)
-							consoles[index].escapeCode = buffer[i];
-						else
+						if (!consoles[index].escape && buffer[i] == '\e')
 						{
-							consoles[index].escapeValue = buffer[i];
-							virtConsoleProcessEscape(index, (index == currentConsole));
-							consoles[index].escape = false;
+							consoles[index].escape = true;
+							consoles[index].escapeCode = 0;
+							consoles[index].escapeValue = 0;
+							continue;
 						}
-						continue;
+
+						if (consoles[index].escape)
+						{
+							if (!consoles[index].escapeCode)
+								consoles[index].escapeCode = buffer[i];
+							else
+							{
+								consoles[index].escapeValue = buffer[i];
+								virtConsoleProcessEscape(index, (index == currentConsole));
+								consoles[index].escape = false;
+							}
+							continue;
+						}
+						virtConsolePutChar(index, buffer[i], (currentConsole == index));
 					}
-					virtConsolePutChar(index, buffer[i], (currentConsole == index));
 				}
+				continue;
 			}
-			continue;
-		}
 
-		/* handle stdin */
-		for (i = 0; i < length; i++)
-		{
-			if (buffer[i] == '\t')
+			/* handle stdin, forward the characters between tabs with a single batch */
+			for (i = 0, start = 0, count = 0; i <= length; i++)
 			{
-				currentConsole = (currentConsole + 1) % NUM_VIRT_CONSOLES;
-				virtConsoleSwitchTo(currentConsole);
-				continue;
-			}
+				if (i < length && buffer[i] != '\t') continue;
 
-			/* forward to the child process */
-			ibnos_syscall(SYSCALL_OBJECT_WRITE, consoles[currentConsole].input, (uint32_t)&buffer[i], 1);
+				if (i > start)
+				{
+					/* forward to the child process */
+					syscallBatchSet(&writes[count++], SYSCALL_OBJECT_WRITE, consoles[currentConsole].input, (uint32_t)&buffer[start], i - start);
+					if (count == WRITE_BATCH_SIZE)
+					{
+						syscallBatch(writes, count);
+						count = 0;
+					}
+				}
+				start = i + 1;
+
+				if (i < length)
+				{
+					currentConsole = (currentConsole + 1) % NUM_VIRT_CONSOLES;
+					virtConsoleSwitchTo(currentConsole);
+				}
+			}
+			if (count) syscallBatch(writes, count);
 		}
 
 	};
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <stdio.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <syscall.h>
+
+#define SPLICE_SIZE 0x10000
+
+/* moves the data to stdout inside of the kernel, returns false if stdout was closed */
+static bool cat(int fd)
+{
+	int32_t result;
+
+	for (;;)
+	{
+		result = objectSplice(fd, 1, SPLICE_SIZE);
+		if (result > 0) continue;
+
+		/* end of file, the input pipe was closed or stdout is broken - an empty
+		 * write only fails for the latter, the console has no status to query */
+		if (result < 0)
+			return (objectWrite(1, NULL, 0) >= 0);
+
+		/* either there is no data yet, or stdout is full */
+		if (objectGetStatus(fd, 0) == 0)
+		{
+			if (objectWait(fd, 0) < 0) return true;
+		}
+		else if (objectWait(1, 1) < 0)
+			return false;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int i, fd, result = 0;
+
+	if (argc < 2)
+		return cat(0) ? 0 : 1;
+
+	for (i = 1; i < argc; i++)
+	{
+		fd = open(argv[i], O_RDONLY);
+		if (fd < 0)
+		{
+			printf("cat: %s: No such file\n", argv[i]);
+			result = 1;
+			continue;
+		}
+
+		if (!cat(fd)) result = 1;
+		close(fd);
+	}
+
+	return result;
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <memory/allocator.h>
+
+#define UNUSED __attribute__((unused))
+
+static inline char *__byteSizeMem(unsigned int size, char *buf, int length)
+{
+	if (size < 1024 * 5)
+		snprintf(buf, length, "%u B", size);
+	else if (size < 1024 * 1024 * 5)
+		snprintf(buf, length, "%u KB", size / 1024);
+	else
+		snprintf(buf, length, "%u MB", size / (1024 * 1024));
+
+	return buf;
+}
+
+int main(UNUSED int argc, UNUSED char **argv)
+{
+	struct heapTagInfo heapInfo[64], *info;
+	unsigned int numTags, totalBytes = 0, totalAllocations = 0;
+	char buf[2][34];
+
+	numTags = getHeapInfo(heapInfo, sizeof(heapInfo)/sizeof(heapInfo[0]));
+	if (numTags > sizeof(heapInfo)/sizeof(heapInfo[0]))
+		numTags = sizeof(heapInfo)/sizeof(heapInfo[0]);
+
+	printf("%-16s | %9s | %9s | %9s | %10s\n",
+		"SUBSYSTEM", "LIVE MEM", "PEAK MEM", "LIVE CNT", "TOTAL CNT");
+	printf("--------------------------------------------------------------------------------");
+
+	info = heapInfo;
+	while (numTags)
+	{
+		printf("%-16.16s | %9s | %9s | %9u | %10u\n",
+			info->name,
+			__byteSizeMem(info->liveBytes, buf[0], sizeof(buf[0])),
+			__byteSizeMem(info->peakBytes, buf[1], sizeof(buf[1])),
+			(unsigned int)info->liveAllocations,
+			(unsigned int)info->totalAllocations
+		);
+
+		totalBytes			+= info->liveBytes;
+		totalAllocations	+= info->liveAllocations;
+		numTags--;
+		info++;
+	}
+
+	printf("\n%s in %u allocations\n",
+		__byteSizeMem(totalBytes, buf[0], sizeof(buf[0])), totalAllocations);
+
+	return 0;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2014, Michael Müller
+ * Copyright (c) 2014, Sebastian Lackner
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+#define DEFAULT_ITERATIONS 100000
+
+static inline uint64_t __rdtsc()
+{
+	uint64_t value;
+	asm volatile ("rdtsc" : "=A"(value));
+	return value;
+}
+
+static uint64_t __benchmarkInt80(uint32_t iterations)
+{
+	uint64_t start = __rdtsc();
+	uint32_t i;
+	int ret;
+
+	for (i = 0; i < iterations; i++)
+		asm volatile ("int $0x80" :"=a"(ret) :"a"(SYSCALL_GET_MONOTONIC_CLOCK));
+
+	return __rdtsc() - start;
+}
+
+static uint64_t __benchmarkSysenter(uint32_t iterations)
+{
+	uint64_t start = __rdtsc();
+	uint32_t i;
+	int ret;
+
+	for (i = 0; i < iterations; i++)
+		asm volatile (IBNOS_SYSENTER :"=a"(ret) :"a"(SYSCALL_GET_MONOTONIC_CLOCK) : "ecx", "edx", "cc");
+
+	return __rdtsc() - start;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t iterations = DEFAULT_ITERATIONS;
+	uint64_t cycles;
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], NULL, 0);
+	if (!iterations)
+		iterations = 1;
+
+	cycles = __benchmarkInt80(iterations);
+	printf("int 0x80: %u cycles per syscall\n", (unsigned int)(cycles / iterations));
+
+	if (!ibnos_sysenter())
+	{
+		printf("sysenter: not supported by this CPU\n");
+		return 0;
+	}
+
+	cycles = __benchmarkSysenter(iterations);
+	printf("sysenter: %u cycles per syscall\n", (unsigned int)(cycles / iterations));
+	return 0;
+}
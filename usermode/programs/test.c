@@ -121,6 +121,17 @@ DECLARE_TEST_FUNC(thread)
 	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, child, 0) == -1);
 	ok(ibnos_syscall(SYSCALL_OBJECT_SHUTDOWN, child, 44));
 	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, child, 0) == 44);
+
+	/* stacks of terminated threads are reused */
+	for (i = 0; i < 20; i++)
+	{
+		child = createThreadWithStack(&thread_child_thread, 1, 2, 3, (i & 1) ? 0x20000 : 0);
+		ok(child >= 0);
+		ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, child, 0) == 42);
+		ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, child));
+	}
+
+	ok(createThreadWithStack(&thread_child_thread, 1, 2, 3, 0x80000000) < 0);
 }
 
 DECLARE_TEST_FUNC(process)
@@ -310,7 +321,9 @@ DECLARE_TEST_FUNC(timer)
 {
 	uint32_t timer;
 	struct timerInfo info;
+	struct timerInfoNs infoNs;
 	uint32_t totalTime;
+	uint64_t startTime;
 
 	timer = ibnos_syscall(SYSCALL_CREATE_TIMER, 0);
 
@@ -319,7 +332,7 @@ DECLARE_TEST_FUNC(timer)
 	info.timeout = 1;
 	info.interval = 1;
 	ok(ibnos_syscall(SYSCALL_OBJECT_WRITE, timer, (uint32_t)&info, sizeof(info)) == sizeof(info));
-	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, timer, 0) >= 12);
+	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, timer, 0) >= 1);
 	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, timer, 0) == -1);
 
 	info.timeout = 15;
@@ -345,7 +358,71 @@ DECLARE_TEST_FUNC(timer)
 	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, timer, 0) == 0);
 
 	totalTime = ibnos_syscall(SYSCALL_GET_MONOTONIC_CLOCK) - totalTime;
-	ok(totalTime >= 12 + 3 * 15 + 3 * 30 + 30);
+	ok(totalTime >= 1 + 3 * 15 + 3 * 30 + 30);
+
+	/* sub-millisecond timeouts */
+	startTime = getMonotonicClockNs();
+	ok(getMonotonicClockNs() >= startTime);
+
+	infoNs.timeout = 300000;
+	infoNs.interval = 0;
+	ok(ibnos_syscall(SYSCALL_OBJECT_WRITE, timer, (uint32_t)&infoNs, sizeof(infoNs)) == sizeof(infoNs));
+	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, timer, 0) == 1);
+	ok(getMonotonicClockNs() - startTime >= 300000);
+}
+
+DECLARE_TEST_FUNC(timer_oneshot)
+{
+	uint32_t timer, i;
+	struct timerInfoNs infoNs;
+	uint64_t startTime;
+
+	timer = ibnos_syscall(SYSCALL_CREATE_TIMER, 0);
+
+	/* The deadlines don't match the resolution of the APIC timer, so the interrupt
+	 * frequently arrives shortly before the timer expires. The kernel has to arm the
+	 * hardware timer again, otherwise one of the waits never returns. */
+	for (i = 0; i < 200; i++)
+	{
+		infoNs.timeout = 1000 + i * 997;
+		infoNs.interval = 0;
+		startTime = getMonotonicClockNs();
+		ok(ibnos_syscall(SYSCALL_OBJECT_WRITE, timer, (uint32_t)&infoNs, sizeof(infoNs)) == sizeof(infoNs));
+		ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, timer, 0) == 1);
+		ok(getMonotonicClockNs() - startTime >= infoNs.timeout);
+	}
+
+	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, timer));
+}
+
+static uint32_t shareddata_child_thread(uint32_t threadID, uint32_t processID, UNUSED uint32_t c)
+{
+	ok(getCurrentThreadID() != threadID);
+	ok(getCurrentProcessID() == processID);
+	ok(getTLS() == (void *)ibnos_syscall(SYSCALL_GET_THREADLOCAL_STORAGE_BASE));
+	return 0;
+}
+
+DECLARE_TEST_FUNC(shareddata)
+{
+	int32_t child;
+	uint32_t timestamp;
+
+	ok(getCurrentThreadID() != 0);
+	ok(getTLS() == (void *)ibnos_syscall(SYSCALL_GET_THREADLOCAL_STORAGE_BASE));
+	ok(getTLSLength() == (uint32_t)ibnos_syscall(SYSCALL_GET_THREADLOCAL_STORAGE_LENGTH));
+	ok(getProgramArguments() == (void *)ibnos_syscall(SYSCALL_GET_PROGRAM_ARGUMENTS_BASE));
+	ok(getProgramArgumentsLength() == (uint32_t)ibnos_syscall(SYSCALL_GET_PROGRAM_ARGUMENTS_LENGTH));
+	ok(getEnvironmentVariables() == (void *)ibnos_syscall(SYSCALL_GET_ENVIRONMENT_VARIABLES_BASE));
+	ok(getEnvironmentVariablesLength() == (uint32_t)ibnos_syscall(SYSCALL_GET_ENVIRONMENT_VARIABLES_LENGTH));
+
+	timestamp = ibnos_syscall(SYSCALL_GET_MONOTONIC_CLOCK);
+	ok(getMonotonicClock() - timestamp <= 1);
+
+	child = createThread(&shareddata_child_thread, getCurrentThreadID(), getCurrentProcessID(), 0);
+	ok(child >= 0);
+	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, child, 0) == 0);
+	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, child));
 }
 
 DECLARE_TEST_FUNC(event)
@@ -391,6 +468,7 @@ DECLARE_TEST_FUNC(event)
 
 	ok(ibnos_syscall(SYSCALL_OBJECT_ATTACH_OBJ, event, sem1, 0, 91));
 	ok(ibnos_syscall(SYSCALL_OBJECT_ATTACH_OBJ, event, sem2, 0, 92));
+	ok(!ibnos_syscall(SYSCALL_OBJECT_ATTACH_OBJ, event, sem1, EVENT_ATTACH_EDGE, 94));
 
 	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, event) == 91);
 	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, event) == 91);
@@ -443,6 +521,362 @@ DECLARE_TEST_FUNC(event)
 	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, event));
 }
 
+DECLARE_TEST_FUNC(eventready)
+{
+	struct eventReady ready[64];
+	int32_t pipes[64];
+	int32_t event;
+	char c;
+	uint32_t i;
+
+	event = ibnos_syscall(SYSCALL_CREATE_EVENT, 1);
+	ok(event >= 0);
+
+	/* odd pipes are edge triggered */
+	for (i = 0; i < 64; i++)
+	{
+		pipes[i] = ibnos_syscall(SYSCALL_CREATE_PIPE);
+		ok(pipes[i] >= 0);
+		ok(ibnos_syscall(SYSCALL_OBJECT_ATTACH_OBJ, event, pipes[i], (i & 1) ? EVENT_ATTACH_EDGE : 0, 1000 + i));
+	}
+
+	ok(ibnos_syscall(SYSCALL_EVENT_GET_READY, event, (uint32_t)ready, 64) == 0);
+
+	ok(ibnos_syscall(SYSCALL_OBJECT_WRITE, pipes[2], (uint32_t)"ab", 2) == 2);
+	ok(ibnos_syscall(SYSCALL_OBJECT_WRITE, pipes[5], (uint32_t)"c", 1) == 1);
+	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, event, EVENT_WAIT_READY) == 2);
+
+	ok(ibnos_syscall(SYSCALL_EVENT_GET_READY, event, (uint32_t)ready, 64) == 2);
+	ok(ready[0].identifier == 1002 && ready[0].result == 2);
+	ok(ready[1].identifier == 1005 && ready[1].result == 1);
+
+	/* level triggered pipe is reported again, the edge triggered one is suppressed */
+	ok(ibnos_syscall(SYSCALL_EVENT_GET_READY, event, (uint32_t)ready, 64) == 1);
+	ok(ready[0].identifier == 1002);
+
+	/* ... unless nothing else is ready */
+	ok(ibnos_syscall(SYSCALL_OBJECT_READ, pipes[2], (uint32_t)&c, 1) == 1);
+	ok(ibnos_syscall(SYSCALL_OBJECT_READ, pipes[2], (uint32_t)&c, 1) == 1);
+	ok(ibnos_syscall(SYSCALL_EVENT_GET_READY, event, (uint32_t)ready, 64) == 1);
+	ok(ready[0].identifier == 1005);
+
+	ok(ibnos_syscall(SYSCALL_OBJECT_READ, pipes[5], (uint32_t)&c, 1) == 1);
+	ok(ibnos_syscall(SYSCALL_EVENT_GET_READY, event, (uint32_t)ready, 64) == 0);
+
+	/* edge triggered pipe is reported again after it blocked */
+	ok(ibnos_syscall(SYSCALL_OBJECT_WRITE, pipes[5], (uint32_t)"d", 1) == 1);
+	ok(ibnos_syscall(SYSCALL_OBJECT_WRITE, pipes[63], (uint32_t)"e", 1) == 1);
+	ok(eventWaitReady(event, ready, 1) == 1);
+	ok(ready[0].identifier == 1005);
+	ok(eventWaitReady(event, ready, 64) == 1);
+	ok(ready[0].identifier == 1063);
+
+	for (i = 0; i < 64; i++)
+		ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, pipes[i]));
+
+	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, event));
+}
+
+DECLARE_TEST_FUNC(ioring)
+{
+	struct ioRingCompletion cqe;
+	struct ioRingHeader *ring = NULL;
+	char buffer[16];
+	int32_t handle, pipe, sem;
+
+	handle = createIORing(5, &ring);
+	ok(handle >= 0 && ring != NULL);
+	ok(ring->sqEntries == 8 && ring->cqEntries == 16);
+
+	pipe = ibnos_syscall(SYSCALL_CREATE_PIPE);
+	ok(pipe >= 0);
+
+	/* reading from an empty pipe is deferred */
+	memset(buffer, 0, sizeof(buffer));
+	ok(ioRingPrepare(ring, IORING_OP_READ, pipe, buffer, sizeof(buffer), 0, 1));
+	ok(ioRingEnter(handle, 1) == 1);
+	ok(ring->sqHead == 1);
+	ok(!ioRingGetCompletion(ring, &cqe));
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, handle, 0) == 0);
+
+	ok(ioRingPrepare(ring, IORING_OP_WRITE, pipe, "hello", 5, 0, 2));
+	ok(ioRingPrepare(ring, IORING_OP_NOP, -1, NULL, 0, 0, 3));
+	ok(ioRingEnter(handle, 8) == 2);
+
+	ok(ioRingWaitCompletion(handle, ring, &cqe));
+	ok(cqe.userData == 2 && cqe.result == 5);
+	ok(ioRingWaitCompletion(handle, ring, &cqe));
+	ok(cqe.userData == 3 && cqe.result == 0);
+	ok(ioRingWaitCompletion(handle, ring, &cqe));
+	ok(cqe.userData == 1 && cqe.result == 5);
+	ok(memcmp(buffer, "hello", 5) == 0);
+
+	/* wait operations complete as soon as the object is signalled */
+	sem = ibnos_syscall(SYSCALL_CREATE_SEMAPHORE, 0);
+	ok(sem >= 0);
+	ok(ioRingPrepare(ring, IORING_OP_WAIT, sem, NULL, 0, 0, 4));
+	ok(ioRingPrepare(ring, IORING_OP_READ, 12345, buffer, sizeof(buffer), 0, 5));
+	ok(ioRingEnter(handle, 8) == 2);
+	ok(ioRingGetCompletion(ring, &cqe));
+	ok(cqe.userData == 5 && cqe.result == -1);
+	ok(!ioRingGetCompletion(ring, &cqe));
+	ok(ibnos_syscall(SYSCALL_OBJECT_SIGNAL, sem, 0));
+	ok(ioRingGetCompletion(ring, &cqe));
+	ok(cqe.userData == 4 && cqe.result == 0);
+
+	ok(ioRingPrepare(ring, IORING_OP_SIGNAL, sem, NULL, 0, 0, 6));
+	ok(ioRingEnter(handle, 1) == 1);
+	ok(ioRingGetCompletion(ring, &cqe));
+	ok(cqe.userData == 6 && cqe.result == 1);
+	ok(ibnos_syscall(SYSCALL_OBJECT_WAIT, sem, 0) == 0);
+
+	/* deferred operations are aborted when shutting down the ring */
+	ok(ioRingPrepare(ring, IORING_OP_READ, pipe, buffer, sizeof(buffer), 0, 7));
+	ok(ioRingEnter(handle, 1) == 1);
+	ok(ibnos_syscall(SYSCALL_OBJECT_SHUTDOWN, handle, 0));
+	ok(ioRingGetCompletion(ring, &cqe));
+	ok(cqe.userData == 7 && cqe.result == -1);
+
+	/* closing the ring drops pending operations */
+	ok(ioRingPrepare(ring, IORING_OP_READ, pipe, buffer, sizeof(buffer), 0, 8));
+	ok(ioRingEnter(handle, 1) == 1);
+	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, handle));
+
+	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, sem));
+	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, pipe));
+}
+
+DECLARE_TEST_FUNC(batch)
+{
+	struct syscallBatchEntry entries[3];
+	int32_t sem;
+
+	sem = ibnos_syscall(SYSCALL_CREATE_SEMAPHORE, 0);
+	ok(sem >= 0);
+
+	syscallBatchSet(&entries[0], SYSCALL_OBJECT_SIGNAL, sem, 0, 0);
+	syscallBatchSet(&entries[1], SYSCALL_OBJECT_SIGNAL, sem, 0, 0);
+	syscallBatchSet(&entries[2], SYSCALL_OBJECT_GET_STATUS, sem, 0, 0);
+	ok(syscallBatch(entries, 3) == 3);
+	ok(entries[0].result == 1 && entries[1].result == 1 && entries[2].result == 2);
+
+	/* stops after the first error */
+	syscallBatchSet(&entries[0], SYSCALL_OBJECT_SIGNAL, sem, 0, 0);
+	syscallBatchSet(&entries[1], SYSCALL_OBJECT_WRITE, 12345, 0, 0);
+	syscallBatchSet(&entries[2], SYSCALL_OBJECT_SIGNAL, sem, 0, 0);
+	entries[2].result = 77;
+	ok(syscallBatch(entries, 3) == 2);
+	ok(entries[0].result == 1 && entries[1].result == (uint32_t)-1 && entries[2].result == 77);
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, sem, 0) == 3);
+
+	/* blocking syscalls are rejected */
+	syscallBatchSet(&entries[0], SYSCALL_OBJECT_WAIT, sem, 0, 0);
+	syscallBatchSet(&entries[1], SYSCALL_BATCH, (uint32_t)entries, 1, 0);
+	ok(syscallBatch(entries, 2) == 1);
+	ok(entries[0].result == (uint32_t)-1);
+	ok(syscallBatch(&entries[1], 1) == 1);
+	ok(entries[1].result == (uint32_t)-1);
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, sem, 0) == 3);
+
+	ok(syscallBatch(entries, 0) == 0);
+	ok(ibnos_syscall(SYSCALL_OBJECT_CLOSE, sem));
+}
+
+DECLARE_TEST_FUNC(iovec)
+{
+	char buffer[32];
+	struct ioVector vec[3];
+	int32_t pipe, file, h1, h2;
+
+	/* scatter-gather on pipes */
+	pipe = ibnos_syscall(SYSCALL_CREATE_PIPE);
+	ok(pipe >= 0);
+
+	vec[0].base = "Hello";	vec[0].length = 5;
+	vec[1].base = NULL;		vec[1].length = 0;
+	vec[2].base = " World";	vec[2].length = 6;
+	ok(objectWriteV(pipe, vec, 3) == 11);
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, pipe, 0) == 11);
+
+	memset(buffer, 0, sizeof(buffer));
+	vec[0].base = buffer;		vec[0].length = 3;
+	vec[1].base = buffer + 8;	vec[1].length = 4;
+	vec[2].base = buffer + 16;	vec[2].length = 8;
+	ok(objectReadV(pipe, vec, 3) == 11);
+	ok(!memcmp(buffer, "Hel", 3) && !memcmp(buffer + 8, "lo W", 4) && !memcmp(buffer + 16, "orld", 5));
+	ok(objectReadV(pipe, vec, 3) == 0);
+
+	/* pipes have no position, but appending works */
+	ok(objectPRead(pipe, buffer, 4, 0) < 0);
+	ok(objectPReadV(pipe, NULL, 0, 0) < 0);
+	ok(objectPWrite(pipe, "abcd", 4, 0) < 0);
+	ok(objectPWrite(pipe, "abcd", 4, IO_OFFSET_APPEND) == 4);
+	ok(objectRead(pipe, buffer, sizeof(buffer)) == 4);
+
+	/* invalid arguments */
+	ok(objectWriteV(pipe, vec, IO_VECTOR_MAX + 1) < 0);
+	vec[0].base = (void *)0xFFFFF000; vec[0].length = 4;
+	ok(objectWriteV(pipe, vec, 1) < 0);
+	ok(objectClose(pipe));
+
+	/* positional access on files doesn't move the file position */
+	file = filesystemSearchFile(-1, "/iovec.txt", 10, true);
+	ok(file >= 0);
+	h1 = filesystemOpen(file);
+	h2 = filesystemOpen(file);
+	ok(h1 >= 0 && h2 >= 0);
+	ok(objectClose(file));
+
+	ok(objectPWrite(h1, "0123456789", 10, 0) == 10);
+	ok(objectGetStatus(h1, 1) == 0);
+	ok(objectGetStatus(h1, 0) == 10);
+
+	vec[0].base = "AB"; vec[0].length = 2;
+	vec[1].base = "CD"; vec[1].length = 2;
+	ok(objectPWriteV(h1, vec, 2, 3) == 4);
+	ok(objectPWriteV(h2, vec, 2, IO_OFFSET_APPEND) == 4);
+	ok(objectPWriteV(h1, vec, 1, IO_OFFSET_APPEND) == 2);
+	ok(objectGetStatus(h2, 0) == 16);
+	ok(objectGetStatus(h2, 1) == 0);
+
+	memset(buffer, 0, sizeof(buffer));
+	vec[0].base = buffer;		vec[0].length = 4;
+	vec[1].base = buffer + 8;	vec[1].length = 16;
+	ok(objectPReadV(h2, vec, 2, 1) == 15);
+	ok(!memcmp(buffer, "12AB", 4) && !strcmp(buffer + 8, "CD789ABCDAB"));
+	ok(objectPRead(h2, buffer, 4, 16) < 0);
+	ok(objectPReadV(h2, NULL, 0, 16) == 0);
+
+	/* regular scatter-gather uses and updates the position */
+	ok(objectSignal(h2, 14));
+	ok(objectReadV(h2, vec, 2) == 2);
+	ok(objectGetStatus(h2, 1) == 16);
+
+	ok(objectClose(h1));
+	ok(objectClose(h2));
+	ok(unlink("/iovec.txt") == 0);
+}
+
+static uint8_t pipepages_src[3 * 0x1000] __attribute__((aligned(0x1000)));
+static uint8_t pipepages_dst[3 * 0x1000] __attribute__((aligned(0x1000)));
+
+DECLARE_TEST_FUNC(pipepages)
+{
+	int32_t pipe;
+	uint32_t i;
+
+	for (i = 0; i < sizeof(pipepages_src); i++)
+		pipepages_src[i] = (uint8_t)(i * 7 + (i >> 12));
+
+	pipe = ibnos_syscall(SYSCALL_CREATE_PIPE);
+	ok(pipe >= 0);
+
+	/* whole pages are queued by reference, modifications afterwards are not visible */
+	ok(objectWrite(pipe, pipepages_src, 2 * 0x1000 + 100) == 2 * 0x1000 + 100);
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, pipe, 0) == 2 * 0x1000 + 100);
+	pipepages_src[0] ^= 0xFF;
+	pipepages_src[0x1000 + 5] ^= 0xFF;
+
+	ok(objectRead(pipe, pipepages_dst, sizeof(pipepages_dst)) == 2 * 0x1000 + 100);
+	pipepages_src[0] ^= 0xFF;
+	pipepages_src[0x1000 + 5] ^= 0xFF;
+	ok(!memcmp(pipepages_dst, pipepages_src, 2 * 0x1000 + 100));
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, pipe, 0) == 0);
+
+	/* writer and reader share the page until one of them modifies it */
+	ok(objectWrite(pipe, pipepages_src, 0x1000) == 0x1000);
+	ok(objectRead(pipe, pipepages_dst, 0x1000) == 0x1000);
+	memset(pipepages_dst, 0, 0x1000);
+	for (i = 0; i < 0x1000; i++)
+		ok(pipepages_src[i] == (uint8_t)(i * 7));
+
+	/* unaligned data is copied, the following pages are still correct */
+	ok(objectWrite(pipe, pipepages_src + 1, 100) == 100);
+	ok(objectWrite(pipe, pipepages_src, 2 * 0x1000) == 2 * 0x1000);
+	ok(objectRead(pipe, pipepages_dst, 100) == 100);
+	ok(!memcmp(pipepages_dst, pipepages_src + 1, 100));
+	ok(objectRead(pipe, pipepages_dst, 2 * 0x1000) == 2 * 0x1000);
+	ok(!memcmp(pipepages_dst, pipepages_src, 2 * 0x1000));
+
+	/* moving pages also works with a closed write side */
+	ok(objectWrite(pipe, pipepages_src, 0x1000) == 0x1000);
+	ok(objectShutdown(pipe, 1));
+	ok(objectRead(pipe, pipepages_dst + 0x1000, 2 * 0x1000) == 0x1000);
+	ok(!memcmp(pipepages_dst + 0x1000, pipepages_src, 0x1000));
+	ok(objectRead(pipe, pipepages_dst, 0x1000) < 0);
+	ok(objectClose(pipe));
+}
+
+DECLARE_TEST_FUNC(splice)
+{
+	char buffer[32];
+	int32_t a, b, file, h1, h2;
+	uint32_t i;
+
+	a = ibnos_syscall(SYSCALL_CREATE_PIPE);
+	b = ibnos_syscall(SYSCALL_CREATE_PIPE);
+	ok(a >= 0 && b >= 0);
+
+	/* tee keeps the data in the source pipe */
+	ok(objectWrite(a, "Hello World", 11) == 11);
+	ok(objectTee(a, b, 5) == 5);
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, a, 0) == 11);
+	ok(objectSplice(a, b, 100) == 11);
+	ok(ibnos_syscall(SYSCALL_OBJECT_GET_STATUS, a, 0) == 0);
+	ok(objectSplice(a, b, 100) == 0);
+	memset(buffer, 0, sizeof(buffer));
+	ok(objectRead(b, buffer, sizeof(buffer)) == 16);
+	ok(!strcmp(buffer, "HelloHello World"));
+	ok(objectTee(a, a, 1) < 0);
+
+	/* complete pages are passed on without copying */
+	for (i = 0; i < 2 * 0x1000; i++)
+		pipepages_src[i] = (uint8_t)(i * 7 + (i >> 12));
+	ok(objectWrite(a, pipepages_src, 2 * 0x1000) == 2 * 0x1000);
+	ok(objectTee(a, b, 2 * 0x1000) == 2 * 0x1000);
+	pipepages_src[0] ^= 0xFF;
+	ok(objectSplice(a, b, 3 * 0x1000) == 2 * 0x1000);
+	pipepages_src[0] ^= 0xFF;
+	ok(objectRead(b, pipepages_dst, 2 * 0x1000) == 2 * 0x1000);
+	ok(!memcmp(pipepages_dst, pipepages_src, 2 * 0x1000));
+	ok(objectRead(b, pipepages_dst, 2 * 0x1000) == 2 * 0x1000);
+	ok(!memcmp(pipepages_dst, pipepages_src, 2 * 0x1000));
+
+	/* files are read from and written to the current position */
+	file = filesystemSearchFile(-1, "/splice.txt", 11, true);
+	ok(file >= 0);
+	h1 = filesystemOpen(file);
+	h2 = filesystemOpen(file);
+	ok(h1 >= 0 && h2 >= 0);
+	ok(objectClose(file));
+
+	ok(objectWrite(h1, "0123456789", 10) == 10);
+	ok(objectSplice(h2, a, 4) == 4);
+	ok(objectGetStatus(h2, 1) == 4);
+	ok(objectSplice(h2, a, 100) == 6);
+	ok(objectSplice(h2, a, 1) < 0);
+	memset(buffer, 0, sizeof(buffer));
+	ok(objectRead(a, buffer, sizeof(buffer)) == 10);
+	ok(!strcmp(buffer, "0123456789"));
+
+	ok(objectWrite(a, "abc", 3) == 3);
+	ok(objectSplice(a, h1, 10) == 3);
+	ok(objectGetStatus(h1, 0) == 13);
+	ok(objectSignal(h2, 0));
+	ok(objectSplice(h2, h1, 4) < 0);
+
+	ok(objectClose(h1));
+	ok(objectClose(h2));
+	ok(unlink("/splice.txt") == 0);
+
+	/* closed pipes */
+	ok(objectShutdown(a, 1));
+	ok(objectSplice(a, b, 1) < 0);
+	ok(objectTee(b, a, 1) < 0);
+	ok(objectClose(a));
+	ok(objectClose(b));
+}
+
 DECLARE_TEST_FUNC(filesystem)
 {
 	static const char path0[] = "/test";
@@ -670,7 +1104,15 @@ int main(UNUSED int argc, UNUSED char **argv)
 	test_semaphore();
 	test_pipe();
 	test_timer();
+	test_timer_oneshot();
+	test_shareddata();
 	test_event();
+	test_eventready();
+	test_ioring();
+	test_batch();
+	test_iovec();
+	test_pipepages();
+	test_splice();
 	test_filesystem();
 	test_file();
 
@@ -26,12 +26,27 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <syscall.h>
 #include <process/process.h>
+#include <process/timer.h>
 
 #define UNUSED __attribute__((unused))
 #define PAGE_SIZE 0x1000
+#define MAX_PROCESSES 1024
+
+/* time between both samples in ms */
+#define SAMPLE_INTERVAL 500
+
+struct processSample
+{
+	struct processInfo *info;
+	uint32_t cpu; /* in percent */
+};
+
+static struct processInfo processInfo[2][MAX_PROCESSES];
+static struct processSample samples[MAX_PROCESSES];
 
 static inline char *__byteSizeMem(unsigned int size, char *buf, int length)
 {
@@ -45,32 +60,90 @@ static inline char *__byteSizeMem(unsigned int size, char *buf, int length)
 	return buf;
 }
 
+static inline uint64_t __rdtsc()
+{
+	uint64_t value;
+	asm volatile ("rdtsc" : "=A"(value));
+	return value;
+}
+
+static void __sleep(uint32_t milliseconds)
+{
+	struct timerInfo info;
+	int32_t timer = createTimer(false);
+	if (timer < 0) return;
+
+	info.timeout	= milliseconds;
+	info.interval	= 0;
+	if (objectWrite(timer, &info, sizeof(info)) == sizeof(info))
+		objectWait(timer, 0);
+
+	objectClose(timer);
+}
+
+static int __compareSamples(const void *a, const void *b)
+{
+	const struct processSample *sa = a, *sb = b;
+	if (sa->cpu != sb->cpu) return (sa->cpu < sb->cpu) ? 1 : -1;
+	return (sa->info->processID < sb->info->processID) ? -1 : (sa->info->processID > sb->info->processID);
+}
+
 int main(UNUSED int argc, UNUSED char **argv)
 {
-	struct processInfo processInfo[1024], *info;
-	unsigned int numProcesses;
+	struct processInfo *info, *prev;
+	unsigned int numPrevious, numProcesses, i, j;
+	uint64_t start, elapsed, used;
 
-	numProcesses = getProcessInfo(processInfo, sizeof(processInfo)/sizeof(processInfo[0]));
+	/* take two samples to calculate the cpu usage */
+	numPrevious = getProcessInfo(processInfo[0], MAX_PROCESSES);
+	if (numPrevious > MAX_PROCESSES) numPrevious = MAX_PROCESSES;
+	start = __rdtsc();
 
-	if (numProcesses > sizeof(processInfo)/sizeof(processInfo[0]))
+	__sleep(SAMPLE_INTERVAL);
+
+	numProcesses = getProcessInfo(processInfo[1], MAX_PROCESSES);
+	elapsed = __rdtsc() - start;
+	if (!elapsed) elapsed = 1;
+
+	if (numProcesses > MAX_PROCESSES)
 	{
-		numProcesses = sizeof(processInfo)/sizeof(processInfo[0]);
+		numProcesses = MAX_PROCESSES;
 		printf("Too many processes, will only display information for the first %u\n\n", numProcesses);
 	}
 	else
 		printf("%u running processes\n\n", numProcesses);
 
-	printf("%8s | %4s | %4s | %7s | %7s | %7s | %7s | %7s | %4s\n",
-		"PID", "THRD", "WAIT", "SHR MEM", "FRK MEM", "RSV MEM", "OUT MEM", "PHS MEM", "HNDL");
+	for (i = 0; i < numProcesses; i++)
+	{
+		info = &processInfo[1][i];
+		used = info->userTime + info->kernelTime;
+
+		/* processes started after the first sample used all their time in the interval */
+		for (j = 0, prev = processInfo[0]; j < numPrevious; j++, prev++)
+		{
+			if (prev->processID != info->processID) continue;
+			used -= prev->userTime + prev->kernelTime;
+			break;
+		}
+
+		samples[i].info	= info;
+		samples[i].cpu	= (used > elapsed) ? 100 : (uint32_t)((used * 100) / elapsed);
+	}
+
+	qsort(samples, numProcesses, sizeof(samples[0]), __compareSamples);
+
+	printf("%8s| %2s| %4s| %4s| %7s| %7s| %7s| %7s| %7s| %4s|%3s\n",
+		"PID", "PR", "THRD", "WAIT", "SHR MEM", "FRK MEM", "RSV MEM", "OUT MEM", "PHS MEM", "HNDL", "CPU");
 	printf("--------------------------------------------------------------------------------");
 
-	info = processInfo;
-	while (numProcesses)
+	for (i = 0; i < numProcesses; i++)
 	{
 		char buf[5][34];
+		info = samples[i].info;
 
-		printf("%08x | %4u | %4u | %7s | %7s | %7s | %7s | %7s | %4u\n",
+		printf("%08x| %2u| %4u| %4u| %7s| %7s| %7s| %7s| %7s| %4u|%3u\n",
 			(unsigned int)info->processID,
+			(unsigned int)info->priority,
 			(unsigned int)info->numberOfTotalThreads,
 			(unsigned int)info->numberOfBlockedThreads,
 			__byteSizeMem(info->pagesShared * PAGE_SIZE,   buf[0], sizeof(buf[0])),
@@ -78,11 +151,10 @@ int main(UNUSED int argc, UNUSED char **argv)
 			__byteSizeMem(info->pagesReserved * PAGE_SIZE, buf[2], sizeof(buf[2])),
 			__byteSizeMem(info->pagesOutpaged * PAGE_SIZE, buf[3], sizeof(buf[3])),
 			__byteSizeMem(info->pagesPhysical * PAGE_SIZE, buf[4], sizeof(buf[4])),
-			(unsigned int)info->handleCount
+			(unsigned int)info->handleCount,
+			(unsigned int)samples[i].cpu
 		);
-		numProcesses--;
-		info++;
 	}
 
 	return 0;
-}
\ No newline at end of file
+}
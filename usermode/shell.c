@@ -309,9 +309,13 @@ static void shellRunCommand(char **argv)
 
 		if (pid == 0) /* child process */
 		{
+			struct syscallBatchEntry redirect[2];
+			uint32_t count = 0;
+
 			/* forward stdin/stdout */
-			if (in_pipe != 0)  dup2(in_pipe, 0);
-			if (out_pipe != 1) dup2(out_pipe, 1);
+			if (in_pipe != 0)  syscallBatchSet(&redirect[count++], SYSCALL_OBJECT_DUP2, in_pipe, 0, 0);
+			if (out_pipe != 1) syscallBatchSet(&redirect[count++], SYSCALL_OBJECT_DUP2, out_pipe, 1, 0);
+			if (count) syscallBatch(redirect, count);
 
 			execvp(argv[0], argv);
 			exit(127);